@@ -0,0 +1,94 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * arena_aligned() - allocate a cache line aligned block
+ * size: bytes needed
+ *
+ * C89 has no aligned allocation, so this over-allocates by a cache line
+ * and keeps the pointer malloc() returned just below the aligned block.
+ *
+ * Return: zeroed memory to free with arena_aligned_free(), or NULL
+ */
+void *arena_aligned(size_t size)
+{
+    unsigned char *raw, *p;
+
+    raw = malloc(size + ARENA_ALIGN + sizeof(void *));
+    if (!raw)
+        return NULL;
+    p = raw + sizeof(void *);
+    p += (ARENA_ALIGN - (size_t)p % ARENA_ALIGN) % ARENA_ALIGN;
+    memcpy(p - sizeof(void *), &raw, sizeof(void *));
+    memset(p, 0, size);
+    return p;
+}
+
+/*
+ * arena_aligned_free() - free a block from arena_aligned()
+ * p: the block (NULL does nothing)
+ */
+void arena_aligned_free(void *p)
+{
+    void *raw;
+
+    if (!p)
+        return;
+    memcpy(&raw, (unsigned char *)p - sizeof(void *), sizeof(void *));
+    free(raw);
+}
+
+/*
+ * arena_create() - allocate an arena
+ * size: bytes it can hand out (each allocation is rounded up to a
+ *       cache line, as the module _size() functions already are)
+ *
+ * the arena header and its memory are a single block
+ *
+ * Return: the arena, or NULL if out of memory
+ */
+struct arena *arena_create(size_t size)
+{
+    const size_t head = ARENA_ROUND(sizeof(struct arena));
+    struct arena *a;
+
+    size = ARENA_ROUND(size);
+    a = arena_aligned(head + size);
+    if (!a)
+        return NULL;
+    a->base = (unsigned char *)a + head;
+    a->size = size;
+    a->used = 0;
+    return a;
+}
+
+/*
+ * arena_alloc() - take memory from an arena
+ * a: the arena
+ * size: bytes needed
+ *
+ * the memory is freed with the arena, not on its own
+ *
+ * Return: zeroed, cache line aligned memory, NULL if the arena is full
+ */
+void *arena_alloc(struct arena *a, size_t size)
+{
+    void *p;
+
+    size = ARENA_ROUND(size);
+    if (size > a->size - a->used)
+        return NULL;
+    p = a->base + a->used;
+    a->used += size;
+    return p;
+}
+
+/*
+ * arena_destroy() - free an arena and all its allocations
+ * a: the arena
+ */
+void arena_destroy(struct arena *a)
+{
+    arena_aligned_free(a);
+}
@@ -0,0 +1,50 @@
+#ifndef DSP_ARENA_H_INCLUDED
+#define DSP_ARENA_H_INCLUDED
+
+/*
+ * cache line aligned memory for the C modules
+ *
+ * each filter module lays its state, coefficients and delay line out in
+ * one block, with every part starting on a cache line, so creating a
+ * filter is one allocation and its data is not scattered over the heap.
+ * An arena is one block carved up for many filters at once (a filter
+ * bank), freed with a single arena_destroy():
+ *
+ *   struct arena *bank = arena_create(count * canfltr_size(N));
+ *   for (i = 0; i < count; i++)
+ *       f[i] = canfltr_create_in(bank, N, b[i], a[i]);
+ *   ...
+ *   arena_destroy(bank);
+ */
+
+#include <stddef.h>
+
+/* alignment of every block and of every part of one (a cache line) */
+#define ARENA_ALIGN 64
+
+/* n bytes rounded up to a whole number of cache lines */
+#define ARENA_ROUND(n) (((n) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+
+/* bump allocator over one aligned block */
+struct arena {
+    unsigned char *base;    /* first byte handed out */
+    size_t size;            /* bytes that can be handed out */
+    size_t used;            /* bytes handed out so far */
+};
+
+/* allocate size bytes of zeroed, cache line aligned memory */
+void *arena_aligned(size_t size);
+
+/* free memory from arena_aligned() */
+void arena_aligned_free(void *p);
+
+/* allocate an arena that can hand out size bytes */
+struct arena *arena_create(size_t size);
+
+/* take size zeroed bytes from an arena, NULL if it is full */
+void *arena_alloc(struct arena *a, size_t size);
+
+/* free an arena and everything allocated in it */
+void arena_destroy(struct arena *a);
+
+#endif
@@ -5,7 +5,8 @@ namespace dsp {
 // construct BiQuadFilter
 // b: quadratic polynomial for zeros
 // a: quadratic polynomial for poles
-BiQuad::BiQuad(std::array<double,3> b, std::array<double,3> a)
+template <typename T>
+BasicBiQuad<T>::BasicBiQuad(std::array<T,3> b, std::array<T,3> a)
 : x1{}, x2{}, y1{}, y2{}, b{b}, a{a}
 {
 }
@@ -13,11 +14,12 @@ BiQuad::BiQuad(std::array<double,3> b, std::array<double,3> a)
 // filter one sample using direct form I
 // x: input sample to process
 // Return: output sample
-double BiQuad::ProcessSample(double x0)
+template <typename T>
+T BasicBiQuad<T>::ProcessSample(T x0)
 {
-    double yz = b[0] * x0 + b[1] * x1 + b[2] * x2;
-    double yp = -a[1] * y1 - a[2] * y2;
-    double y0 = yz + yp;
+    T yz = b[0] * x0 + b[1] * x1 + b[2] * x2;
+    T yp = -a[1] * y1 - a[2] * y2;
+    T y0 = yz + yp;
 
     x2 = x1;
     x1 = x0;
@@ -27,4 +29,48 @@ double BiQuad::ProcessSample(double x0)
     return y0;
 }
 
+// filter a block of samples using direct form I
+// x: n input samples to process
+// y: n output samples (may be the same buffer as x)
+template <typename T>
+void BasicBiQuad<T>::ProcessBlock(const T *x, T *y, std::size_t n)
+{
+    const T b0 = b[0], b1 = b[1], b2 = b[2];
+    const T a1 = a[1], a2 = a[2];
+    T x1_ = x1, x2_ = x2, y1_ = y1, y2_ = y2;
+
+    // same arithmetic as ProcessSample with the state held in registers
+    for (std::size_t i = 0; i < n; i++) {
+        T x0 = x[i];
+        T yz = b0 * x0 + b1 * x1_ + b2 * x2_;
+        T yp = -a1 * y1_ - a2 * y2_;
+        T y0 = yz + yp;
+
+        x2_ = x1_;
+        x1_ = x0;
+        y2_ = y1_;
+        y1_ = y0;
+        y[i] = y0;
+    }
+
+    x1 = x1_;
+    x2 = x2_;
+    y1 = y1_;
+    y2 = y2_;
+}
+
+// filter a block of 16 bit samples in fixed point
+// x: n input samples to process
+// y: n output samples (may be the same buffer as x)
+template <typename T>
+void BasicBiQuad<T>::ProcessBlockQ15(const std::int16_t *x, std::int16_t *y,
+                                     std::size_t n)
+{
+    q.Quantize(b.data(), b.size(), a.data(), a.size());
+    q.ProcessBlock(x, y, n);
+}
+
+template class BasicBiQuad<float>;
+template class BasicBiQuad<double>;
+
 } // namespace dsp
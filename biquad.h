@@ -2,6 +2,7 @@
 #define DSP_BIQUAD_H_INCLUDED
 
 #include "filter.hpp"
+#include "fixed.h"
 #include <array>
 
 /************************************************************************
@@ -32,16 +33,36 @@
 
 namespace dsp {
 
-class BiQuad: public Filter {
-    double x1, x2, y1, y2;
+template <typename T>
+class BasicBiQuad: public BasicFilter<T> {
+    T x1, x2, y1, y2;
+    FixedDirectForm1 q;     // fixed point version and its state
 public:
-    std::array<double,3> b;  // b coefficients - feed forward
-    std::array<double,3> a;  // a coefficients - feedback
+    std::array<T,3> b;  // b coefficients - feed forward
+    std::array<T,3> a;  // a coefficients - feedback
 
-    BiQuad(std::array<double,3> b, std::array<double,3> a);
-    double ProcessSample(double x); // process one sample through filter
+    BasicBiQuad(std::array<T,3> b, std::array<T,3> a);
+    T ProcessSample(T x);   // process one sample through filter
+    void ProcessBlock(const T *x, T *y, std::size_t n);
+    BasicBiQuad *Clone() const { return new BasicBiQuad(*this); }
+    // in fixed point (see fixed.h), from the current b and a
+    void ProcessBlockQ15(const std::int16_t *x, std::int16_t *y,
+                         std::size_t n);
+    bool FixedPoint() const { return true; }
+
+    // state {x1, x2, y1, y2} (for TimeParallel)
+    std::size_t StateSize() const { return 4; }
+    void GetState(T *s) const {
+        s[0] = x1; s[1] = x2; s[2] = y1; s[3] = y2;
+    }
+    void SetState(const T *s) {
+        x1 = s[0]; x2 = s[1]; y1 = s[2]; y2 = s[3];
+    }
 };
 
+// (instantiated for float and double in biquad.cpp)
+typedef BasicBiQuad<double> BiQuad;
+
 }
 
 #endif
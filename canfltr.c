@@ -1,40 +1,176 @@
 #include "canfltr.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * canfltr_size() - bytes a canonical filter takes
+ * N: length of delay line w (and a and b coefficient arrays)
+ *
+ * the state, a, b, w, lin and the fixed point arrays each start on a
+ * cache line
+ *
+ * Return: the size of the block canfltr_create() allocates
+ */
+size_t canfltr_size(int N)
+{
+    return ARENA_ROUND(sizeof(struct canfltr))
+           + 2 * ARENA_ROUND(N * sizeof(double))
+           + ARENA_ROUND(2 * N * sizeof(double))
+           + ARENA_ROUND((N - 1 + CANFLTR_BLOCK) * sizeof(double))
+           + 2 * ARENA_ROUND(N * sizeof(int32_t))
+           + 2 * ARENA_ROUND((N - 1 + CANFLTR_BLOCK) * sizeof(int32_t));
+}
+
+/* round x to the nearest 32 bit integer, saturated */
+static int32_t canfltr_round(double x)
+{
+    if (x >= 2147483647.0)
+        return 2147483647;
+    if (x <= -2147483647.0)
+        return -2147483647;
+    return (int32_t)(x < 0.0 ? x - 0.5 : x + 0.5);
+}
+
+/*
+ * canfltr_quantize() - a and b in fixed point for canfltr_block_q15()
+ * s: the filter
+ *
+ * shift is the largest (up to 30) that keeps every coefficient within
+ * 32 bits and the sum of every product of a coefficient and a Q23 sample
+ * within the 64 bit accumulator (under 2^62)
+ */
+static void canfltr_quantize(struct canfltr *s)
+{
+    double big = 0.0, sum = 0.0, c, scale = 1073741824.0;
+    int n;
+
+    for (n = 0; n < s->N; n++) {
+        c = s->b[n] < 0.0 ? -s->b[n] : s->b[n];
+        big = c > big ? c : big;
+        sum += c;
+        c = n == 0 ? 0.0 : s->a[n] < 0.0 ? -s->a[n] : s->a[n];
+        big = c > big ? c : big;
+        sum += c;
+    }
+    for (s->shift = 30; s->shift > 1; s->shift--, scale *= 0.5)
+        if (big * scale < 2147483647.0 && sum * scale < 549755813888.0)
+            break;
+    for (n = 0; n < s->N; n++) {
+        s->qb[n] = canfltr_round(s->b[n] * scale);
+        s->qa[n] = canfltr_round(s->a[n] * scale);
+    }
+}
+
+/*
+ * canfltr_init() - lay a canonical filter out in a zeroed block
+ * mem: canfltr_size(N) zeroed bytes, cache line aligned (or NULL)
+ * N, b, a: as for canfltr_create()
+ *
+ * Return: the state structure at the start of mem
+ */
+static struct canfltr *
+canfltr_init(void *mem, int N, const double *b, const double *a)
+{
+    unsigned char *p = mem;
+    struct canfltr *s = mem;
+
+    if (!mem)
+        return NULL;
+    p += ARENA_ROUND(sizeof(struct canfltr));
+    s->a = (double *)p;
+    p += ARENA_ROUND(N * sizeof(double));
+    s->b = (double *)p;
+    p += ARENA_ROUND(N * sizeof(double));
+    s->w = (double *)p;
+    p += ARENA_ROUND(2 * N * sizeof(double));
+    s->lin = (double *)p;
+    p += ARENA_ROUND((N - 1 + CANFLTR_BLOCK) * sizeof(double));
+    s->qa = (int32_t *)p;
+    p += ARENA_ROUND(N * sizeof(int32_t));
+    s->qb = (int32_t *)p;
+    p += ARENA_ROUND(N * sizeof(int32_t));
+    s->qx = (int32_t *)p;
+    p += ARENA_ROUND((N - 1 + CANFLTR_BLOCK) * sizeof(int32_t));
+    s->qy = (int32_t *)p;
+    s->N = N;
+    s->pos = 0;
+    memcpy(s->a, a, N * sizeof(double));
+    memcpy(s->b, b, N * sizeof(double));
+    s->a[0] = 1.0;
+    canfltr_quantize(s);
+    return s;
+}
+
 /*
  * canfltr_create() - allocate and initialize a canonical filter
  * N: length of delay line w (and a and b coeeficient arrays)
  * b: b coefficent array (feed forward)
  * a: a coefficent array (feedback)
  *
- * Return: the initialized state structure for the filter
+ * Return: the initialized state structure for the filter, in one block
  */
 struct canfltr *
 canfltr_create(int N, double *b, double *a)
 {
-    struct canfltr *s;
-    s = malloc(sizeof(struct canfltr));
-    s->N = N;
-    s->w = calloc(N, sizeof(double));
-    s->a = calloc(N, sizeof(double));
-    s->b = calloc(N, sizeof(double));
-    memcpy(s->a, a, N * sizeof(double));
-    memcpy(s->b, b, N * sizeof(double));
-    s->a[0] = 1.0;
-    return s;
+    return canfltr_init(arena_aligned(canfltr_size(N)), N, b, a);
+}
+
+/*
+ * canfltr_create_in() - initialize a canonical filter in an arena
+ * ar: arena with canfltr_size(N) bytes left
+ * N, b, a: as for canfltr_create()
+ *
+ * Return: the filter (freed with the arena), NULL if the arena is full
+ */
+struct canfltr *
+canfltr_create_in(struct arena *ar, int N, double *b, double *a)
+{
+    return canfltr_init(arena_alloc(ar, canfltr_size(N)), N, b, a);
 }
 
 /*
  * canfltr_destroy() - free memory allocated for canonical filter
- * s: pointer to filter state
+ * s: pointer to filter state from canfltr_create() or canfltr_clone()
  */
 void canfltr_destroy(struct canfltr *s)
 {
-    free(s->b);
-    free(s->a);
-    free(s->w);
-    free(s);
+    arena_aligned_free(s);
+}
+
+/*
+ * canfltr_clone() - copy a canonical filter
+ * s: pointer to filter state
+ *
+ * Return: a new state structure with the same coefficients and delay line
+ */
+struct canfltr *canfltr_clone(const struct canfltr *s)
+{
+    struct canfltr *c = canfltr_create(s->N, s->b, s->a);
+
+    if (!c)
+        return NULL;
+    memcpy(c->w, s->w, 2 * s->N * sizeof(double));
+    c->pos = s->pos;
+    memcpy(c->qx, s->qx, (s->N - 1) * sizeof(int32_t));
+    memcpy(c->qy, s->qy, (s->N - 1) * sizeof(int32_t));
+    return c;
+}
+
+/*
+ * canfltr_taps() - FIR length of a canonical filter
+ * s: pointer to filter state
+ *
+ * Return: N if a[1..N-1] are all zero (an FIR filter), otherwise 0
+ */
+int canfltr_taps(const struct canfltr *s)
+{
+    int n;
+
+    for (n = 1; n < s->N; n++)
+        if (s->a[n] != 0.0)
+            return 0;
+    return s->N;
 }
 
 /*
@@ -47,22 +183,140 @@ void canfltr_destroy(struct canfltr *s)
 double canfltr_sample(struct canfltr *state, double x)
 {
     int n, N = state->N;
-    double *w = state->w;
+    double *ws = state->w + state->pos + N;
     double *a = state->a;
     double *b = state->b;
     double y, w0;
 
+    /* w[n] (the value n samples ago) is ws[1 - n] */
     w0 = x;
     for (n = 1; n < N; n++)
-        w0 -= a[n] * w[n];
-    w[0] = w0;
+        w0 -= a[n] * ws[1 - n];
+
+    if (++state->pos == N)
+        state->pos = 0;
+    ws = state->w + state->pos;
+    ws[0] = ws[N] = w0;
 
+    /* now w[n] is ws[-n] */
+    ws += N;
     y = 0.0;
     for (n = 0; n < N; n++)
-        y += b[n] * w[n];
-
-    for (n = N - 1; n > 0; n--)
-        w[n] = w[n - 1];
+        y += b[n] * ws[-n];
 
     return y;
 }
+
+/*
+ * canfltr_block() - process a block of samples through canonical filter
+ * s: pointer to the state of the filter
+ * x: n input samples to process
+ * y: n output samples (may be the same buffer as x)
+ *
+ * Up to CANFLTR_BLOCK samples at a time, the history and the new values
+ * of w are laid out end to end in s->lin. The feedback has to be done a
+ * sample at a time, but the feed forward sums are independent so four
+ * outputs are summed side by side (in the same order as canfltr_sample()
+ * so the results are identical).
+ */
+void canfltr_block(struct canfltr *s, const double *x, double *y, size_t n)
+{
+    const int N = s->N;
+    const double *a = s->a, *b = s->b;
+    double *wl = s->lin + N - 1;
+    double w0, y0, y1, y2, y3;
+    size_t i, j, m;
+    int k;
+
+    for (i = 0; i < n; i += m) {
+        m = n - i < CANFLTR_BLOCK ? n - i : CANFLTR_BLOCK;
+
+        /* the last N - 1 values of w, oldest first */
+        memcpy(s->lin, s->w + s->pos + 2, (N - 1) * sizeof(double));
+
+        for (j = 0; j < m; j++) {
+            w0 = x[i + j];
+            for (k = 1; k < N; k++)
+                w0 -= a[k] * wl[(ptrdiff_t)j - k];
+            wl[j] = w0;
+        }
+
+        for (j = 0; j + 4 <= m; j += 4) {
+            y0 = y1 = y2 = y3 = 0.0;
+            for (k = 0; k < N; k++) {
+                y0 += b[k] * wl[(ptrdiff_t)j - k];
+                y1 += b[k] * wl[(ptrdiff_t)j + 1 - k];
+                y2 += b[k] * wl[(ptrdiff_t)j + 2 - k];
+                y3 += b[k] * wl[(ptrdiff_t)j + 3 - k];
+            }
+            y[i + j] = y0;
+            y[i + j + 1] = y1;
+            y[i + j + 2] = y2;
+            y[i + j + 3] = y3;
+        }
+        for (; j < m; j++) {
+            y0 = 0.0;
+            for (k = 0; k < N; k++)
+                y0 += b[k] * wl[(ptrdiff_t)j - k];
+            y[i + j] = y0;
+        }
+
+        /* the newest N values of w back into the ring */
+        memcpy(s->w, wl + m - N, N * sizeof(double));
+        memcpy(s->w + N, wl + m - N, N * sizeof(double));
+        s->pos = N - 1;
+    }
+}
+
+/*
+ * canfltr_block_q15() - process a block of 16 bit samples in fixed point
+ * s: pointer to the state of the filter
+ * x: n input samples to process (Q15)
+ * y: n output samples, saturated (may be the same buffer as x)
+ *
+ * a direct form I on the histories in s->qx and s->qy, CANFLTR_BLOCK
+ * samples at a time laid out after them like canfltr_block(): the feed
+ * forward sums of the block are independent and done first, the
+ * feedback is added a sample at a time
+ */
+void canfltr_block_q15(struct canfltr *s, const int16_t *x, int16_t *y,
+                       size_t n)
+{
+    const int N = s->N, shift = s->shift;
+    const int32_t *qa = s->qa, *qb = s->qb;
+    const int32_t top = 32767 * 256;
+    int32_t *xl = s->qx + N - 1, *yl = s->qy + N - 1;
+    int64_t acc[CANFLTR_BLOCK], v;
+    size_t i, j, m;
+    int k, M;
+
+    /* a[M..N-1] are zero (M is 1 for an FIR filter) */
+    for (M = N; M > 1 && qa[M - 1] == 0; M--)
+        ;
+    for (i = 0; i < n; i += m) {
+        m = n - i < CANFLTR_BLOCK ? n - i : CANFLTR_BLOCK;
+
+        for (j = 0; j < m; j++)
+            xl[j] = (int32_t)x[i + j] * 256;
+        for (j = 0; j < m; j++) {
+            v = (int64_t)1 << (shift - 1);      /* (to round) */
+            for (k = 0; k < N; k++)
+                v += (int64_t)qb[k] * xl[(ptrdiff_t)j - k];
+            acc[j] = v;
+        }
+
+        for (j = 0; j < m; j++) {
+            v = acc[j];
+            for (k = 1; k < M; k++)
+                v -= (int64_t)qa[k] * yl[(ptrdiff_t)j - k];
+            v >>= shift;
+            v = v > top ? top : v < -top ? -top : v;
+            yl[j] = (int32_t)v;
+            y[i + j] = (int16_t)((v + 128) >> 8);
+        }
+
+        /* the newest N - 1 values back to the start */
+        memmove(s->qx, xl + m - (N - 1), (N - 1) * sizeof(int32_t));
+        memmove(s->qy, yl + m - (N - 1), (N - 1) * sizeof(int32_t));
+    }
+}
@@ -20,24 +20,72 @@
  *          |       [z]  b2   |
  *           ----<|--|--|>----
  *             -a2  w2
+ *
+ * w is a mirrored ring buffer: each value is stored at pos and pos + N
+ * so the last N values are always contiguous and the delay line never
+ * shifts.
+ *
+ * canfltr_block_q15() runs the same filter in fixed point on 16 bit PCM,
+ * as a direct form I (the form whose state can't overflow): b and a are
+ * quantized when the filter is created to 32 bit Q(shift) values, with
+ * shift as large as fits them, its histories are the samples with 8 more
+ * fraction bits (Q23 in 32 bits), the sums are 64 bit and the outputs
+ * are rounded and saturated.
  */
 
+#include <stddef.h>
+#include <stdint.h>
+
+/* samples canfltr_block() filters at a time */
+#define CANFLTR_BLOCK 256
+
 /* canonical filter state */
 struct canfltr {
-    double *w;      /* delay line */
+    double *w;      /* delay line (mirrored, 2N) */
+    double *lin;    /* history and block end to end (N - 1 + CANFLTR_BLOCK) */
     double *a;      /* a coefficients - feedback */
     double *b;      /* b coefficients - feed forward */
     int N;          /* length of w, a, b */
+    int pos;        /* newest value in w */
+    int32_t *qa;    /* a in fixed point, Q(shift) */
+    int32_t *qb;    /* b in fixed point, Q(shift) */
+    int32_t *qx;    /* Q23 input history and block (N - 1 + CANFLTR_BLOCK) */
+    int32_t *qy;    /* Q23 output history and block (N - 1 + CANFLTR_BLOCK) */
+    int shift;      /* fraction bits of qa and qb */
 };
 
+struct arena;
+
+/* bytes of one filter: state, coefficients and delay line in one block */
+size_t canfltr_size(int N);
+
 /* allocate and initialize state object */
 struct canfltr *
 canfltr_create(int N, double *b, double *a);
 
-/* free state object */
+/* initialize state object in an arena (freed with the arena), NULL if
+   the arena is full */
+struct canfltr *
+canfltr_create_in(struct arena *ar, int N, double *b, double *a);
+
+/* free state object from canfltr_create() or canfltr_clone() */
 void canfltr_destroy(struct canfltr *s);
 
+/* allocate a copy of a state object (coefficients and delay line) */
+struct canfltr *canfltr_clone(const struct canfltr *s);
+
+/* length of the impulse response if there is no feedback, otherwise 0 */
+int canfltr_taps(const struct canfltr *s);
+
 /* process one sample through canonical filter */
 double canfltr_sample(struct canfltr *state, double x);
 
+/* process a block of samples through canonical filter */
+void canfltr_block(struct canfltr *s, const double *x, double *y, size_t n);
+
+/* process a block of 16 bit samples in fixed point (see above), with a
+   state of its own */
+void canfltr_block_q15(struct canfltr *s, const int16_t *x, int16_t *y,
+                       size_t n);
+
 #endif
@@ -0,0 +1,137 @@
+#include "cascade.h"
+#include "lanes.hpp"
+#include <cstring>
+
+namespace dsp {
+
+// construct cascade of second order sections
+// sos: rows of {b0, b1, b2, a0, a1, a2}, one per section
+// channels: number of interleaved channels
+BiQuadCascade::BiQuadCascade(const std::vector<std::array<double,6>> &sos,
+                             int channels)
+: K(sos.size()), C{channels}, G{(channels + lanes - 1) / lanes},
+  s1(K * G * lanes), s2(K * G * lanes),
+  b0(K), b1(K), b2(K), a1(K), a2(K)
+{
+    for (int k = 0; k < K; k++) {
+        const double a0 = sos[k][3];
+        b0[k] = sos[k][0] / a0;
+        b1[k] = sos[k][1] / a0;
+        b2[k] = sos[k][2] / a0;
+        a1[k] = sos[k][4] / a0;
+        a2[k] = sos[k][5] / a0;
+    }
+}
+
+// change the number of channels, starting every section from rest
+// channels: number of interleaved channels
+void BiQuadCascade::SetChannels(int channels)
+{
+    C = channels;
+    G = (channels + lanes - 1) / lanes;
+    s1.assign(K * G * lanes, 0.0);
+    s2.assign(K * G * lanes, 0.0);
+}
+
+// filter one sample of channel 0 using transposed direct form II sections
+// x: input sample to process
+// Return: output sample
+double BiQuadCascade::ProcessSample(double x)
+{
+    for (int k = 0; k < K; k++) {
+        double &z1 = s1[k * G * lanes];
+        double &z2 = s2[k * G * lanes];
+        double y = b0[k] * x + z1;
+
+        z1 = b1[k] * x - a1[k] * y + z2;
+        z2 = b2[k] * x - a2[k] * y;
+        x = y;
+    }
+    return x;
+}
+
+// filter n interleaved samples (n / C frames)
+// x: input samples
+// y: output samples (may be the same buffer as x)
+void BiQuadCascade::ProcessBlock(const double *x, double *y, std::size_t n)
+{
+    ProcessFrames(x, y, n / C);
+}
+
+// filter n frames of interleaved samples
+// x: input frames
+// y: output frames (may be the same buffer as x)
+void BiQuadCascade::ProcessFrames(const double *x, double *y, std::size_t n)
+{
+    if (C == 1)
+        ProcessMono(x, y, n);
+    else
+        ProcessLanes(x, y, n);
+}
+
+// one channel: run the whole block through each section in turn
+void BiQuadCascade::ProcessMono(const double *x, double *y, std::size_t n)
+{
+    if (K == 0 && x != y)
+        std::memcpy(y, x, n * sizeof(double));
+
+    for (int k = 0; k < K; k++) {
+        const double B0 = b0[k], B1 = b1[k], B2 = b2[k];
+        const double A1 = a1[k], A2 = a2[k];
+        const double *in = k == 0 ? x : y;
+        double z1 = s1[k * G * lanes], z2 = s2[k * G * lanes];
+
+        for (std::size_t i = 0; i < n; i++) {
+            const double xi = in[i];
+            const double yi = B0 * xi + z1;
+
+            z1 = B1 * xi - A1 * yi + z2;
+            z2 = B2 * xi - A2 * yi;
+            y[i] = yi;
+        }
+        s1[k * G * lanes] = z1;
+        s2[k * G * lanes] = z2;
+    }
+}
+
+// several channels: rearrange the frames into groups of lanes, then run
+// each group through each section with the lanes side by side
+void BiQuadCascade::ProcessLanes(const double *x, double *y, std::size_t n)
+{
+    scratch.assign(G * n * lanes, 0.0);
+
+    for (std::size_t i = 0; i < n; i++)
+        for (int c = 0; c < C; c++)
+            scratch[((c / lanes) * n + i) * lanes + c % lanes] = x[i * C + c];
+
+    for (int g = 0; g < G; g++) {
+        double *u = &scratch[g * n * lanes];
+
+        for (int k = 0; k < K; k++) {
+            const double B0 = b0[k], B1 = b1[k], B2 = b2[k];
+            const double A1 = a1[k], A2 = a2[k];
+            double *z1p = &s1[(k * G + g) * lanes];
+            double *z2p = &s2[(k * G + g) * lanes];
+            Lanes z1, z2, xi, yi;
+
+            // memcpy for unaligned loads and stores of the lanes
+            std::memcpy(&z1, z1p, sizeof(z1));
+            std::memcpy(&z2, z2p, sizeof(z2));
+            for (std::size_t i = 0; i < n; i++) {
+                std::memcpy(&xi, u + i * lanes, sizeof(xi));
+                yi = B0 * xi + z1;
+                z1 = B1 * xi - A1 * yi + z2;
+                z2 = B2 * xi - A2 * yi;
+                std::memcpy(u + i * lanes, &yi, sizeof(yi));
+            }
+            std::memcpy(z1p, &z1, sizeof(z1));
+            std::memcpy(z2p, &z2, sizeof(z2));
+        }
+    }
+
+    for (std::size_t i = 0; i < n; i++)
+        for (int c = 0; c < C; c++)
+            y[i * C + c] = scratch[((c / lanes) * n + i) * lanes + c % lanes];
+}
+
+} // namespace dsp
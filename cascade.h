@@ -0,0 +1,78 @@
+#ifndef DSP_CASCADE_H_INCLUDED
+#define DSP_CASCADE_H_INCLUDED
+
+#include "filter.hpp"
+#include <array>
+#include <vector>
+
+/************************************************************************
+* cascade of second order sections (SOS)                                *
+*                                                                       *
+* H(z) = H0(z)·H1(z)· ... ·HK-1(z)                                      *
+*                                                                       *
+* each section is a biquad in transposed direct form II:                *
+*                                                                       *
+*             b0      s1[n]                                             *
+* x[n] ----┬--|>--→(+)-------┬---→ y[n]                                 *
+*          |        ↑        |                                          *
+*          |       [z]       |                                          *
+*          |  b1    ↑   -a1  |                                          *
+*          ├--|>--→(+)←--<|--┤                                          *
+*          |        ↑ s2[n]  |                                          *
+*          |       [z]       |                                          *
+*          |  b2    ↑   -a2  |                                          *
+*          └--|>--→(+)←--<|--┘                                          *
+*                                                                       *
+* a high order filter split into sections is far less sensitive to      *
+* coefficient rounding than one large DirectForm2.                      *
+*                                                                       *
+* coefficients are stored structure of arrays (one array per           *
+* coefficient, indexed by section). Blocks are filtered one section at  *
+* a time so a section's state stays in registers for the whole block.   *
+* With more than one channel the filter works on interleaved frames     *
+* and runs `lanes` channels side by side through each section, which    *
+* the compiler turns into SIMD arithmetic.                              *
+*************************************************************************/
+
+namespace dsp {
+
+class BiQuadCascade: public Filter {
+    int K;                          // number of sections
+    int C;                          // number of channels
+    int G;                          // groups of lanes covering C
+    std::vector<double> s1, s2;     // state [section][group][lane]
+    std::vector<double> scratch;    // frames rearranged [group][n][lane]
+
+    void ProcessMono(const double *x, double *y, std::size_t n);
+    void ProcessLanes(const double *x, double *y, std::size_t n);
+public:
+    static const int lanes = 4;     // channels filtered together (dsp::lanes)
+
+    // section coefficients, normalized so that a0 = 1
+    // (change values freely but don't resize)
+    std::vector<double> b0, b1, b2, a1, a2;
+
+    // sos: one {b0, b1, b2, a0, a1, a2} row per section
+    // channels: number of interleaved channels the blocks hold
+    BiQuadCascade(const std::vector<std::array<double,6>> &sos,
+                  int channels = 1);
+
+    int Sections() const { return K; }
+    int Channels() const { return C; }
+    // change the number of interleaved channels (clears the state)
+    void SetChannels(int channels);
+
+    // process one sample of channel 0 through all the sections
+    double ProcessSample(double x);
+    // process n samples: n / Channels() interleaved frames (the Filter
+    // contract, so a multichannel cascade can go in a Chain or Graph)
+    void ProcessBlock(const double *x, double *y, std::size_t n);
+    // process n frames of Channels() interleaved samples (for
+    // wave_options.interleaved, which passes frames)
+    void ProcessFrames(const double *x, double *y, std::size_t n);
+    BiQuadCascade *Clone() const { return new BiQuadCascade(*this); }
+};
+
+}
+
+#endif
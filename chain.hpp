@@ -0,0 +1,97 @@
+#ifndef DSP_CHAIN_HPP_INCLUDED
+#define DSP_CHAIN_HPP_INCLUDED
+
+#include "filter.hpp"
+#include <cstddef>
+
+namespace dsp {
+
+/*
+ * Chain<Stages...> - filters in series composed at compile time
+ *
+ *  dsp::Chain<dsp::BiQuad, dsp::BiQuad, dsp::Circular> f{lo, hi, reverb};
+ *
+ * x[n] --→ [stage 0] --→ [stage 1] --→ ... --→ [stage N-1] --→ y[n]
+ *
+ * Every stage is stored by value and called by its qualified name
+ * (Stage::ProcessBlock), so there is no virtual dispatch between stages.
+ * A block runs through each stage's own ProcessBlock in turn, which keeps
+ * the block in cache and lets each stage use its native block loop.
+ * Use dsp::Get<I>(chain) to reach stage I, e.g. to change coefficients.
+ */
+template <typename... Stages>
+class Chain;
+
+// empty chain: y[n] = x[n]
+template <>
+class Chain<>: public Filter {
+public:
+    double ProcessSample(double x) { return x; }
+    void ProcessBlock(const double *x, double *y, std::size_t n) {
+        if (x != y)
+            for (std::size_t i = 0; i < n; i++)
+                y[i] = x[i];
+    }
+    Chain *Clone() const { return new Chain(*this); }
+    std::size_t ImpulseLength() const { return 1; }
+    std::size_t Latency() const { return 0; }
+};
+
+template <typename First, typename... Rest>
+class Chain<First, Rest...>: public Filter {
+public:
+    First first;            // first stage
+    Chain<Rest...> rest;    // the remaining stages
+
+    Chain(First first, Rest... rest) : first(first), rest(rest...) {}
+
+    // process one sample through every stage
+    double ProcessSample(double x) {
+        return rest.Chain<Rest...>::ProcessSample(first.First::ProcessSample(x));
+    }
+
+    // process a block through every stage
+    void ProcessBlock(const double *x, double *y, std::size_t n) {
+        first.First::ProcessBlock(x, y, n);
+        rest.Chain<Rest...>::ProcessBlock(y, y, n);
+    }
+
+    Chain *Clone() const { return new Chain(*this); }
+
+    // FIR only if every stage is, the lengths add (less one per stage)
+    std::size_t ImpulseLength() const {
+        const std::size_t f = first.First::ImpulseLength();
+        const std::size_t r = rest.Chain<Rest...>::ImpulseLength();
+        return f && r ? f + r - 1 : 0;
+    }
+
+    // the stages' latencies add
+    std::size_t Latency() const {
+        return first.First::Latency() + rest.Chain<Rest...>::Latency();
+    }
+};
+
+// helper for Get()
+template <std::size_t I>
+struct ChainGet {
+    template <typename C>
+    static auto get(C &c) -> decltype(ChainGet<I - 1>::get(c.rest)) {
+        return ChainGet<I - 1>::get(c.rest);
+    }
+};
+
+template <>
+struct ChainGet<0> {
+    template <typename C>
+    static auto get(C &c) -> decltype((c.first)) { return c.first; }
+};
+
+// reference to stage I of a chain
+template <std::size_t I, typename C>
+auto Get(C &c) -> decltype(ChainGet<I>::get(c)) {
+    return ChainGet<I>::get(c);
+}
+
+} // namespace dsp
+
+#endif
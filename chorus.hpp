@@ -0,0 +1,65 @@
+#ifndef DSP_CHORUS_HPP_INCLUDED
+#define DSP_CHORUS_HPP_INCLUDED
+
+#include "filter.hpp"
+#include "delay.h"
+#include "oscillator.h"
+#include <vector>
+
+namespace dsp {
+
+/*
+ * Chorus - many voices reading one delay line at modulated taps
+ *
+ *  dsp::Chorus c{16, 1000, 44100, 0.3};   // 16 voices, up to 1000 samples
+ *
+ * every voice has its own LFO, at the same rate but spread evenly in
+ * phase, sweeping its tap between 3 and N - 4 samples. All the taps are
+ * read with one Delay::Taps() call per sample, so the interpolation of
+ * a group of voices is done side by side. The output is half the input
+ * and half the average of the voices.
+ */
+class Chorus: public Filter {
+    Delay w;                        // delay line
+    int N;                          // length of delay line
+    std::vector<Oscillator> lfo;    // one per voice
+    std::vector<double> at;         // tap of each voice this sample
+    std::vector<double> taps;       // output of each voice
+public:
+    // voices: number of taps, nmax: length of the delay line,
+    // fs: sample rate, rate: LFO frequency in Hz
+    Chorus(int voices, int nmax, int fs, double rate)
+    : w(nmax), N{nmax}, at(voices), taps(voices) {
+        for (int v = 0; v < voices; v++)
+            lfo.emplace_back(rate, fs, 2.0 * pi * v / voices);
+    }
+
+    // process one sample
+    double ProcessSample(double x) {
+        const double mid = 0.5 * (N - 1), depth = 0.5 * (N - 1) - 3.0;
+        const std::size_t V = lfo.size();
+        double sum = 0.0;
+
+        w[0] = x;
+        for (std::size_t v = 0; v < V; v++)
+            at[v] = mid + depth * lfo[v].Next();
+        w.Taps(at.data(), taps.data(), V);
+        for (std::size_t v = 0; v < V; v++)
+            sum += taps[v];
+        w.Shift();
+
+        return 0.5 * x + 0.5 * sum / V;
+    }
+
+    Chorus *Clone() const { return new Chorus(*this); }
+
+    // process a block of samples
+    void ProcessBlock(const double *x, double *y, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++)
+            y[i] = Chorus::ProcessSample(x[i]);
+    }
+};
+
+}
+
+#endif
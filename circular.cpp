@@ -2,8 +2,18 @@
 
 namespace dsp {
 
-Circular::Circular(int n)
-: w_(n), offset{}, N{n}
+// smallest power of two >= n
+static int PowerOfTwo(int n)
+{
+    int m = 1;
+    while (m < n)
+        m <<= 1;
+    return m;
+}
+
+template <typename T>
+BasicCircular<T>::BasicCircular(int n)
+: w_(PowerOfTwo(n)), offset{}, N{n}, mask{PowerOfTwo(n) - 1}
 {
 }
 
@@ -13,9 +23,10 @@ Circular::Circular(int n)
  *
  * Return: output sample
  */
-double Circular::ProcessSample(double x)
+template <typename T>
+T BasicCircular<T>::ProcessSample(T x)
 {
-    double y, w0;
+    T y, w0;
 
     // c is a coefficient from sparse arrays a and b
     //  .first is the coefficient index
@@ -28,7 +39,7 @@ double Circular::ProcessSample(double x)
     w(0) = w0;
 
     // feed forward terms
-    y = 0.0;
+    y = 0;
     for (auto c : b)
         y += c.second * w(c.first);
 
@@ -36,4 +47,85 @@ double Circular::ProcessSample(double x)
     return y;
 }
 
+/*
+ * Circular::Flatten() copy the taps out of the maps a and b
+ * (std::map iterates in index order, so the arrays are sorted and the
+ * sums are accumulated in the same order as ProcessSample)
+ */
+template <typename T>
+void BasicCircular<T>::Flatten()
+{
+    a_indx.clear();
+    a_val.clear();
+    for (auto c : a) {
+        a_indx.push_back(c.first);
+        a_val.push_back(c.second);
+    }
+    b_indx.clear();
+    b_val.clear();
+    for (auto c : b) {
+        b_indx.push_back(c.first);
+        b_val.push_back(c.second);
+    }
+    a_ptr.resize(a_indx.size());
+    b_ptr.resize(b_indx.size());
+}
+
+/*
+ * Circular::ProcessBlock() process a block of samples
+ * x: n input samples
+ * y: n output samples (may be the same buffer as x)
+ */
+template <typename T>
+void BasicCircular<T>::ProcessBlock(const T *x, T *y, std::size_t n)
+{
+    Flatten();
+
+    const int Na = a_indx.size(), Nb = b_indx.size();
+    std::size_t i = 0;
+
+    while (i < n) {
+        // w(k) steps down through w_ as the line shifts, so a run can go
+        // on until w(0) or any tap reaches the bottom of the buffer
+        std::size_t run = n - i;
+        if (run > std::size_t(offset) + 1)
+            run = offset + 1;
+        for (int k = 0; k < Na; k++) {
+            const int pos = (offset + a_indx[k]) & mask;
+            if (run > std::size_t(pos) + 1)
+                run = pos + 1;
+            a_ptr[k] = &w_[pos];
+        }
+        for (int k = 0; k < Nb; k++) {
+            const int pos = (offset + b_indx[k]) & mask;
+            if (run > std::size_t(pos) + 1)
+                run = pos + 1;
+            b_ptr[k] = &w_[pos];
+        }
+
+        T * const w0p = &w_[offset];
+        T * const * const ap = a_ptr.data();
+        T * const * const bp = b_ptr.data();
+        const T *av = a_val.data(), *bv = b_val.data();
+
+        for (std::size_t j = 0; j < run; j++) {
+            T w0 = x[i + j];
+            for (int k = 0; k < Na; k++)
+                w0 -= av[k] * ap[k][-std::ptrdiff_t(j)];
+            w0p[-std::ptrdiff_t(j)] = w0;
+
+            T yj = 0;
+            for (int k = 0; k < Nb; k++)
+                yj += bv[k] * bp[k][-std::ptrdiff_t(j)];
+            y[i + j] = yj;
+        }
+
+        offset = (offset - int(run)) & mask;
+        i += run;
+    }
+}
+
+template class BasicCircular<float>;
+template class BasicCircular<double>;
+
 }
@@ -15,29 +15,56 @@ namespace dsp {
  * The shift operation is also efficient since a pointer (offset) is
  * decremented instead of moving values down through all the taps.
  * The offset is used to compute where w[0] actually is within the w_ buffer.
+ * w_ is rounded up to a power of two so wrapping is a mask, not a modulo.
+ *
+ * ProcessBlock() copies the taps out of the maps into flat arrays sorted
+ * by index, then filters runs of samples between the points where the
+ * offset or a tap wraps around w_, so within a run every tap is a fixed
+ * pointer stepping down through the buffer.
+ *
+ * T is the sample and coefficient type, Circular is the double version.
+ * A float delay line is half the size, which matters for long reverbs.
  */
-class Circular: public Filter {
-    std::vector<double> w_;     // delay line buffer
+template <typename T>
+class BasicCircular: public BasicFilter<T> {
+    std::vector<T> w_;          // delay line buffer
     int offset;                 // current start of buffer within w
     int N;                      // length of delay line
+    int mask;                   // w_.size() - 1
+    std::vector<int> a_indx;    // flattened a and b taps for ProcessBlock
+    std::vector<int> b_indx;
+    std::vector<T> a_val;
+    std::vector<T> b_val;
+    std::vector<T *> a_ptr;     // where each tap is in w_ during a run
+    std::vector<T *> b_ptr;
+
+    // copy the taps in a and b to the flat arrays
+    void Flatten();
 public:
-    std::map<int, double> b;    // feedforward coefficients
-    std::map<int, double> a;    // feedback coefficients
+    std::map<int, T> b;         // feedforward coefficients
+    std::map<int, T> a;         // feedback coefficients
 
     // construct size n delay line
-    Circular(int n);
+    BasicCircular(int n);
     // advance delay line by one sample
-    void Shift() { if (--offset < 0) offset += N; }
+    void Shift() { offset = (offset - 1) & mask; }
     // retreat delay line by one sample
-    void Unshift() { if (++offset > N) offset -= N; }
-    // return reference to w[n] (offset and modulo wrap w[n])
-    double& operator[](int n) { return w_[(offset + n) % N]; }
-    // return reference to w[n] (offset and modulo wrap w[n])
-    double& w(int n) { return w_[(offset + n) % N]; }
+    void Unshift() { offset = (offset + 1) & mask; }
+    // return reference to w[n] (offset and wrap w[n])
+    T& operator[](int n) { return w_[(offset + n) & mask]; }
+    // return reference to w[n] (offset and wrap w[n])
+    T& w(int n) { return w_[(offset + n) & mask]; }
     // process one sample through filter
-    double ProcessSample(double x);
+    T ProcessSample(T x);
+    // process a block of samples through filter
+    void ProcessBlock(const T *x, T *y, std::size_t n);
+    // copy of the filter and its delay line
+    BasicCircular *Clone() const { return new BasicCircular(*this); }
 };
 
+// (instantiated for float and double in circular.cpp)
+typedef BasicCircular<double> Circular;
+
 } // namespace dsp
 
 #endif
@@ -1,7 +1,78 @@
 #include "cirfltr.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <string.h>
 
+/* length of w: N rounded up to a power of two */
+static int cirfltr_len(int N)
+{
+    int len = 1;
+
+    while (len < N)
+        len <<= 1;
+    return len;
+}
+
+/*
+ * cirfltr_size() - bytes a circular filter takes
+ * N:      length of w
+ * Nb:     length of b
+ * Na:     length of a
+ *
+ * the state, a, b, the tap pointers and w each start on a cache line
+ *
+ * Return: the size of the block cirfltr_create() allocates
+ */
+size_t cirfltr_size(int N, int Nb, int Na)
+{
+    return ARENA_ROUND(sizeof(struct cirfltr))
+           + ARENA_ROUND(Na * sizeof(struct cirtap))
+           + ARENA_ROUND(Nb * sizeof(struct cirtap))
+           + ARENA_ROUND((Na + Nb + 1) * sizeof(double *))
+           + ARENA_ROUND(cirfltr_len(N) * sizeof(double));
+}
+
+/*
+ * cirfltr_init() - lay a circular filter out in a zeroed block
+ * mem: cirfltr_size(N, Nb, Na) zeroed bytes, cache line aligned (or NULL)
+ * the rest: as for cirfltr_create()
+ *
+ * Return: the state structure at the start of mem
+ */
+static struct cirfltr *
+cirfltr_init(void *mem, int N, int Nb, const int *b_indx, const double *b_val,
+             int Na, const int *a_indx, const double *a_val)
+{
+    unsigned char *p = mem;
+    struct cirfltr *s = mem;
+    int n;
+
+    if (!mem)
+        return NULL;
+    p += ARENA_ROUND(sizeof(struct cirfltr));
+    s->a = (struct cirtap *)p;
+    p += ARENA_ROUND(Na * sizeof(struct cirtap));
+    s->b = (struct cirtap *)p;
+    p += ARENA_ROUND(Nb * sizeof(struct cirtap));
+    s->ptr = (double **)p;
+    p += ARENA_ROUND((Na + Nb + 1) * sizeof(double *));
+    s->w = (double *)p;
+    s->N = N;
+    s->mask = cirfltr_len(N) - 1;
+    s->Na = Na;
+    s->Nb = Nb;
+    for (n = 0; n < Na; n++) {
+        s->a[n].val = a_val[n];
+        s->a[n].indx = a_indx[n];
+    }
+    for (n = 0; n < Nb; n++) {
+        s->b[n].val = b_val[n];
+        s->b[n].indx = b_indx[n];
+    }
+    s->offset = 0;
+    return s;
+}
+
 /*
  * cirfltr_create() - allocate and initialize a circular filter
  * N:      length of w
@@ -12,42 +83,38 @@
  * a_val:  a values;
  * a_indx: a indices;
  *
- * Return: the initialized state structure for the filter
+ * Return: the initialized state structure for the filter, in one block
  */
 struct cirfltr *
 cirfltr_create(int N, int Nb, int *b_indx, double *b_val,
                int Na, int *a_indx, double *a_val)
 {
-    struct cirfltr *s;
-    s = malloc(sizeof(struct cirfltr));
-    s->N = N;
-    s->Na = Na;
-    s->Nb = Nb;
-    s->w = calloc(N, sizeof(double));
-    s->a_indx = calloc(Na, sizeof(int));
-    s->a_val  = calloc(Na, sizeof(double));
-    s->b_indx = calloc(Nb, sizeof(int));
-    s->b_val  = calloc(Nb, sizeof(double));
-    memcpy(s->a_indx, a_indx, Na * sizeof(int));
-    memcpy(s->a_val,  a_val,  Na * sizeof(double));
-    memcpy(s->b_indx, b_indx, Nb * sizeof(int));
-    memcpy(s->b_val,  b_val,  Nb * sizeof(double));
-    s->offset = 0;
-    return s;
+    return cirfltr_init(arena_aligned(cirfltr_size(N, Nb, Na)),
+                        N, Nb, b_indx, b_val, Na, a_indx, a_val);
+}
+
+/*
+ * cirfltr_create_in() - initialize a circular filter in an arena
+ * ar: arena with cirfltr_size(N, Nb, Na) bytes left
+ * the rest: as for cirfltr_create()
+ *
+ * Return: the filter (freed with the arena), NULL if the arena is full
+ */
+struct cirfltr *
+cirfltr_create_in(struct arena *ar, int N, int Nb, int *b_indx,
+                  double *b_val, int Na, int *a_indx, double *a_val)
+{
+    return cirfltr_init(arena_alloc(ar, cirfltr_size(N, Nb, Na)),
+                        N, Nb, b_indx, b_val, Na, a_indx, a_val);
 }
 
 /*
  * cirfltr_destroy() - free memory allocated for circular filter
- * s: pointer to filter state
+ * s: pointer to filter state from cirfltr_create()
  */
 void cirfltr_destroy(struct cirfltr *s)
 {
-    free(s->b_val);
-    free(s->b_indx);
-    free(s->a_val);
-    free(s->a_indx);
-    free(s->w);
-    free(s);
+    arena_aligned_free(s);
 }
 
 /*
@@ -58,9 +125,7 @@ void cirfltr_destroy(struct cirfltr *s)
  */
 void cirfltr_dec(struct cirfltr *s)
 {
-    s->offset--;
-    if (s->offset < 0)
-        s->offset += s->N;
+    s->offset = (s->offset - 1) & s->mask;
 }
 
 /*
@@ -71,9 +136,7 @@ void cirfltr_dec(struct cirfltr *s)
  */
 void cirfltr_inc(struct cirfltr *s)
 {
-    s->offset++;
-    if (s->offset > s->N)
-        s->offset -= s->N;
+    s->offset = (s->offset + 1) & s->mask;
 }
 
 /*
@@ -85,7 +148,7 @@ void cirfltr_inc(struct cirfltr *s)
  */
 double * cirfltr_w(struct cirfltr *s, int n)
 {
-    return s->w + ((s->offset + n) % s->N);
+    return s->w + ((s->offset + n) & s->mask);
 }
 
 /*
@@ -103,14 +166,68 @@ double cirfltr_sample(struct cirfltr *fs, double x)
 
     w0 = x;
     for (n = 0; n < fs->Na; n++)
-        w0 -= fs->a_val[n] * *cirfltr_w(fs, fs->a_indx[n]);
+        w0 -= fs->a[n].val * *cirfltr_w(fs, fs->a[n].indx);
     *cirfltr_w(fs, 0) = w0;
 
     y = 0.0;
     for (n = 0; n < fs->Nb; n++)
-        y += fs->b_val[n] * *cirfltr_w(fs, fs->b_indx[n]);
+        y += fs->b[n].val * *cirfltr_w(fs, fs->b[n].indx);
 
     cirfltr_dec(fs);
 
     return y;
 }
+
+/*
+ * cirfltr_block() - process a block of samples through the canonical filter
+ * fs: pointer to the state of the filter
+ * x: n input samples to process
+ * y: n output samples (may be the same buffer as x)
+ *
+ * w[k] steps down through the buffer as the delay line shifts. Samples
+ * are processed in runs that end where w[0] or any tap would wrap around
+ * the bottom of the buffer, so within a run each tap is a fixed pointer
+ * indexed by the position in the run.
+ */
+void cirfltr_block(struct cirfltr *fs, const double *x, double *y, size_t n)
+{
+    const int Na = fs->Na, Nb = fs->Nb;
+    double **ap = fs->ptr, **bp = fs->ptr + Na;
+    double *w0p, w0, yj;
+    size_t i = 0, j, run;
+    int k, pos;
+
+    while (i < n) {
+        run = n - i;
+        if (run > (size_t)fs->offset + 1)
+            run = fs->offset + 1;
+        for (k = 0; k < Na; k++) {
+            pos = (fs->offset + fs->a[k].indx) & fs->mask;
+            if (run > (size_t)pos + 1)
+                run = pos + 1;
+            ap[k] = fs->w + pos;
+        }
+        for (k = 0; k < Nb; k++) {
+            pos = (fs->offset + fs->b[k].indx) & fs->mask;
+            if (run > (size_t)pos + 1)
+                run = pos + 1;
+            bp[k] = fs->w + pos;
+        }
+        w0p = fs->w + fs->offset;
+
+        for (j = 0; j < run; j++) {
+            w0 = x[i + j];
+            for (k = 0; k < Na; k++)
+                w0 -= fs->a[k].val * *(ap[k] - j);
+            *(w0p - j) = w0;
+
+            yj = 0.0;
+            for (k = 0; k < Nb; k++)
+                yj += fs->b[k].val * *(bp[k] - j);
+            y[i + j] = yj;
+        }
+
+        fs->offset = (fs->offset - (int)run) & fs->mask;
+        i += run;
+    }
+}
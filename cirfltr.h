@@ -6,27 +6,48 @@
  * since w is likely to be a large buffer, the arrays for
  * a and b are sparse thus filtering is very efficient if most
  * the values for a and b are zero.
+ * w is rounded up to a power of two so wrapping is a mask, not a modulo.
+ * Each tap keeps its index next to its value, so reading a tap touches
+ * one cache line, and the whole filter is a single block.
  */
 
+#include <stddef.h>
+
+/* a coefficient and where it taps w, side by side in one cache line */
+struct cirtap {
+    double val;     /* coefficient value */
+    int indx;       /* coefficient index */
+};
+
 /* circular filter state */
 struct cirfltr {
-    double *w;      /* delay line */
-    double *a_val;  /* a coefficient values */
-    double *b_val;  /* b coefficient values */
-    int *a_indx;    /* a coefficient index */
-    int *b_indx;    /* b coefficient index */
+    double *w;          /* delay line */
+    struct cirtap *a;   /* a coefficients */
+    struct cirtap *b;   /* b coefficients */
     int Na;         /* length of a */
     int Nb;         /* length of b */
-    int N;          /* length of w */
+    int N;          /* length of delay line */
+    int mask;       /* length of w minus one (a power of two minus one) */
     int offset;     /* current start of buffer within w */
+    double **ptr;   /* where each tap is in w during a run (a then b) */
 };
 
+struct arena;
+
+/* bytes of one filter: state, taps and delay line in one block */
+size_t cirfltr_size(int N, int Nb, int Na);
+
 /* allocate and initialize */
 struct cirfltr *
 cirfltr_create(int N, int Nb, int *b_indx, double *b_val,
                int Na, int *a_indx, double *a_val);
 
-/* free state object */
+/* initialize in an arena (freed with the arena), NULL if it is full */
+struct cirfltr *
+cirfltr_create_in(struct arena *ar, int N, int Nb, int *b_indx,
+                  double *b_val, int Na, int *a_indx, double *a_val);
+
+/* free state object from cirfltr_create() */
 void cirfltr_destroy(struct cirfltr *s);
 
 /* decrement offset within w buffer (advance delay line by one) */
@@ -41,4 +62,7 @@ double * cirfltr_w(struct cirfltr *s, int n);
 /* process one sample through circular filter */
 double cirfltr_sample(struct cirfltr *s, double x);
 
+/* process a block of samples through circular filter */
+void cirfltr_block(struct cirfltr *s, const double *x, double *y, size_t n);
+
 #endif /* CIRCULAR_FILTER_H */
@@ -3,68 +3,121 @@ CXX = g++
 CFLAGS = -O2 -std=c89 -pedantic -Wall
 CXXFLAGS = -g -O2 -std=c++11 -pedantic -Wall
 LFLAGS =
-OBJSBASIC = wavdump.exe wavwrite.exe
+OBJSBASIC = wavdump.exe wavwrite.exe wavresample.exe
 OBJSFLTRC = wavcanfltr.exe wav_reverb.exe wav_flanger.exe
-OBJSFLTRCPP = wavdir1.exe wavdir2.exe wavdir2t.exe wavbiquad.exe wavReverb.exe wavFlanger.exe
+OBJSFLTRCPP = wavdir1.exe wavdir2.exe wavdir2t.exe wavbiquad.exe wavcascade.exe wavconvolve.exe wavReverb.exe wavFlanger.exe wavbatch.exe wavlive.exe wavgraph.exe wavgate.exe
+WAVEOBJS = wave.o mapfile.o convert.o thread.o resample.o
 OBJS = $(OBJSBASIC) $(OBJSFLTRC) $(OBJSFLTRCPP)
 
 all: $(OBJS)
 
-wavdir1.exe: wavdir1.cpp wave.o directform.o
+wavdir1.exe: wavdir1.cpp $(WAVEOBJS) directform.o fixed.o
 	$(CXX) $(CXXFLAGS) -o $@ $^ $(LFLAGS)
-wavdir2.exe: wavdir2.cpp wave.o directform.o
+wavdir2.exe: wavdir2.cpp $(WAVEOBJS) directform.o fixed.o
 	$(CXX) $(CXXFLAGS) -o $@ $^ $(LFLAGS)
-wavdir2t.exe: wavdir2t.cpp wave.o directform.o
+wavdir2t.exe: wavdir2t.cpp $(WAVEOBJS) directform.o fixed.o
 	$(CXX) $(CXXFLAGS) -o $@ $^ $(LFLAGS)
-wavbiquad.exe: wavbiquad.cpp wave.o biquad.o
+wavbiquad.exe: wavbiquad.cpp $(WAVEOBJS) biquad.o fixed.o
 	$(CXX) $(CXXFLAGS) -o $@ $^ $(LFLAGS)
-wavReverb.exe: wavReverb.cpp wave.o circular.o
+wavcascade.exe: wavcascade.cpp $(WAVEOBJS) cascade.o
 	$(CXX) $(CXXFLAGS) -o $@ $^ $(LFLAGS)
-wavFlanger.exe: wavFlanger.cpp wave.o delay.o
+wavconvolve.exe: wavconvolve.cpp $(WAVEOBJS) convolver.o fft.o
+	$(CXX) $(CXXFLAGS) -o $@ $^ $(LFLAGS)
+wavReverb.exe: wavReverb.cpp $(WAVEOBJS) circular.o partitioned.o fft.o
+	$(CXX) $(CXXFLAGS) -o $@ $^ $(LFLAGS)
+wavFlanger.exe: wavFlanger.cpp $(WAVEOBJS) delay.o oscillator.o
+	$(CXX) $(CXXFLAGS) -o $@ $^ -lm $(LFLAGS)
+wavbench.exe: wavbench.cpp $(WAVEOBJS) biquad.o cascade.o directform.o circular.o delay.o oscillator.o convolver.o partitioned.o stft.o fft.o canfltr.o cirfltr.o arena.o fixed.o
+	$(CXX) $(CXXFLAGS) -o $@ $^ -lm $(LFLAGS)
+wavbatch.exe: wavbatch.cpp $(WAVEOBJS) biquad.o cascade.o directform.o circular.o delay.o oscillator.o fixed.o
+	$(CXX) $(CXXFLAGS) -o $@ $^ -lm $(LFLAGS)
+wavlive.exe: wavlive.cpp $(WAVEOBJS) realtime.o biquad.o fixed.o
+	$(CXX) $(CXXFLAGS) -o $@ $^ -lm $(LFLAGS)
+wavgraph.exe: wavgraph.cpp $(WAVEOBJS) graph.o circular.o delay.o oscillator.o canfltr.o delayline.o arena.o
+	$(CXX) $(CXXFLAGS) -o $@ $^ -lm $(LFLAGS)
+wavgate.exe: wavgate.cpp $(WAVEOBJS) stft.o fft.o
 	$(CXX) $(CXXFLAGS) -o $@ $^ -lm $(LFLAGS)
 
-directform.o: directform.cpp directform.h
+directform.o: directform.cpp directform.h fixed.h lanes.hpp
+	$(CXX) $(CXXFLAGS) -c $<
+biquad.o: biquad.cpp biquad.h fixed.h
+	$(CXX) $(CXXFLAGS) -c $<
+fixed.o: fixed.cpp fixed.h
+	$(CXX) $(CXXFLAGS) -c $<
+cascade.o: cascade.cpp cascade.h lanes.hpp
+	$(CXX) $(CXXFLAGS) -c $<
+convolver.o: convolver.cpp convolver.h fft.h filter.hpp
+	$(CXX) $(CXXFLAGS) -c $<
+partitioned.o: partitioned.cpp partitioned.h fft.h filter.hpp
+	$(CXX) $(CXXFLAGS) -c $<
+stft.o: stft.cpp stft.h fft.h filter.hpp
 	$(CXX) $(CXXFLAGS) -c $<
-biquad.o: biquad.cpp biquad.h
+fft.o: fft.cpp fft.h filter.hpp
 	$(CXX) $(CXXFLAGS) -c $<
 circular.o: circular.cpp circular.h
 	$(CXX) $(CXXFLAGS) -c $<
-delay.o: delay.cpp delay.h
+delay.o: delay.cpp delay.h lanes.hpp
+	$(CXX) $(CXXFLAGS) -c $<
+realtime.o: realtime.cpp realtime.h ringbuffer.hpp
+	$(CXX) $(CXXFLAGS) -c $<
+graph.o: graph.cpp graph.h filter.hpp filter.h thread.h
+	$(CXX) $(CXXFLAGS) -c $<
+oscillator.o: oscillator.cpp oscillator.h filter.hpp
 	$(CXX) $(CXXFLAGS) -c $<
 
-wavcanfltr.exe: wavcanfltr.o wave.o canfltr.o
+wavcanfltr.exe: wavcanfltr.o $(WAVEOBJS) canfltr.o arena.o
 	$(CC) -o $@ $^ $(LFLAGS)
-wav_flanger.exe: wav_flanger.o wave.o delayline.o
+wav_flanger.exe: wav_flanger.o $(WAVEOBJS) delayline.o oscltr.o arena.o
 	$(CC) -o $@ $^ -lm $(LFLAGS)
-wav_reverb.exe: wav_reverb.o wave.o cirfltr.o
+wav_reverb.exe: wav_reverb.o $(WAVEOBJS) cirfltr.o arena.o
 	$(CC) -o $@ $^ $(LFLAGS)
 
 wavcanfltr.o: wavcanfltr.c wave.h canfltr.h
 	$(CC) $(CFLAGS) -c $<
-wav_flanger.o: wav_flanger.c wave.h delayline.h
+wav_flanger.o: wav_flanger.c wave.h delayline.h oscltr.h
 	$(CC) $(CFLAGS) -c $<
 wav_reverb.o: wav_reverb.c wave.h cirfltr.h
 	$(CC) $(CFLAGS) -c $<
 
-delayline.o: delayline.c delayline.h
+delayline.o: delayline.c delayline.h arena.h
 	$(CC) $(CFLAGS) -c $<
-canfltr.o: canfltr.c canfltr.h
+canfltr.o: canfltr.c canfltr.h arena.h
 	$(CC) $(CFLAGS) -c $<
-cirfltr.o: cirfltr.c cirfltr.h
+cirfltr.o: cirfltr.c cirfltr.h arena.h
+	$(CC) $(CFLAGS) -c $<
+oscltr.o: oscltr.c oscltr.h
+	$(CC) $(CFLAGS) -c $<
+arena.o: arena.c arena.h
 	$(CC) $(CFLAGS) -c $<
 
-wavwrite.exe: wavwrite.o wave.o
+wavwrite.exe: wavwrite.o $(WAVEOBJS)
 	$(CC) -o $@ $^ -lm $(LFLAGS)
-wavdump.exe: wavdump.o wave.o
+wavdump.exe: wavdump.o $(WAVEOBJS)
 	$(CC) -o $@ $^ $(LFLAGS)
+wavresample.exe: wavresample.o $(WAVEOBJS)
+	$(CC) -o $@ $^ -lm $(LFLAGS)
 
 wavwrite.o: wavwrite.c wave.h
 	$(CC) $(CFLAGS) -c $<
-wavdump.o: wavdump.c wave.h
+wavdump.o: wavdump.c wave.h thread.h
+	$(CC) $(CFLAGS) -c $<
+wavresample.o: wavresample.c wave.h
 	$(CC) $(CFLAGS) -c $<
 
-wave.o: wave.c wave.h
+wave.o: wave.c wave.h filter.h mapfile.h convert.h thread.h resample.h
+	$(CC) $(CFLAGS) -c $<
+mapfile.o: mapfile.c mapfile.h
+	$(CC) $(CFLAGS) -c $<
+convert.o: convert.c convert.h
 	$(CC) $(CFLAGS) -c $<
+thread.o: thread.c thread.h
+	$(CC) $(CFLAGS) -c $<
+resample.o: resample.c resample.h
+	$(CC) $(CFLAGS) -c $<
+
+# throughput of every filter and conversion path as CSV
+bench: wavbench.exe
+	wavbench.exe > bench.csv
 
 clean:
-	rm -f *.o $(OBJS)
+	rm -f *.o $(OBJS) wavbench.exe bench.csv
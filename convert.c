@@ -0,0 +1,579 @@
+#include "convert.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONVERT_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+/* kernel set used by the convert_* functions */
+struct convert_kernels {
+    const char *name;
+    void (*pcm16_to_double)(const int16_t *src, double *dst, size_t n);
+    void (*float_to_double)(const float *src, double *dst, size_t n);
+    void (*double_to_pcm16)(const double *src, int16_t *dst, size_t n);
+    void (*double_to_float)(const double *src, float *dst, size_t n);
+    void (*pcm24_to_double)(const uint8_t *src, double *dst, size_t n);
+};
+
+/* the 8 bit formats decode through tables built by convert_init() */
+static double table_pcm8[256];
+static double table_alaw[256];
+static double table_ulaw[256];
+
+/* G.711 A-law code to linear 16 bit (13 bit magnitude, shifted up 3) */
+static int alaw_linear(int a)
+{
+    int t, seg;
+
+    a ^= 0x55;
+    t = (a & 0x0f) << 4;
+    seg = (a & 0x70) >> 4;
+    if (seg == 0)
+        t += 8;
+    else
+        t = (t + 0x108) << (seg - 1);
+    return (a & 0x80) ? t : -t;
+}
+
+/* G.711 mu-law code to linear 16 bit (14 bit magnitude, shifted up 2) */
+static int ulaw_linear(int u)
+{
+    int t;
+
+    u = ~u & 0xff;
+    t = (((u & 0x0f) << 3) + 0x84) << ((u & 0x70) >> 4);
+    return (u & 0x80) ? 0x84 - t : t - 0x84;
+}
+
+/* fill the tables: the codecs scale like 16 bit PCM (float rounded) */
+static void convert_tables(void)
+{
+    float f;
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        f = (i - 128) / 127.0;
+        table_pcm8[i] = f;
+        f = alaw_linear(i) / 32767.0;
+        table_alaw[i] = f;
+        f = ulaw_linear(i) / 32767.0;
+        table_ulaw[i] = f;
+    }
+}
+
+/*
+ * scalar kernels
+ * these define the exact results that the vector kernels must reproduce
+ */
+static void pcm16_to_double_c(const int16_t *src, double *dst, size_t n)
+{
+    size_t i;
+    float f;
+
+    for (i = 0; i < n; i++) {
+        f = src[i] / 32767.0;
+        dst[i] = f;
+    }
+}
+
+static void float_to_double_c(const float *src, double *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        dst[i] = src[i];
+}
+
+/* 24 bit PCM (3 bytes little endian) to double, v times 1 / 8388607
+   (in double, not rounded to float like 16 bit: a multiply, which a
+   vector unit does many times faster than a divide) */
+static const double pcm24_scale = 1.0 / 8388607.0;
+
+static void pcm24_to_double_c(const uint8_t *src, double *dst, size_t n)
+{
+    size_t i;
+    uint32_t u;
+
+    for (i = 0; i < n; i++, src += 3) {
+        u = src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16;
+        dst[i] = ((int32_t)(u ^ 0x800000) - 0x800000) * pcm24_scale;
+    }
+}
+
+static void double_to_pcm16_c(const double *src, int16_t *dst, size_t n)
+{
+    size_t i;
+    double d;
+    float f;
+
+    for (i = 0; i < n; i++) {
+        d = src[i] < -1.0 ? -1.0 : src[i];
+        f = d > 1.0 ? 1.0 : d;
+        dst[i] = (int)(32768.5 + 32767.0 * f) - 32768;
+    }
+}
+
+static void double_to_float_c(const double *src, float *dst, size_t n)
+{
+    size_t i;
+    double d;
+
+    for (i = 0; i < n; i++) {
+        d = src[i] < -1.0 ? -1.0 : src[i];
+        dst[i] = d > 1.0 ? 1.0 : d;
+    }
+}
+
+static const struct convert_kernels kernels_c = {
+    "scalar",
+    pcm16_to_double_c,
+    float_to_double_c,
+    double_to_pcm16_c,
+    double_to_float_c,
+    pcm24_to_double_c
+};
+
+#ifdef CONVERT_X86
+/*
+ * x86 kernels
+ * float division is used instead of multiplying by 1/32767 since
+ * rounding the double quotient to float gives the same result as
+ * the correctly rounded float quotient, so the output stays exact.
+ * max(lo, x) and min(hi, x) pass NaN through like the scalar clamp.
+ */
+__attribute__((target("sse2")))
+static void pcm16_to_double_sse2(const int16_t *src, double *dst, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+        __m128 flo = _mm_div_ps(_mm_cvtepi32_ps(lo), scale);
+        __m128 fhi = _mm_div_ps(_mm_cvtepi32_ps(hi), scale);
+        _mm_storeu_pd(dst + i, _mm_cvtps_pd(flo));
+        _mm_storeu_pd(dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(flo, flo)));
+        _mm_storeu_pd(dst + i + 4, _mm_cvtps_pd(fhi));
+        _mm_storeu_pd(dst + i + 6, _mm_cvtps_pd(_mm_movehl_ps(fhi, fhi)));
+    }
+    pcm16_to_double_c(src + i, dst + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void float_to_double_sse2(const float *src, double *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128 f = _mm_loadu_ps(src + i);
+        _mm_storeu_pd(dst + i, _mm_cvtps_pd(f));
+        _mm_storeu_pd(dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+    }
+    float_to_double_c(src + i, dst + i, n - i);
+}
+
+/* clamp, round to float and quantize two doubles to int32 */
+__attribute__((target("sse2")))
+static __m128i quantize2_sse2(const double *src)
+{
+    const __m128d lo = _mm_set1_pd(-1.0), hi = _mm_set1_pd(1.0);
+    const __m128d scale = _mm_set1_pd(32767.0), bias = _mm_set1_pd(32768.5);
+    __m128d d = _mm_min_pd(hi, _mm_max_pd(lo, _mm_loadu_pd(src)));
+
+    d = _mm_cvtps_pd(_mm_cvtpd_ps(d));
+    d = _mm_add_pd(bias, _mm_mul_pd(scale, d));
+    return _mm_cvttpd_epi32(d);
+}
+
+__attribute__((target("sse2")))
+static void double_to_pcm16_sse2(const double *src, int16_t *dst, size_t n)
+{
+    const __m128i offset = _mm_set1_epi32(32768);
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i a = _mm_unpacklo_epi64(quantize2_sse2(src + i),
+                                       quantize2_sse2(src + i + 2));
+        __m128i b = _mm_unpacklo_epi64(quantize2_sse2(src + i + 4),
+                                       quantize2_sse2(src + i + 6));
+        a = _mm_sub_epi32(a, offset);
+        b = _mm_sub_epi32(b, offset);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(a, b));
+    }
+    double_to_pcm16_c(src + i, dst + i, n - i);
+}
+
+__attribute__((target("sse2")))
+static void double_to_float_sse2(const double *src, float *dst, size_t n)
+{
+    const __m128d lo = _mm_set1_pd(-1.0), hi = _mm_set1_pd(1.0);
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128d a = _mm_min_pd(hi, _mm_max_pd(lo, _mm_loadu_pd(src + i)));
+        __m128d b = _mm_min_pd(hi, _mm_max_pd(lo, _mm_loadu_pd(src + i + 2)));
+        _mm_storeu_ps(dst + i, _mm_movelh_ps(_mm_cvtpd_ps(a),
+                                             _mm_cvtpd_ps(b)));
+    }
+    double_to_float_c(src + i, dst + i, n - i);
+}
+
+static const struct convert_kernels kernels_sse2 = {
+    "sse2",
+    pcm16_to_double_sse2,
+    float_to_double_sse2,
+    double_to_pcm16_sse2,
+    double_to_float_sse2,
+    pcm24_to_double_c       /* (needs a byte shuffle, SSSE3) */
+};
+
+__attribute__((target("avx2")))
+static void pcm16_to_double_avx2(const int16_t *src, double *dst, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(32767.0f);
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m256 f = _mm256_div_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s)),
+                                 scale);
+        _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm256_castps256_ps128(f)));
+        _mm256_storeu_pd(dst + i + 4,
+                         _mm256_cvtps_pd(_mm256_extractf128_ps(f, 1)));
+    }
+    pcm16_to_double_c(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void float_to_double_avx2(const float *src, double *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4)
+        _mm256_storeu_pd(dst + i, _mm256_cvtps_pd(_mm_loadu_ps(src + i)));
+    float_to_double_c(src + i, dst + i, n - i);
+}
+
+/* clamp, round to float and quantize four doubles to int16 range int32 */
+__attribute__((target("avx2")))
+static __m128i quantize4_avx2(const double *src)
+{
+    const __m256d lo = _mm256_set1_pd(-1.0), hi = _mm256_set1_pd(1.0);
+    const __m256d scale = _mm256_set1_pd(32767.0);
+    const __m256d bias = _mm256_set1_pd(32768.5);
+    __m256d d = _mm256_min_pd(hi, _mm256_max_pd(lo, _mm256_loadu_pd(src)));
+
+    d = _mm256_cvtps_pd(_mm256_cvtpd_ps(d));
+    d = _mm256_add_pd(bias, _mm256_mul_pd(scale, d));
+    return _mm_sub_epi32(_mm256_cvttpd_epi32(d), _mm_set1_epi32(32768));
+}
+
+__attribute__((target("avx2")))
+static void double_to_pcm16_avx2(const double *src, int16_t *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i a = quantize4_avx2(src + i);
+        __m128i b = quantize4_avx2(src + i + 4);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packs_epi32(a, b));
+    }
+    double_to_pcm16_c(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static void double_to_float_avx2(const double *src, float *dst, size_t n)
+{
+    const __m256d lo = _mm256_set1_pd(-1.0), hi = _mm256_set1_pd(1.0);
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_loadu_pd(src + i);
+        d = _mm256_min_pd(hi, _mm256_max_pd(lo, d));
+        _mm_storeu_ps(dst + i, _mm256_cvtpd_ps(d));
+    }
+    double_to_float_c(src + i, dst + i, n - i);
+}
+
+/* each group of 3 bytes into the top of a 32 bit lane, sign extended by
+   shifting it down, and converted exactly to double */
+__attribute__((target("avx2")))
+static void pcm24_to_double_avx2(const uint8_t *src, double *dst, size_t n)
+{
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                                          -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m256d scale = _mm256_set1_pd(pcm24_scale);
+    size_t i;
+
+    /* (4 samples from each 16 byte load, the last 4 bytes are spare) */
+    for (i = 0; i + 6 <= n; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+        s = _mm_srai_epi32(_mm_shuffle_epi8(s, shuffle), 8);
+        _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_cvtepi32_pd(s), scale));
+    }
+    pcm24_to_double_c(src + 3 * i, dst + i, n - i);
+}
+
+static const struct convert_kernels kernels_avx2 = {
+    "avx2",
+    pcm16_to_double_avx2,
+    float_to_double_avx2,
+    double_to_pcm16_avx2,
+    double_to_float_avx2,
+    pcm24_to_double_avx2
+};
+#endif /* CONVERT_X86 */
+
+#ifdef CONVERT_NEON
+/*
+ * arm64 kernels
+ * same approach as the x86 kernels, NEON is always present on arm64
+ */
+static void pcm16_to_double_neon(const int16_t *src, double *dst, size_t n)
+{
+    const float32x4_t scale = vdupq_n_f32(32767.0f);
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        int16x8_t s = vld1q_s16(src + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+        lo = vdivq_f32(lo, scale);
+        hi = vdivq_f32(hi, scale);
+        vst1q_f64(dst + i, vcvt_f64_f32(vget_low_f32(lo)));
+        vst1q_f64(dst + i + 2, vcvt_high_f64_f32(lo));
+        vst1q_f64(dst + i + 4, vcvt_f64_f32(vget_low_f32(hi)));
+        vst1q_f64(dst + i + 6, vcvt_high_f64_f32(hi));
+    }
+    pcm16_to_double_c(src + i, dst + i, n - i);
+}
+
+static void float_to_double_neon(const float *src, double *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        float32x4_t f = vld1q_f32(src + i);
+        vst1q_f64(dst + i, vcvt_f64_f32(vget_low_f32(f)));
+        vst1q_f64(dst + i + 2, vcvt_high_f64_f32(f));
+    }
+    float_to_double_c(src + i, dst + i, n - i);
+}
+
+/* clamp, round to float and quantize two doubles to int16 range int32 */
+static int32x2_t quantize2_neon(const double *src)
+{
+    const float64x2_t lo = vdupq_n_f64(-1.0), hi = vdupq_n_f64(1.0);
+    const float64x2_t scale = vdupq_n_f64(32767.0);
+    const float64x2_t bias = vdupq_n_f64(32768.5);
+    float64x2_t d = vminq_f64(hi, vmaxq_f64(lo, vld1q_f64(src)));
+
+    d = vcvt_f64_f32(vcvt_f32_f64(d));
+    d = vaddq_f64(bias, vmulq_f64(scale, d));
+    return vsub_s32(vmovn_s64(vcvtq_s64_f64(d)), vdup_n_s32(32768));
+}
+
+static void double_to_pcm16_neon(const double *src, int16_t *dst, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        int32x4_t a = vcombine_s32(quantize2_neon(src + i),
+                                   quantize2_neon(src + i + 2));
+        int32x4_t b = vcombine_s32(quantize2_neon(src + i + 4),
+                                   quantize2_neon(src + i + 6));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    double_to_pcm16_c(src + i, dst + i, n - i);
+}
+
+static void double_to_float_neon(const double *src, float *dst, size_t n)
+{
+    const float64x2_t lo = vdupq_n_f64(-1.0), hi = vdupq_n_f64(1.0);
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        float64x2_t a = vminq_f64(hi, vmaxq_f64(lo, vld1q_f64(src + i)));
+        float64x2_t b = vminq_f64(hi, vmaxq_f64(lo, vld1q_f64(src + i + 2)));
+        vst1q_f32(dst + i, vcombine_f32(vcvt_f32_f64(a), vcvt_f32_f64(b)));
+    }
+    double_to_float_c(src + i, dst + i, n - i);
+}
+
+/* 8 samples at a time, de-interleaved into their low, middle and (sign
+   extended) high bytes by vld3 */
+static void pcm24_to_double_neon(const uint8_t *src, double *dst, size_t n)
+{
+    const float64x2_t scale = vdupq_n_f64(pcm24_scale);
+    size_t i;
+    int k;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        uint8x8x3_t b = vld3_u8(src + 3 * i);
+        uint16x8_t lo = vorrq_u16(vmovl_u8(b.val[0]),
+                                  vshlq_n_u16(vmovl_u8(b.val[1]), 8));
+        int16x8_t hi = vmovl_s8(vreinterpret_s8_u8(b.val[2]));
+        int32x4_t v[2];
+        v[0] = vorrq_s32(vshll_n_s16(vget_low_s16(hi), 16),
+                         vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lo))));
+        v[1] = vorrq_s32(vshll_n_s16(vget_high_s16(hi), 16),
+                         vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lo))));
+        for (k = 0; k < 2; k++) {
+            vst1q_f64(dst + i + 4 * k,
+                      vmulq_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(v[k]))),
+                                scale));
+            vst1q_f64(dst + i + 4 * k + 2,
+                      vmulq_f64(vcvtq_f64_s64(vmovl_high_s32(v[k])), scale));
+        }
+    }
+    pcm24_to_double_c(src + 3 * i, dst + i, n - i);
+}
+
+static const struct convert_kernels kernels_neon = {
+    "neon",
+    pcm16_to_double_neon,
+    float_to_double_neon,
+    double_to_pcm16_neon,
+    double_to_float_neon,
+    pcm24_to_double_neon
+};
+#endif /* CONVERT_NEON */
+
+static const struct convert_kernels *kernels;
+
+/*
+ * convert_init() - choose the fastest kernels supported by this cpu
+ *
+ * called on first use of any of the conversion functions. Call it
+ * explicitly before starting threads that convert samples.
+ */
+void convert_init(void)
+{
+    if (kernels)
+        return;
+    convert_tables();
+    kernels = &kernels_c;
+#if defined(CONVERT_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        kernels = &kernels_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+        kernels = &kernels_sse2;
+#elif defined(CONVERT_NEON)
+    kernels = &kernels_neon;
+#endif
+}
+
+/*
+ * convert_isa() - name of the kernel set chosen by convert_init()
+ */
+const char *convert_isa(void)
+{
+    convert_init();
+    return kernels->name;
+}
+
+void convert_pcm16_to_double(const int16_t *src, double *dst, size_t n)
+{
+    convert_init();
+    kernels->pcm16_to_double(src, dst, n);
+}
+
+void convert_float_to_double(const float *src, double *dst, size_t n)
+{
+    convert_init();
+    kernels->float_to_double(src, dst, n);
+}
+
+void convert_pcm24_to_double(const uint8_t *src, double *dst, size_t n)
+{
+    convert_init();
+    kernels->pcm24_to_double(src, dst, n);
+}
+
+/* one table lookup a sample: a gather is no faster than the loads */
+static void convert_table(const double *table, const uint8_t *src,
+                          double *dst, size_t n)
+{
+    size_t i;
+
+    convert_init();
+    for (i = 0; i < n; i++)
+        dst[i] = table[src[i]];
+}
+
+void convert_pcm8_to_double(const uint8_t *src, double *dst, size_t n)
+{
+    convert_table(table_pcm8, src, dst, n);
+}
+
+void convert_alaw_to_double(const uint8_t *src, double *dst, size_t n)
+{
+    convert_table(table_alaw, src, dst, n);
+}
+
+void convert_ulaw_to_double(const uint8_t *src, double *dst, size_t n)
+{
+    convert_table(table_ulaw, src, dst, n);
+}
+
+void convert_double_to_pcm16(const double *src, int16_t *dst, size_t n)
+{
+    convert_init();
+    kernels->double_to_pcm16(src, dst, n);
+}
+
+void convert_double_to_float(const double *src, float *dst, size_t n)
+{
+    convert_init();
+    kernels->double_to_float(src, dst, n);
+}
+
+/*
+ * convert_denormals_flush() - flush denormals to zero on this thread
+ *
+ * sets FTZ and DAZ (x86 SSE) or FZ (arm64) so that subnormal results and
+ * inputs of floating point arithmetic become zero. The decaying feedback
+ * of a recursive filter fed silence otherwise ends up subnormal, which
+ * is many times slower on most cpus.
+ *
+ * Return: previous mode for convert_denormals_restore(), or -1 if there
+ *         is no such mode for the arithmetic this was compiled for
+ */
+long convert_denormals_flush(void)
+{
+#if defined(CONVERT_X86) && (defined(__x86_64__) || defined(__SSE2_MATH__))
+    unsigned int csr = _mm_getcsr();
+
+    _mm_setcsr(csr | 0x8040);               /* FTZ (bit 15), DAZ (bit 6) */
+    return csr;
+#elif defined(CONVERT_NEON) && defined(__GNUC__)
+    unsigned long fpcr;
+
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr | (1UL << 24)));
+    return (long)fpcr;                      /* FZ (bit 24) */
+#else
+    return -1;
+#endif
+}
+
+/*
+ * convert_denormals_restore() - undo convert_denormals_flush()
+ * mode: value returned by convert_denormals_flush()
+ */
+void convert_denormals_restore(long mode)
+{
+    if (mode < 0)
+        return;
+#if defined(CONVERT_X86) && (defined(__x86_64__) || defined(__SSE2_MATH__))
+    _mm_setcsr((unsigned int)mode);
+#elif defined(CONVERT_NEON) && defined(__GNUC__)
+    __asm__ __volatile__("msr fpcr, %0" : : "r"((unsigned long)mode));
+#endif
+}
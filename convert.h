@@ -0,0 +1,52 @@
+#ifndef DSP_CONVERT_H_INCLUDED
+#define DSP_CONVERT_H_INCLUDED
+
+/*
+ * sample format conversion kernels
+ *
+ * converts between the sample formats stored in wav files and the double
+ * samples that the filters process. The kernels are chosen at runtime
+ * (SSE2 or AVX2 on x86, NEON on arm64, otherwise plain C) and all of them
+ * give bit identical results to the scalar versions. The 8 bit formats
+ * (PCM, A-law and mu-law) are decoded through 256 entry tables.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* choose kernels for this cpu (called automatically on first use) */
+void convert_init(void);
+
+/* name of the kernel set in use, "avx2", "sse2", "neon" or "scalar" */
+const char *convert_isa(void);
+
+/* 16 bit PCM to double: dst[i] = (float)(src[i] / 32767.0) */
+void convert_pcm16_to_double(const int16_t *src, double *dst, size_t n);
+
+/* 8 bit (unsigned) PCM to double: dst[i] = (float)((src[i] - 128) / 127.0) */
+void convert_pcm8_to_double(const uint8_t *src, double *dst, size_t n);
+
+/* 24 bit PCM (3 bytes a sample) to double: dst[i] = src[i] * (1 / 8388607.0) */
+void convert_pcm24_to_double(const uint8_t *src, double *dst, size_t n);
+
+/* G.711 A-law and mu-law to double, scaled as their 16 bit PCM values */
+void convert_alaw_to_double(const uint8_t *src, double *dst, size_t n);
+void convert_ulaw_to_double(const uint8_t *src, double *dst, size_t n);
+
+/* 32 bit float to double */
+void convert_float_to_double(const float *src, double *dst, size_t n);
+
+/* clamp to [-1, 1], round to float precision and quantize to 16 bit PCM */
+void convert_double_to_pcm16(const double *src, int16_t *dst, size_t n);
+
+/* clamp to [-1, 1] and round to 32 bit float */
+void convert_double_to_float(const double *src, float *dst, size_t n);
+
+/* flush denormal results and inputs to zero on the calling thread,
+   returns the previous mode (or -1 if this cpu build has no such mode) */
+long convert_denormals_flush(void);
+
+/* restore the mode returned by convert_denormals_flush() */
+void convert_denormals_restore(long mode);
+
+#endif
@@ -0,0 +1,96 @@
+#include "convolver.h"
+#include <algorithm>
+
+namespace dsp {
+
+// smallest power of two >= n
+static std::size_t PowerOfTwo(std::size_t n)
+{
+    std::size_t p = 2;
+
+    while (p < n)
+        p *= 2;
+    return p;
+}
+
+// FFT size for an impulse response of m samples and chunks of block
+static std::size_t ChunkFFTSize(std::size_t m, std::size_t block)
+{
+    return PowerOfTwo(block ? block + m - 1 : 2 * m);
+}
+
+Convolver::Convolver(const std::vector<double> &h, std::size_t block)
+: M{std::max<std::size_t>(h.size(), 1)}, N{ChunkFFTSize(M, block)},
+  L{N - M + 1}, fft(N), h(h), H(N / 2 + 1), X(N / 2 + 1),
+  x(N), y(N)
+{
+    std::size_t log2N = 0;
+
+    if (this->h.empty())
+        this->h.push_back(0.0);
+
+    // about where M multiplies per sample cost more than the two FFTs
+    while ((std::size_t(1) << log2N) < N)
+        log2N++;
+    direct = 4 * N * log2N / M;
+
+    std::copy(this->h.begin(), this->h.end(), y.begin());
+    fft.Forward(y.data(), H.data());
+    std::fill(y.begin(), y.end(), 0.0);
+}
+
+/*
+ * Convolver::ProcessChunk() - convolve up to L samples
+ * in: r input samples
+ * out: r output samples (may be the same buffer as in)
+ */
+void Convolver::ProcessChunk(const double *in, double *out, std::size_t r)
+{
+    double *xn = x.data() + M - 1;  // x[M - 1] is current input sample 0
+
+    std::copy(in, in + r, xn);
+
+    if (r <= direct) {
+        for (std::size_t i = 0; i < r; i++) {
+            double acc = 0.0;
+            for (std::size_t k = 0; k < M; k++)
+                acc += h[k] * xn[std::ptrdiff_t(i) - std::ptrdiff_t(k)];
+            out[i] = acc;
+        }
+    } else {
+        std::fill(xn + r, x.data() + N, 0.0);
+        fft.Forward(x.data(), X.data());
+        for (std::size_t k = 0; k <= N / 2; k++)
+            X[k] *= H[k];
+        fft.Inverse(X.data(), y.data());
+        std::copy(y.data() + M - 1, y.data() + M - 1 + r, out);
+    }
+
+    // keep the last M - 1 samples as history for the next chunk
+    std::copy(x.data() + r, x.data() + r + M - 1, x.data());
+}
+
+/* filter one sample (by direct convolution)
+ * x: input sample to process
+ *
+ * Return: output sample
+ */
+double Convolver::ProcessSample(double x0)
+{
+    double y0;
+
+    ProcessChunk(&x0, &y0, 1);
+    return y0;
+}
+
+/* filter a block of samples, one chunk of up to L samples at a time
+ * in: n input samples to process
+ * out: n output samples (may be the same buffer as in)
+ */
+void Convolver::ProcessBlock(const double *in, double *out, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i += L)
+        ProcessChunk(in + i, out + i, std::min(L, n - i));
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef DSP_CONVOLVER_H_INCLUDED
+#define DSP_CONVOLVER_H_INCLUDED
+
+#include "filter.hpp"
+#include "fft.h"
+#include <complex>
+#include <vector>
+
+namespace dsp {
+
+/*
+ * FFT convolution with a long FIR impulse response (overlap-save)
+ *
+ * y[n] = h[0]x[n] + h[1]x[n-1] + ... + h[M-1]x[n-M+1]
+ *
+ * the input is cut into chunks of L samples. Each chunk, with the M - 1
+ * samples before it, fills an FFT of size N >= L + M - 1. The spectrum
+ * is multiplied by H (the FFT of h, computed once) and transformed back,
+ * and the last L samples of the result are the outputs for that chunk:
+ *
+ *   | M-1 history | L new | -> FFT -> ·H -> IFFT -> | discard | L out |
+ *
+ * There is no latency: a chunk's outputs only depend on inputs that
+ * have already arrived. Blocks shorter than L still work but cost a
+ * whole FFT, so pass BlockSize() samples at a time (wave_options.block).
+ * Very short blocks (and ProcessSample) are done by direct convolution.
+ */
+class Convolver: public Filter {
+    typedef std::complex<double> complex;
+
+    std::size_t M;              // length of the impulse response
+    std::size_t N;              // FFT size
+    std::size_t L;              // samples per chunk
+    std::size_t direct;         // largest chunk done without the FFT
+    FFT fft;
+    std::vector<double> h;      // impulse response
+    std::vector<complex> H;     // spectrum of h (N/2 + 1 bins)
+    std::vector<complex> X;     // spectrum of the current chunk
+    std::vector<double> x;      // history and current chunk (N)
+    std::vector<double> y;      // inverse FFT of the current chunk (N)
+
+    void ProcessChunk(const double *in, double *out, std::size_t r);
+public:
+    // h: impulse response
+    // block: least samples per chunk (0 picks about the length of h), it
+    //        is rounded up to fill an FFT size that is a power of two
+    Convolver(const std::vector<double> &h, std::size_t block = 0);
+
+    std::size_t BlockSize() const { return L; }
+    std::size_t FFTSize() const { return N; }
+
+    double ProcessSample(double x);
+    void ProcessBlock(const double *x, double *y, std::size_t n);
+    Convolver *Clone() const { return new Convolver(*this); }
+    std::size_t ImpulseLength() const { return M; }
+};
+
+}
+
+#endif
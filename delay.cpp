@@ -1,28 +1,60 @@
 #include "delay.h"
+#include "lanes.hpp"
+#include <cstring>
 
 namespace dsp {
 
-Delay::Delay(int n)
-: w(n), offset{}, N{n}
+/* smallest power of two holding n taps and the four the interpolators
+   can read past the last one, so no read can come round to w[0] */
+static int PowerOfTwo(int n)
+{
+    int m = 1;
+    while (m < n + 4)
+        m <<= 1;
+    return m;
+}
+
+template <typename T>
+BasicDelay<T>::BasicDelay(int n)
+: w(PowerOfTwo(n) + guard), offset{}, N{n}, mask{PowerOfTwo(n) - 1}
 {
 }
 
 /*
- * Delay::operator[](double) - interpolate tap[n]
- * n: index of delay line tap, must be >= 0 but may have a fractional part
- *    since there is a fractional part to n, linearly interpolate the samples
+ * Delay::Taps() - interpolate many taps at once
+ * n: count tap indices, each >= 0 with a fractional part
+ * y: count interpolated taps
  *
- * Return: tap[n] (offset within and modulo wrap w)
+ * each group of lanes gathers the two samples around its taps (each a
+ * contiguous pair, thanks to the guard) into a SIMD register, and
+ * interpolates them side by side with the same arithmetic as
+ * Linear(), so the results are identical
  */
-double Delay::operator[](double n)
+template <typename T>
+void BasicDelay<T>::Taps(const double *n, T *y, std::size_t count) const
 {
-    double w1, w2, f;
-    int first = (int)n;
+    typedef typename LanesOf<T>::type V;
+    const int L = LanesOf<T>::size;
+    std::size_t i = 0;
 
-    w1 = w[(offset + first) % N];
-    w2 = w[(offset + first + 1) % N];
-    f = n - first;
-    return (1.0 - f) * w1 + f * w2;
+    for (; i + L <= count; i += L) {
+        V w1, w2, f, one;
+        for (int l = 0; l < L; l++) {
+            const int first = (int)n[i + l];
+            const T *p = &w[(offset + first) & mask];
+            w1[l] = p[0];
+            w2[l] = p[1];
+            f[l] = n[i + l] - first;
+            one[l] = T(1);
+        }
+        const V r = (one - f) * w1 + f * w2;
+        std::memcpy(y + i, &r, sizeof(r));
+    }
+    for (; i < count; i++)
+        y[i] = Linear(n[i]);
 }
 
+template class BasicDelay<float>;
+template class BasicDelay<double>;
+
 }
@@ -1,29 +1,106 @@
 #ifndef DSP_DELAY_H_INCLUDED
 #define DSP_DELAY_H_INCLUDED
 
+#include <cstddef>
 #include <vector>
 
 namespace dsp {
 /*
  * circular buffer implementation of a fractional delay line
+ * T is the sample type, Delay is the double version
+ *
+ * w is a power of two long, so wrapping an index is a mask, and is
+ * followed by a guard: a copy of its first `guard` samples. An
+ * interpolator reading up to four neighbours from any start can then
+ * read them straight through without wrapping. The guard is kept up to
+ * date as the line moves, so write the newest sample to w[0] (as every
+ * filter here does) before Shift().
+ *
+ * Taps n are 0 .. N - 1; the four point interpolators also read n - 1
+ * and n + 2, so keep 1 <= n <= N - 3 for those.
  */
 
-class Delay {
-    std::vector<double> w;  /* delay line */
+template <typename T>
+class BasicDelay {
+public:
+    static const int guard = 4;     // samples copied past the end of w
+private:
+    std::vector<T> w;       /* delay line (mask + 1 + guard) */
     int offset;             /* current start of buffer within w */
     int N;
+    int mask;               /* power of two length of w minus one */
+
+    /* copy w[i] into the guard if it is one of the first samples */
+    void Mirror(int i) { if (i < guard) w[i + mask + 1] = w[i]; }
+    /* the four samples around tap n, n - 1 first */
+    const T *Around(int first) const {
+        return &w[(offset + first - 1) & mask];
+    }
 public:
-    Delay(int n);
+    BasicDelay(int n);
     /* (advance delay line by one sample) */
-    void Shift() { if (--offset < 0) offset += N; }
+    void Shift() { Mirror(offset); offset = (offset - 1) & mask; }
     /* (retreat delay line by one sample) */
-    void Unshift() { if (++offset > N) offset -= N; }
-    /* interpolate w[n] */
-    double operator[](double n);
+    void Unshift() { Mirror(offset); offset = (offset + 1) & mask; }
+    /* number of taps */
+    int Length() const { return N; }
+
+    /* interpolate w[n] linearly */
+    T Linear(double n) const {
+        const int first = (int)n;
+        const T *p = &w[(offset + first) & mask];
+        const T f = n - first;
+        return (T(1) - f) * p[0] + f * p[1];
+    }
+    /* interpolate w[n] (linearly) */
+    T operator[](double n) { return Linear(n); }
     /* reference to w[n] */
-    double& operator[](int n) { return w[(offset + n) % N]; }
+    T& operator[](int n) { return w[(offset + n) & mask]; }
+
+    /* interpolate w[n] with a cubic Hermite (Catmull-Rom) spline */
+    T Cubic(double n) const {
+        const int first = (int)n;
+        const T *p = Around(first);
+        const T f = n - first;
+        const T c1 = T(0.5) * (p[2] - p[0]);
+        const T c2 = p[0] - T(2.5) * p[1] + T(2) * p[2] - T(0.5) * p[3];
+        const T c3 = T(0.5) * (p[3] - p[0]) + T(1.5) * (p[1] - p[2]);
+        return ((c3 * f + c2) * f + c1) * f + p[1];
+    }
+
+    /* interpolate w[n] with a third order Lagrange polynomial */
+    T Lagrange(double n) const {
+        const int first = (int)n;
+        const T *p = Around(first);
+        const T f = n - first;
+        const T fm1 = f - T(1), fm2 = f - T(2), fp1 = f + T(1);
+        return -f * fm1 * fm2 / T(6) * p[0] + fp1 * fm1 * fm2 / T(2) * p[1]
+               - fp1 * f * fm2 / T(2) * p[2] + fp1 * f * fm1 / T(6) * p[3];
+    }
+
+    /* interpolate w[n] with a first order allpass
+     * last: this tap's previous output, updated (one per tap, starting
+     *       at 0), so the tap needs an n that changes slowly
+     * flat magnitude response, unlike linear interpolation, which makes
+     * it the one for taps inside a feedback loop
+     */
+    T Allpass(double n, T &last) const {
+        const int first = (int)n;
+        const T *p = &w[(offset + first) & mask];
+        const T f = n - first;
+        const T eta = (T(1) - f) / (T(1) + f);
+        last = eta * (p[0] - last) + p[1];
+        return last;
+    }
+
+    /* interpolate count taps n[] linearly into y[], a SIMD group of taps
+       at a time (the same results as Linear()) */
+    void Taps(const double *n, T *y, std::size_t count) const;
 };
 
+/* (instantiated for float and double in delay.cpp) */
+typedef BasicDelay<double> Delay;
+
 }
 
 #endif
@@ -1,32 +1,106 @@
 #include "delayline.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <string.h>
 
+/* power of two length of w for N taps and the DELAY_GUARD samples an
+   interpolator can read past the last one */
+static int delay_len(int N)
+{
+    int len = 1;
+
+    while (len < N + DELAY_GUARD)
+        len <<= 1;
+    return len;
+}
+
 /*
- * delay_create() - allocate and initialize a fractional delay
- * N:      length of w
+ * delay_size() - bytes a fractional delay takes
+ * N:      number of taps
  *
- * Return: the initialized state structure for the filter
+ * Return: the size of the block delay_create() allocates
  */
-struct delay *
-delay_create(int N)
+size_t delay_size(int N)
+{
+    return ARENA_ROUND(sizeof(struct delay))
+           + ARENA_ROUND((delay_len(N) + DELAY_GUARD) * sizeof(double));
+}
+
+/*
+ * delay_init() - lay a fractional delay out in a zeroed block
+ * mem: delay_size(N) zeroed bytes, cache line aligned (or NULL)
+ * N:      number of taps
+ *
+ * Return: the state structure at the start of mem
+ */
+static struct delay *delay_init(void *mem, int N)
 {
-    struct delay *s;
-    s = malloc(sizeof(*s));
+    struct delay *s = mem;
+
+    if (!mem)
+        return NULL;
+    s->w = (double *)((unsigned char *)mem + ARENA_ROUND(sizeof(*s)));
     s->N = N;
-    s->w = calloc(N, sizeof(double));
+    s->mask = delay_len(N) - 1;
     s->offset = 0;
     return s;
 }
 
+/*
+ * delay_create() - allocate and initialize a fractional delay
+ * N:      number of taps
+ *
+ * Return: the initialized state structure for the filter, in one block
+ */
+struct delay *
+delay_create(int N)
+{
+    return delay_init(arena_aligned(delay_size(N)), N);
+}
+
+/*
+ * delay_create_in() - initialize a fractional delay in an arena
+ * ar: arena with delay_size(N) bytes left
+ * N:      number of taps
+ *
+ * Return: the delay (freed with the arena), NULL if the arena is full
+ */
+struct delay *delay_create_in(struct arena *ar, int N)
+{
+    return delay_init(arena_alloc(ar, delay_size(N)), N);
+}
+
 /*
  * delay_destroy() - free memory allocated for circular filter
- * s: pointer to filter state
+ * s: pointer to filter state from delay_create() or delay_clone()
  */
 void delay_destroy(struct delay *s)
 {
-    free(s->w);
-    free(s);
+    arena_aligned_free(s);
+}
+
+/*
+ * delay_clone() - copy a fractional delay
+ * s: pointer to filter state
+ *
+ * Return: a new state structure with the same delay line and offset
+ */
+struct delay *delay_clone(const struct delay *s)
+{
+    struct delay *c = delay_create(s->N);
+
+    if (!c)
+        return NULL;
+    memcpy(c->w, s->w, (s->mask + 1 + DELAY_GUARD) * sizeof(double));
+    c->offset = s->offset;
+    return c;
+}
+
+/* copy w[i] into the guard if it is one of the first samples */
+static void delay_mirror(struct delay *s, int i)
+{
+    if (i < DELAY_GUARD)
+        s->w[i + s->mask + 1] = s->w[i];
 }
 
 /*
@@ -34,26 +108,24 @@ void delay_destroy(struct delay *s)
  *                   (advance delay line by one sample)
  * s: pointer to filter state
  *
- * properly wrap offset so that it doesn't fall off the edge of buffer
+ * the sample at w[0] is copied to the guard first if it needs to be
  */
 void delay_dec(struct delay *s)
 {
-    if (s->offset == 0)
-        s->offset = s->N;
-    s->offset--;
+    delay_mirror(s, s->offset);
+    s->offset = (s->offset - 1) & s->mask;
 }
 
 /*
  * delay_inc() - increment offset of w buffer
  * s: pointer to filter state
  *
- * properly wrap offset so that it doesn't fall off the edge of buffer
+ * the sample at w[0] is copied to the guard first if it needs to be
  */
 void delay_inc(struct delay *s)
 {
-    s->offset++;
-    if (s->offset > s->N)
-        s->offset -= s->N;
+    delay_mirror(s, s->offset);
+    s->offset = (s->offset + 1) & s->mask;
 }
 
 /*
@@ -62,16 +134,62 @@ void delay_inc(struct delay *s)
  * n: index into w (must be positive or zero but can have a fractional part)
  *
  * since there is a fractional part to n, linearly interpolate the samples
+ * (w[n] and w[n + 1] are next to each other, the guard sees to that)
  *
  * Return: w[n]
  */
 double delay_w(struct delay *s, double n)
 {
-    double wa, wb, f;
-    wa = s->w[(s->offset + (int)n) % s->N];
-    wb = s->w[(s->offset + (int)(n+1)) % s->N];
-    f = n - (int)n;
-    return (1.0 - f) * wa + f * wb;
+    const int first = (int)n;
+    const double *p = s->w + ((s->offset + first) & s->mask);
+    const double f = n - first;
+
+    return (1.0 - f) * p[0] + f * p[1];
+}
+
+/*
+ * delay_cubic() - return w[n] with cubic interpolation
+ * s: pointer to filter state
+ * n: index into w, 1 <= n <= N - 3 (w[n - 1] to w[n + 2] are read)
+ *
+ * a Catmull-Rom spline through the four samples around n, smoother than
+ * delay_w() for a tap that moves quickly
+ *
+ * Return: w[n]
+ */
+double delay_cubic(struct delay *s, double n)
+{
+    const int first = (int)n;
+    const double *p = s->w + ((s->offset + first - 1) & s->mask);
+    const double f = n - first;
+    const double c1 = 0.5 * (p[2] - p[0]);
+    const double c2 = p[0] - 2.5 * p[1] + 2.0 * p[2] - 0.5 * p[3];
+    const double c3 = 0.5 * (p[3] - p[0]) + 1.5 * (p[1] - p[2]);
+
+    return ((c3 * f + c2) * f + c1) * f + p[1];
+}
+
+/*
+ * delay_taps() - interpolate many taps of the delay line at once
+ * s: pointer to filter state
+ * n: count tap indices (as for delay_w())
+ * y: count interpolated taps
+ *
+ * the same as delay_w() for each tap, but with no calls or branches in
+ * the loop, so the compiler can keep several taps in flight
+ */
+void delay_taps(struct delay *s, const double *n, double *y, size_t count)
+{
+    const double *w = s->w;
+    const int offset = s->offset, mask = s->mask;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        const int first = (int)n[i];
+        const double *p = w + ((offset + first) & mask);
+        const double f = n[i] - first;
+        y[i] = (1.0 - f) * p[0] + f * p[1];
+    }
 }
 
 /*
@@ -84,3 +202,22 @@ double *delay_w0(struct delay *s)
 {
     return s->w + s->offset;
 }
+
+/*
+ * delay_sample() - run one sample through the whole delay line
+ * s: pointer to filter state
+ * x: input sample
+ *
+ * a plain delay of N - 1 samples, e.g. the pre-delay of a reverb send
+ *
+ * Return: x from N - 1 samples ago
+ */
+double delay_sample(struct delay *s, double x)
+{
+    double y;
+
+    *delay_w0(s) = x;
+    y = delay_w(s, s->N - 1);
+    delay_dec(s);
+    return y;
+}
@@ -3,30 +3,60 @@
 
 /*
  * circular buffer implementation of a fractional delay line
+ * w is a power of two long, so wrapping is a mask, and is followed by a
+ * copy of its first DELAY_GUARD samples, so the samples an interpolator
+ * reads are always contiguous. The copy is made as the line moves, so
+ * write the newest sample to *delay_w0() before delay_dec().
  */
 
+#include <stddef.h>
+
+/* samples of w copied past its end */
+#define DELAY_GUARD 4
+
 struct delay {
-    double *w;      /* delay line */
-    int N;       /* length of w */
-    int offset;  /* current start of buffer within w */
+    double *w;      /* delay line (mask + 1 + DELAY_GUARD) */
+    int N;          /* number of taps */
+    int mask;       /* power of two length of w minus one */
+    int offset;     /* current start of buffer within w */
 };
 
+struct arena;
+
+/* bytes of one delay line: state and w in one block */
+size_t delay_size(int N);
+
 /* allocate and initialize */
 struct delay *delay_create(int N);
 
-/* free state object */
+/* initialize in an arena (freed with the arena), NULL if it is full */
+struct delay *delay_create_in(struct arena *ar, int N);
+
+/* free state object from delay_create() or delay_clone() */
 void delay_destroy(struct delay *s);
 
+/* allocate a copy of a state object (the delay line and its offset) */
+struct delay *delay_clone(const struct delay *s);
+
 /* decrement offset within w buffer (advance delay line by one sample) */
 void delay_dec(struct delay *s);
 
 /* increment offset within w buffer */
 void delay_inc(struct delay *s);
 
-/* return w[n] while handling wrapping */
+/* return w[n] while handling wrapping (linear interpolation) */
 double delay_w(struct delay *s, double n);
 
+/* return w[n] with cubic Hermite interpolation (1 <= n <= N - 3) */
+double delay_cubic(struct delay *s, double n);
+
+/* interpolate count taps n[] into y[] */
+void delay_taps(struct delay *s, const double *n, double *y, size_t count);
+
 /* return pointer to w[0] */
 double *delay_w0(struct delay *s);
 
+/* delay one sample by the length of the line (N - 1 samples) */
+double delay_sample(struct delay *s, double x);
+
 #endif
@@ -1,12 +1,31 @@
 #include "directform.h"
+#include "lanes.hpp"
 #include <algorithm>
+#include <cstring>
 
 namespace dsp {
 
 using std::vector;
 
-DirectForm1::DirectForm1(vector<double> b, vector<double> a)
-: x(b.size()), y(a.size()), b{b}, a{a}
+/* b.size() for an FIR filter (a[1..] all zero), otherwise 0 */
+template <typename T>
+static std::size_t FIRLength(const vector<T> &b, const vector<T> &a)
+{
+    for (std::size_t n = 1; n < a.size(); n++)
+        if (a[n] != T(0))
+            return 0;
+    return b.size();
+}
+
+template <typename T>
+std::size_t BasicDirectForm1<T>::ImpulseLength() const
+{
+    return FIRLength(b, a);
+}
+
+template <typename T>
+BasicDirectForm1<T>::BasicDirectForm1(vector<T> b, vector<T> a)
+: x(2 * b.size()), y(2 * a.size()), xpos{}, ypos{}, b{b}, a{a}
 {
 }
 
@@ -15,31 +34,125 @@ DirectForm1::DirectForm1(vector<double> b, vector<double> a)
  *
  * Return: output sample
  */
-double DirectForm1::ProcessSample(double x0)
+template <typename T>
+T BasicDirectForm1<T>::ProcessSample(T x0)
 {
-    double yz = 0.0, yp = 0.0;  // partial sums
+    const int L = b.size(), M = a.size();
+    T yz = 0, yp = 0;       // partial sums
 
-    x[0] = x0;
-    for (int n = b.size() - 1; n >= 0; n--) {
-        yz += b[n] * x[n];
+    // x[n] is xs[-n] and y[n] (the output n samples ago) is ys[1-n]
+    if (++xpos == L)
+        xpos = 0;
+    x[xpos] = x[xpos + L] = x0;
+    const T *xs = &x[xpos + L];
+    const T *ys = &y[ypos + M];
+
+    for (int n = L - 1; n >= 0; n--) {
+        yz += b[n] * xs[-n];
     }
-    for (int n = a.size() - 1; n > 0; n--) {
-        yp -= a[n] * y[n];
+    for (int n = M - 1; n > 0; n--) {
+        yp -= a[n] * ys[1 - n];
     }
-    y[0] = yz + yp;
+    const T y0 = yz + yp;
+
+    if (++ypos == M)
+        ypos = 0;
+    y[ypos] = y[ypos + M] = y0;
+
+    return y0;
+}
 
-    for (int n = x.size() - 1; n > 0; n--) {
-        x[n] = x[n - 1];
+/* y[i] = b[L-1]·u[i-L+1] + ... + b[0]·u[i] for i = 0 .. n-1
+ * u[] must have L-1 samples of history in front of it
+ * the sums are done in the same order as the per sample filters, but
+ * for LanesOf<T>::size outputs at a time
+ */
+template <typename T>
+static void FeedForward(const T *b, int L, const T *u, T *y, std::size_t n)
+{
+    typedef typename LanesOf<T>::type V;
+    const std::size_t size = LanesOf<T>::size;
+    std::size_t i = 0;
+
+    for (; i + size <= n; i += size) {
+        V acc = V(), v;
+        for (int k = L - 1; k >= 0; k--) {
+            std::memcpy(&v, u + i - k, sizeof(v));
+            acc = acc + b[k] * v;
+        }
+        std::memcpy(y + i, &acc, sizeof(acc));
     }
-    for (int n = y.size() - 1; n > 0; n--) {
-        y[n] = y[n - 1];
+    for (; i < n; i++) {
+        T acc = 0;
+        for (int k = L - 1; k >= 0; k--) {
+            acc += b[k] * u[std::ptrdiff_t(i) - k];
+        }
+        y[i] = acc;
     }
+}
 
-    return y[0];
+/* copy the newest N samples of u (which ends at u[n-1]) into a mirrored
+ * ring buffer and return the position of the newest sample
+ */
+template <typename T>
+static int Refill(T *ring, int N, const T *u, std::size_t n)
+{
+    std::copy(u + n - N, u + n, ring);
+    std::copy(u + n - N, u + n, ring + N);
+    return N - 1;
+}
+
+/* filter a block of samples using direct form I
+ * in: n input samples to process
+ * out: n output samples (may be the same buffer as in)
+ */
+template <typename T>
+void BasicDirectForm1<T>::ProcessBlock(const T *in, T *out, std::size_t n)
+{
+    const int L = b.size(), M = a.size();
+    const T *ap = a.data();
+
+    if (n == 0)
+        return;
+
+    // the last L-1 inputs followed by the block
+    xlin.resize(L - 1 + n);
+    T *xl = xlin.data() + L - 1;
+    std::copy(x.data() + xpos + 2, x.data() + xpos + L + 1, xlin.data());
+    std::copy(in, in + n, xl);
+
+    FeedForward(b.data(), L, xl, out, n);
+
+    if (M > 1) {
+        // the last M-1 outputs followed by the block
+        ylin.resize(M - 1 + n);
+        T *yl = ylin.data() + M - 1;
+        std::copy(y.data() + ypos + 2, y.data() + ypos + M + 1, ylin.data());
+
+        for (std::size_t i = 0; i < n; i++) {
+            T yp = 0;
+            for (int k = M - 1; k > 0; k--) {
+                yp -= ap[k] * yl[std::ptrdiff_t(i) - k];
+            }
+            out[i] = yl[i] = out[i] + yp;
+        }
+        ypos = Refill(y.data(), M, ylin.data(), M - 1 + n);
+    } else {
+        y[0] = y[1] = out[n - 1];
+        ypos = 0;
+    }
+    xpos = Refill(x.data(), L, xlin.data(), L - 1 + n);
+}
+
+template <typename T>
+std::size_t BasicDirectForm2<T>::ImpulseLength() const
+{
+    return FIRLength(b, a);
 }
 
-DirectForm2::DirectForm2(vector<double> b, vector<double> a)
-: w(std::max(b.size(), a.size())), b{b}, a{a}
+template <typename T>
+BasicDirectForm2<T>::BasicDirectForm2(vector<T> b, vector<T> a)
+: w(2 * std::max(b.size(), a.size())), wpos{}, b{b}, a{a}
 {
 }
 
@@ -48,35 +161,75 @@ DirectForm2::DirectForm2(vector<double> b, vector<double> a)
  *
  * Return: output sample
  */
-double DirectForm2::ProcessSample(double x)
+template <typename T>
+T BasicDirectForm2<T>::ProcessSample(T x)
 {
-    double y = 0.0;
-    double w0 = x;
+    const int N = w.size() / 2;
+    T y = 0;
+    T w0 = x;
 
+    // before w0 is stored, w[n] is ws[1-n], after it is ws[-n]
+    const T *ws = &w[wpos + N];
     for (int n = a.size() - 1; n > 0; n--) {
-        w0 -= a[n] * w[n];
+        w0 -= a[n] * ws[1 - n];
     }
-    w[0] = w0;
+    if (++wpos == N)
+        wpos = 0;
+    w[wpos] = w[wpos + N] = w0;
 
+    ws = &w[wpos + N];
     for (int n = b.size() - 1; n >= 0; n--) {
-        y += b[n] * w[n];
+        y += b[n] * ws[-n];
     }
 
-    for (int n = w.size() - 1; n > 0; n--) {
-        w[n] = w[n - 1];
+    return y;
+}
+
+/* filter a block of samples using direct form II
+ * in: n input samples to process
+ * out: n output samples (may be the same buffer as in)
+ */
+template <typename T>
+void BasicDirectForm2<T>::ProcessBlock(const T *in, T *out, std::size_t n)
+{
+    const int M = a.size(), N = w.size() / 2;
+    const T *ap = a.data();
+
+    if (n == 0)
+        return;
+
+    // the last N-1 values of w followed by the new ones for the block
+    wlin.resize(N - 1 + n);
+    T *wl = wlin.data() + N - 1;
+    std::copy(w.data() + wpos + 2, w.data() + wpos + N + 1, wlin.data());
+
+    for (std::size_t i = 0; i < n; i++) {
+        T w0 = in[i];
+        for (int k = M - 1; k > 0; k--) {
+            w0 -= ap[k] * wl[std::ptrdiff_t(i) - k];
+        }
+        wl[i] = w0;
     }
 
-    return y;
+    FeedForward(b.data(), b.size(), wl, out, n);
+    wpos = Refill(w.data(), N, wlin.data(), N - 1 + n);
+}
+
+template <typename T>
+std::size_t BasicDirectForm2T<T>::ImpulseLength() const
+{
+    return FIRLength(b, a);
 }
 
-DirectForm2T::DirectForm2T(vector<double> b, vector<double> a)
+template <typename T>
+BasicDirectForm2T<T>::BasicDirectForm2T(vector<T> b, vector<T> a)
 : v(std::max(b.size(), a.size())), b{b}, a{a}
 {
     // make a and b the same size for simplicity
-    if (b.size() > a.size()) {
-        a.resize(b.size(), 0.0);
-    } else if (a.size() > b.size()) {
-        b.resize(a.size(), 0.0);
+    if (this->b.size() > this->a.size()) {
+        this->a.resize(this->b.size(), T(0));
+    } else if (this->a.size() > this->b.size()) {
+        this->b.resize(this->a.size(), T(0));
     }
 }
 
@@ -85,7 +238,8 @@ DirectForm2T::DirectForm2T(vector<double> b, vector<double> a)
  *
  * Return: output sample
  */
-double DirectForm2T::ProcessSample(double x)
+template <typename T>
+T BasicDirectForm2T<T>::ProcessSample(T x)
 {
     const int M = v.size() - 1;
 
@@ -99,4 +253,63 @@ double DirectForm2T::ProcessSample(double x)
     return v[0];
 }
 
+/* filter a block of samples using transposed direct form II
+ * in: n input samples to process
+ * out: n output samples (may be the same buffer as in)
+ */
+template <typename T>
+void BasicDirectForm2T<T>::ProcessBlock(const T *in, T *out, std::size_t n)
+{
+    const int M = v.size() - 1;
+    const T *bp = b.data(), *ap = a.data();
+    T *vp = v.data();
+
+    for (std::size_t j = 0; j < n; j++) {
+        const T x = in[j];
+
+        vp[0] = bp[0] * x + vp[1];
+        for (int i = 1; i < M; i++) {
+            vp[i] = bp[i] * x - ap[i] * vp[0] + vp[i+1];
+        }
+        vp[M] = bp[M] * x - ap[M] * vp[0];
+        out[j] = vp[0];
+    }
+}
+
+/* filter a block of 16 bit samples in fixed point (the same for every
+ * form, see fixed.h)
+ * in: n input samples to process
+ * out: n output samples (may be the same buffer as in)
+ */
+template <typename T>
+void BasicDirectForm1<T>::ProcessBlockQ15(const std::int16_t *in,
+                                          std::int16_t *out, std::size_t n)
+{
+    q.Quantize(b.data(), b.size(), a.data(), a.size());
+    q.ProcessBlock(in, out, n);
+}
+
+template <typename T>
+void BasicDirectForm2<T>::ProcessBlockQ15(const std::int16_t *in,
+                                          std::int16_t *out, std::size_t n)
+{
+    q.Quantize(b.data(), b.size(), a.data(), a.size());
+    q.ProcessBlock(in, out, n);
+}
+
+template <typename T>
+void BasicDirectForm2T<T>::ProcessBlockQ15(const std::int16_t *in,
+                                           std::int16_t *out, std::size_t n)
+{
+    q.Quantize(b.data(), b.size(), a.data(), a.size());
+    q.ProcessBlock(in, out, n);
+}
+
+template class BasicDirectForm1<float>;
+template class BasicDirectForm1<double>;
+template class BasicDirectForm2<float>;
+template class BasicDirectForm2<double>;
+template class BasicDirectForm2T<float>;
+template class BasicDirectForm2T<double>;
+
 } // namespace dsp
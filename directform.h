@@ -2,12 +2,27 @@
 #define DSP_DIRECTFORM_H_INCLUDED
 
 #include "filter.hpp"
+#include "fixed.h"
+#include <algorithm>
 #include <vector>
 
 /* direct form filters
  * a[0] should always be 1.0
  * an FIR only filter can be defined using the b vector and a = {1.0}
  * an IIR only filter can be defined using the a vector and b = {1.0}
+ *
+ * DirectForm1 and DirectForm2 keep their delay lines in mirrored ring
+ * buffers: each sample is stored twice, N apart, so the last N samples
+ * are always contiguous and nothing shifts. ProcessBlock lays the
+ * history and the block end to end and computes the feed forward sums
+ * for several outputs at once, each summed in the same order as
+ * ProcessSample so both give bit identical results.
+ *
+ * ProcessBlockQ15 runs every form as a fixed point direct form I (see
+ * fixed.h) with the current b and a.
+ *
+ * T is the sample and coefficient type (see BasicFilter), DirectForm1,
+ * DirectForm2 and DirectForm2T are the double versions.
  */
 
 namespace dsp {
@@ -35,17 +50,29 @@ namespace dsp {
  *          └---|>-→(+)←-<|---┘
  *
  */
-class DirectForm1: public Filter {
-    std::vector<double> x;  // delay line for input
-    std::vector<double> y;  // delay line for output
+template <typename T>
+class BasicDirectForm1: public BasicFilter<T> {
+    std::vector<T> x;       // delay line for input (mirrored, 2 * b.size())
+    std::vector<T> y;       // delay line for output (mirrored, 2 * a.size())
+    int xpos, ypos;         // newest sample in x and y
+    std::vector<T> xlin, ylin; // history and block end to end
+    FixedDirectForm1 q;     // fixed point version and its state
 public:
-    std::vector<double> b;  // b coefficients - feed forward
-    std::vector<double> a;  // a coefficients - feedback
+    std::vector<T> b;       // b coefficients - feed forward
+    std::vector<T> a;       // a coefficients - feedback
 
-    DirectForm1(std::vector<double> b, std::vector<double> a);
-    double ProcessSample(double x); // process one sample through filter
+    BasicDirectForm1(std::vector<T> b, std::vector<T> a);
+    T ProcessSample(T x);   // process one sample through filter
+    void ProcessBlock(const T *in, T *out, std::size_t n);
+    BasicDirectForm1 *Clone() const { return new BasicDirectForm1(*this); }
+    std::size_t ImpulseLength() const;  // b.size() if a is just {1.0}
+    void ProcessBlockQ15(const std::int16_t *in, std::int16_t *out,
+                         std::size_t n);
+    bool FixedPoint() const { return true; }
 };
 
+typedef BasicDirectForm1<double> DirectForm1;
+
 /* DirectfForm2
  *
  * Starting with the direct form I equation above:
@@ -70,16 +97,28 @@ public:
  *          └---<|---┴---|>---┘
  *
  */
-class DirectForm2: public Filter {
-    std::vector<double> w;  // delay line
+template <typename T>
+class BasicDirectForm2: public BasicFilter<T> {
+    std::vector<T> w;       // delay line (mirrored, 2 * max(a, b) size)
+    int wpos;               // newest sample in w
+    std::vector<T> wlin;    // history and block end to end
+    FixedDirectForm1 q;     // fixed point version and its state
 public:
-    std::vector<double> b;  // b coefficients - feed forward
-    std::vector<double> a;  // a coefficients - feedback
+    std::vector<T> b;       // b coefficients - feed forward
+    std::vector<T> a;       // a coefficients - feedback
 
-    DirectForm2(std::vector<double> b, std::vector<double> a);
-    double ProcessSample(double x); // process one sample through filter
+    BasicDirectForm2(std::vector<T> b, std::vector<T> a);
+    T ProcessSample(T x);   // process one sample through filter
+    void ProcessBlock(const T *in, T *out, std::size_t n);
+    BasicDirectForm2 *Clone() const { return new BasicDirectForm2(*this); }
+    std::size_t ImpulseLength() const;  // b.size() if a is just {1.0}
+    void ProcessBlockQ15(const std::int16_t *in, std::int16_t *out,
+                         std::size_t n);
+    bool FixedPoint() const { return true; }
 };
 
+typedef BasicDirectForm2<double> DirectForm2;
+
 /* DirectForm1T - transposed direct form I
  *
  * Starting with the direct form I signal flow:
@@ -123,16 +162,31 @@ public:
  *          └--|>--→(+)←--<|--┘
  *
  */
-class DirectForm2T: public Filter {
-    std::vector<double> v;  // delay line
+template <typename T>
+class BasicDirectForm2T: public BasicFilter<T> {
+    std::vector<T> v;       // delay line
+    FixedDirectForm1 q;     // fixed point version and its state
 public:
-    std::vector<double> b;  // b coefficients - zeros
-    std::vector<double> a;  // a coefficients - poles
+    std::vector<T> b;       // b coefficients - zeros
+    std::vector<T> a;       // a coefficients - poles
+
+    BasicDirectForm2T(std::vector<T> b, std::vector<T> a);
+    T ProcessSample(T x);   // process one sample through filter
+    void ProcessBlock(const T *in, T *out, std::size_t n);
+    BasicDirectForm2T *Clone() const { return new BasicDirectForm2T(*this); }
+    std::size_t ImpulseLength() const;  // b.size() if a is just {1.0}
+    void ProcessBlockQ15(const std::int16_t *in, std::int16_t *out,
+                         std::size_t n);
+    bool FixedPoint() const { return true; }
 
-    DirectForm2T(std::vector<double> b, std::vector<double> a);
-    double ProcessSample(double x); // process one sample through filter
+    // state v (for TimeParallel)
+    std::size_t StateSize() const { return v.size(); }
+    void GetState(T *s) const { std::copy(v.begin(), v.end(), s); }
+    void SetState(const T *s) { std::copy(s, s + v.size(), v.begin()); }
 };
 
+typedef BasicDirectForm2T<double> DirectForm2T;
+
 }
 
 #endif
@@ -0,0 +1,103 @@
+#include "fft.h"
+#include "filter.hpp"
+#include <cmath>
+#include <utility>
+
+namespace dsp {
+
+FFT::FFT(std::size_t n)
+: N{n}, w(n / 2), rev(n / 2), z(n / 2)
+{
+    const std::size_t M = N / 2;
+    int bits = 0;
+
+    while ((std::size_t(1) << bits) < M)
+        bits++;
+    for (std::size_t k = 0; k < M; k++) {
+        w[k] = std::polar(1.0, -2 * pi * double(k) / double(N));
+        std::size_t r = 0;
+        for (int b = 0; b < bits; b++)
+            r |= ((k >> b) & 1) << (bits - 1 - b);
+        rev[k] = r;
+    }
+}
+
+/*
+ * FFT::Transform() - in place forward FFT of N/2 complex points
+ * z: N/2 points in natural order
+ *
+ * radix-2 decimation in time. The twiddle for butterfly j of a stage of
+ * length len is e^(-2πij/len) = w[j·N/len].
+ */
+void FFT::Transform(complex *z) const
+{
+    const std::size_t M = N / 2;
+
+    for (std::size_t k = 0; k < M; k++)
+        if (k < rev[k])
+            std::swap(z[k], z[rev[k]]);
+
+    for (std::size_t len = 2; len <= M; len *= 2) {
+        const std::size_t half = len / 2, step = N / len;
+        for (std::size_t i = 0; i < M; i += len) {
+            for (std::size_t j = 0; j < half; j++) {
+                const complex t = w[j * step] * z[i + j + half];
+                z[i + j + half] = z[i + j] - t;
+                z[i + j] += t;
+            }
+        }
+    }
+}
+
+/*
+ * FFT::Forward() - spectrum of a block of real samples
+ * x: N input samples
+ * X: N/2 + 1 output bins
+ */
+void FFT::Forward(const double *x, complex *X)
+{
+    const std::size_t M = N / 2;
+
+    for (std::size_t k = 0; k < M; k++)
+        z[k] = complex(x[2 * k], x[2 * k + 1]);
+    Transform(z.data());
+
+    // Z[k] = Xe[k] + i·Xo[k], and Xe, Xo are conjugate symmetric
+    X[0] = z[0].real() + z[0].imag();
+    X[M] = z[0].real() - z[0].imag();
+    for (std::size_t k = 1; k < M; k++) {
+        const complex a = z[k], b = std::conj(z[M - k]);
+        const complex xe = 0.5 * (a + b);
+        const complex xo = complex(0.0, -0.5) * (a - b);
+        X[k] = xe + w[k] * xo;
+    }
+}
+
+/*
+ * FFT::Inverse() - real samples from half a spectrum
+ * X: N/2 + 1 input bins
+ * x: N output samples
+ */
+void FFT::Inverse(const complex *X, double *x)
+{
+    const std::size_t M = N / 2;
+    const double scale = 1.0 / M;
+
+    // back to Z[k] = Xe[k] + i·Xo[k], conjugated for an inverse transform
+    z[0] = complex(0.5 * (X[0].real() + X[M].real()),
+                   -0.5 * (X[0].real() - X[M].real()));
+    for (std::size_t k = 1; k < M; k++) {
+        const complex a = X[k], b = std::conj(X[M - k]);
+        const complex xe = 0.5 * (a + b);
+        const complex xo = 0.5 * (a - b) * std::conj(w[k]);
+        z[k] = std::conj(xe + complex(0.0, 1.0) * xo);
+    }
+    Transform(z.data());
+
+    for (std::size_t k = 0; k < M; k++) {
+        x[2 * k] = scale * z[k].real();
+        x[2 * k + 1] = -scale * z[k].imag();
+    }
+}
+
+}
@@ -0,0 +1,47 @@
+#ifndef DSP_FFT_H_INCLUDED
+#define DSP_FFT_H_INCLUDED
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace dsp {
+
+/*
+ * FFT of real signals (plan for one power of two size N)
+ *
+ * the twiddle factors and bit reversal table are computed once by the
+ * constructor so the same plan can transform any number of blocks.
+ * N real samples are packed into N/2 complex ones (even samples real,
+ * odd samples imaginary), transformed with an iterative radix-2 FFT and
+ * then split into the N/2 + 1 bins of the real spectrum:
+ *
+ *   X[k] = Xe[k] + e^(-2πik/N)·Xo[k]     k = 0 .. N/2
+ *
+ * bins above N/2 are the complex conjugates of those below it.
+ */
+class FFT {
+    typedef std::complex<double> complex;
+
+    std::size_t N;                  // real transform size
+    std::vector<complex> w;         // e^(-2πik/N) for k < N/2
+    std::vector<std::size_t> rev;   // bit reversal of N/2 points
+    std::vector<complex> z;         // packed samples
+
+    void Transform(complex *z) const;
+public:
+    // n: transform size, a power of two (at least 2)
+    explicit FFT(std::size_t n);
+
+    std::size_t Size() const { return N; }
+
+    // x: N samples in, X: N/2 + 1 bins out
+    void Forward(const double *x, complex *X);
+    // X: N/2 + 1 bins in, x: N samples out (scaled by 1/N, so Inverse()
+    // of Forward() gives back the input)
+    void Inverse(const complex *X, double *x);
+};
+
+}
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef DSP_FILTER_H_INCLUDED
 #define DSP_FILTER_H_INCLUDED
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* 
  * function pointer for all sample by sample processing algorithms
  * x: input sample to process
@@ -10,4 +13,25 @@
  */
 typedef double (*filter_func)(void *state, double x);
 
+/*
+ * function pointer for block processing algorithms
+ * state: pointer to the state of the filter
+ * x: n input samples to process
+ * y: buffer for n output samples (may be the same buffer as x)
+ * n: number of samples
+ */
+typedef void (*block_filter_func)(void *state, const double *x, double *y,
+                                  size_t n);
+
+/*
+ * function pointer for fixed point block processing algorithms
+ * state: pointer to the state of the filter (the same filter as for the
+ *        block_filter_func, with a fixed point state of its own)
+ * x: n input samples to process, 16 bit PCM as Q15
+ * y: buffer for n output samples, saturated (may be the same buffer as x)
+ * n: number of samples
+ */
+typedef void (*block_filter_q15_func)(void *state, const int16_t *x,
+                                      int16_t *y, size_t n);
+
 #endif /* FILTER_H */
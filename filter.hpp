@@ -1,17 +1,76 @@
 #ifndef DSP_FILTER_HPP_INCLUDED
 #define DSP_FILTER_HPP_INCLUDED
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
 namespace dsp {
 
 const double pi = 3.14159265358979323846;
 
 /*
  * sample by sample processing interface
+ * T is the type of the samples (and of the coefficients of the filters
+ * built on it): Filter works in double, BasicFilter<float> halves the
+ * memory of the delay lines and doubles the samples per SIMD register
  */
-class Filter {
+template <typename T>
+class BasicFilter {
 public:
-    virtual double ProcessSample(double x) = 0;
+    typedef T sample_type;
+
+    virtual ~BasicFilter() {}
+
+    virtual T ProcessSample(T x) = 0;
+
+    // process a block of n samples (x and y may be the same buffer)
+    // filters override this to avoid a virtual call per sample
+    virtual void ProcessBlock(const T *x, T *y, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++)
+            y[i] = ProcessSample(x[i]);
+    }
+
+    // return a new copy of this filter (coefficients and state)
+    // used to give each channel of a multichannel file its own filter
+    // filters that can't be copied return nullptr
+    virtual BasicFilter *Clone() const { return nullptr; }
+
+    // length of the impulse response of a filter without feedback (FIR),
+    // 0 for filters with feedback or an unknown response
+    // FIR filters can filter separate parts of a file in parallel
+    virtual std::size_t ImpulseLength() const { return 0; }
+
+    // samples the output lags the input by because of buffering (a frame
+    // that has to fill before any of it comes out), 0 for none
+    // FilterWav drops that many from the start of the output
+    virtual std::size_t Latency() const { return 0; }
+
+    // process a block of n 16 bit samples (Q15), saturating the output
+    // filters with a fixed point version of their own (FixedPoint()
+    // true) override this; others convert the samples for ProcessBlock
+    // as wave_filter does (x and y may be the same buffer)
+    virtual void ProcessBlockQ15(const std::int16_t *x, std::int16_t *y,
+                                 std::size_t n) {
+        T buf[256];
+        for (std::size_t i = 0; i < n; i += 256) {
+            const std::size_t m = std::min<std::size_t>(n - i, 256);
+            for (std::size_t j = 0; j < m; j++)
+                buf[j] = T(x[i + j] / 32767.0);
+            ProcessBlock(buf, buf, m);
+            for (std::size_t j = 0; j < m; j++) {
+                const double v = std::max(-1.0, std::min(1.0, (double)buf[j]));
+                y[i + j] = (std::int16_t)((int)(32768.5 + 32767.0 * v) - 32768);
+            }
+        }
+    }
+
+    // ProcessBlockQ15() runs in fixed point, so FilterWav uses it for
+    // files that are 16 bit PCM in and out
+    virtual bool FixedPoint() const { return false; }
 };
 
+typedef BasicFilter<double> Filter;
+
 }
 #endif
@@ -0,0 +1,135 @@
+#include "fixed.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace dsp {
+
+template <typename T>
+void FixedDirectForm1::Quantize(const T *b, std::size_t nb, const T *a,
+                                std::size_t na)
+{
+    double big = 0.0, sum = 0.0, scale = 1073741824.0;     // 2^30
+
+    for (std::size_t n = 0; n < nb; n++) {
+        big = std::max(big, std::fabs((double)b[n]));
+        sum += std::fabs((double)b[n]);
+    }
+    for (std::size_t n = 1; n < na; n++) {
+        big = std::max(big, std::fabs((double)a[n]));
+        sum += std::fabs((double)a[n]);
+    }
+    // a Q23 sample is under 2^23, so the sums stay under 2^62
+    for (shift = 30; shift > 1; shift--, scale *= 0.5)
+        if (big * scale < 2147483647.0 && sum * scale < 549755813888.0)
+            break;
+
+    auto round = [scale](double c) -> std::int32_t {
+        c = std::floor(c * scale + 0.5);
+        return (std::int32_t)std::max(-2147483647.0,
+                                      std::min(2147483647.0, c));
+    };
+    qb.resize(nb);
+    qa.assign(na ? na : 1, 0);
+    for (std::size_t n = 0; n < nb; n++)
+        qb[n] = round(b[n]);
+    for (std::size_t n = 1; n < na; n++)
+        qa[n] = round(a[n]);
+
+    // the feedback ends at the last a that isn't zero
+    while (qa.size() > 1 && qa.back() == 0)
+        qa.pop_back();
+    const std::size_t xh = nb ? nb - 1 : 0, yh = qa.size() - 1;
+    if (x.size() != xh + block || y.size() != yh + block) {
+        x.assign(xh + block, 0);
+        y.assign(yh + block, 0);
+        acc.resize(block);
+    }
+}
+
+// ProcessBlock() for any lengths of b and a
+void FixedDirectForm1::Run(const std::int16_t *in, std::int16_t *out,
+                           std::size_t n)
+{
+    const int L = qb.size(), M = qa.size();
+    const std::int32_t top = 32767 * 256;
+    const std::int32_t *b = qb.data(), *a = qa.data();
+    std::int32_t *xl = x.data() + L - 1, *yl = y.data() + M - 1;
+
+    for (std::size_t i = 0; i < n; i += block) {
+        const std::size_t m = std::min<std::size_t>(n - i, block);
+
+        for (std::size_t j = 0; j < m; j++)
+            xl[j] = (std::int32_t)in[i + j] * 256;
+        for (std::size_t j = 0; j < m; j++) {
+            std::int64_t v = (std::int64_t)1 << (shift - 1);     // (to round)
+            for (int k = 0; k < L; k++)
+                v += (std::int64_t)b[k] * xl[(std::ptrdiff_t)j - k];
+            acc[j] = v;
+        }
+
+        for (std::size_t j = 0; j < m; j++) {
+            std::int64_t v = acc[j];
+            for (int k = 1; k < M; k++)
+                v -= (std::int64_t)a[k] * yl[(std::ptrdiff_t)j - k];
+            v = std::max<std::int64_t>(-top, std::min<std::int64_t>(top,
+                                                                  v >> shift));
+            yl[j] = (std::int32_t)v;
+            out[i + j] = (std::int16_t)((v + 128) >> 8);
+        }
+
+        // the newest samples back to the start as the histories
+        std::memmove(x.data(), xl + m - (L - 1),
+                     (L - 1) * sizeof(std::int32_t));
+        std::memmove(y.data(), yl + m - (M - 1),
+                     (M - 1) * sizeof(std::int32_t));
+    }
+}
+
+// ProcessBlock() for a second order section, with the state in registers
+void FixedDirectForm1::Biquad(const std::int16_t *in, std::int16_t *out,
+                              std::size_t n)
+{
+    const std::int32_t top = 32767 * 256;
+    const std::int64_t b0 = qb[0], b1 = qb[1], b2 = qb[2];
+    const std::int64_t a1 = qa[1], a2 = qa[2];
+    const std::int64_t half = (std::int64_t)1 << (shift - 1);
+    std::int64_t x1 = x[0], x2 = x[1], y1 = y[0], y2 = y[1];
+
+    // (x and y hold the newest sample second, as Run() leaves them)
+    std::swap(x1, x2);
+    std::swap(y1, y2);
+    for (std::size_t i = 0; i < n; i++) {
+        const std::int64_t x0 = (std::int64_t)in[i] * 256;
+        std::int64_t v = half + b0 * x0 + b1 * x1 + b2 * x2 - a2 * y2;
+        v = (v - a1 * y1) >> shift;
+        v = std::max<std::int64_t>(-top, std::min<std::int64_t>(top, v));
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = v;
+        out[i] = (std::int16_t)((v + 128) >> 8);
+    }
+    x[0] = x2;
+    x[1] = x1;
+    y[0] = y2;
+    y[1] = y1;
+}
+
+void FixedDirectForm1::ProcessBlock(const std::int16_t *in,
+                                    std::int16_t *out, std::size_t n)
+{
+    if (qb.empty())
+        std::memset(out, 0, n * sizeof(*out));
+    else if (qb.size() == 3 && qa.size() == 3)
+        Biquad(in, out, n);
+    else
+        Run(in, out, n);
+}
+
+template void FixedDirectForm1::Quantize(const float *, std::size_t,
+                                         const float *, std::size_t);
+template void FixedDirectForm1::Quantize(const double *, std::size_t,
+                                         const double *, std::size_t);
+
+}
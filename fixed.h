@@ -0,0 +1,55 @@
+#ifndef DSP_FIXED_H_INCLUDED
+#define DSP_FIXED_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dsp {
+
+/*
+ * fixed point direct form I for 16 bit PCM samples
+ *
+ * the fixed point version (ProcessBlockQ15) of BiQuad and the direct
+ * forms: whatever the form of the floating point filter, in fixed point
+ * it is a direct form I, the one form whose state is just the input and
+ * output samples and so can't overflow.
+ *
+ *  y[n] = (b[0]x[n] + ... + b[L]x[n-L] - a[1]y[n-1] - ... - a[M]y[n-M])
+ *
+ * b and a are quantized to 32 bit Q(shift) values, shift as large as
+ * keeps every coefficient within 32 bits and the whole sum within the
+ * 64 bit accumulator. The histories hold the samples with 8 fraction
+ * bits more than Q15 (Q23), so the feedback of a narrow filter isn't
+ * fed back rounded to the 16 bits of the output, which is rounded and
+ * saturated. The block is laid out after the histories and its feed
+ * forward sums are done first (they are independent and vectorize),
+ * then the feedback a sample at a time; a second order section is done
+ * a sample at a time with its state in registers, as BiQuad does.
+ */
+class FixedDirectForm1 {
+    std::vector<std::int32_t> qb, qa;   // Q(shift) coefficients
+    int shift;
+    std::vector<std::int32_t> x, y;     // Q23 histories then the block
+    std::vector<std::int64_t> acc;      // feed forward sums of the block
+
+    void Run(const std::int16_t *in, std::int16_t *out, std::size_t n);
+    void Biquad(const std::int16_t *in, std::int16_t *out, std::size_t n);
+public:
+    static const int block = 256;       // samples filtered at a time
+
+    FixedDirectForm1() : shift{1} {}
+
+    // quantize b (nb of them) and a (na, a[0] is taken as 1), keeping
+    // the histories (cleared if the lengths change)
+    template <typename T>
+    void Quantize(const T *b, std::size_t nb, const T *a, std::size_t na);
+
+    // filter n samples (x and y may be the same buffer)
+    void ProcessBlock(const std::int16_t *in, std::int16_t *out,
+                      std::size_t n);
+};
+
+}
+
+#endif
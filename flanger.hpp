@@ -1,5 +1,6 @@
 #include "filter.hpp"
 #include "delay.h"
+#include "oscillator.h"
 #include <cmath>
 
 namespace dsp {
@@ -8,24 +9,67 @@ class Flanger: public Filter {
     Delay w;            // delay line
     int N;              // length of delay line
     double T;           // sample period
+    double step;        // rate lfo is stepping at
+    double seen;        // phase as last left, to spot one written
+    Oscillator lfo;     // sweeps the delay (no cos() or growing phase)
+
+    // a new rate steps the oscillator on from where it is, a new phase
+    // starts it again from there
+    void Retune() {
+        if (phase != seen) {
+            lfo = Oscillator(rate, 1.0 / T, 2 * pi * rate * phase);
+            step = rate;
+        } else if (rate != step) {
+            lfo.SetFrequency(rate, 1.0 / T);
+            step = rate;
+            if (rate != 0.0) {
+                double a = std::atan2(lfo.Sin(), lfo.Cos());
+                phase = (a < 0.0 ? a + 2 * pi : a) / (2 * pi * rate);
+            }
+        }
+        seen = phase;
+    }
+    // move phase on by n samples, within a cycle
+    void Advance(std::size_t n) {
+        phase += n * T;
+        if (rate > 0.0 && phase >= 1.0 / rate)
+            phase = std::fmod(phase, 1.0 / rate);
+        seen = phase;
+    }
+    double Sweep(double x) {
+        double n, y;
+
+        w[0] = x;
+        n = (N - 1) * (0.5 * lfo.Next() + 0.5);
+        y = 0.5 * w[N / 2] + 0.5 * w[n];
+        w.Shift();
+
+        return y;
+    }
 public:
     double rate;        // rate of flanger
-    double phase;       // current phase of flanger (time)
+    double phase;       // current phase of flanger (time into the cycle)
 
     Flanger(int n, int fs, double rate = 0.0)
-    : w(n), N{n}, T{1.0 / fs}, rate{rate}, phase{} {}
+    : w(n), N{n}, T{1.0 / fs}, step{rate}, seen{}, lfo(rate, fs),
+      rate{rate}, phase{} {}
 
     // process one sample
     double ProcessSample(double x) {
-        double n, y;
+        Retune();
+        const double y = Sweep(x);
+        Advance(1);
+        return y;
+    }
 
-        w[0] = x;
-        n = (N - 1) * (0.5 * cos(2 * pi * rate * phase) + 0.5);
-        y = 0.5 * w[N / 2] + 0.5 * w[n];
-        phase += T;
-        w.Shift();
+    Flanger *Clone() const { return new Flanger(*this); }
 
-        return y;
+    // process a block of samples
+    void ProcessBlock(const double *x, double *y, std::size_t n) {
+        Retune();
+        for (std::size_t i = 0; i < n; i++)
+            y[i] = Sweep(x[i]);
+        Advance(n);
     }
 };
 
@@ -0,0 +1,337 @@
+#include "graph.h"
+#include <algorithm>
+
+namespace dsp {
+
+// threads running graphs, out of thread_cpu_count(), for all graphs
+static std::atomic<int> budget_used{0};
+
+Graph::Graph(std::size_t quantum, std::size_t depth)
+: Q{quantum ? quantum : 1}, D{depth ? depth : 1}, out{-1},
+  started{false}, reserved{0}, stop{false}, bx{}, by{}, bn{}, first{},
+  end{}
+{
+    runners.emplace_back(new Runner{this, {input}, {}, {}});
+    nodes.emplace_back(new Node(this, input, Stage{(Filter *)nullptr},
+                                false, {}));
+    nodes.back()->slots.resize(D * Q);
+    nodes.back()->runner = runners[0].get();
+}
+
+Graph::~Graph()
+{
+    stop.store(true);
+    for (std::size_t r = 1; r < runners.size(); r++)
+        thread_sem_post(&runners[r]->wake);
+    for (std::size_t r = 1; r < runners.size(); r++) {
+        thread_join(&runners[r]->t);
+        thread_sem_destroy(&runners[r]->wake);
+    }
+    if (runners.size() > 1)
+        thread_sem_destroy(&runners[0]->wake);
+    budget_used -= reserved;
+
+    for (std::unique_ptr<Node> &nd : nodes) {
+        if (!nd->owned)
+            continue;
+        if (nd->stage.filter)
+            delete nd->stage.filter;
+        else if (nd->stage.destroy)
+            nd->stage.destroy(nd->stage.state);
+    }
+}
+
+/*
+ * Graph::Insert() - add a node
+ * s: the stage it runs
+ * owned: s is a clone for the graph to free
+ * from: its inputs, all earlier nodes
+ *
+ * Return: the new node, -1 if there are no inputs or one isn't a node
+ */
+int Graph::Insert(const Stage &s, bool owned, const std::vector<Send> &from)
+{
+    const int id = Nodes();
+
+    if (from.empty())
+        return -1;
+    for (const Send &in : from)
+        if (in.from < 0 || in.from >= id)
+            return -1;
+    nodes.emplace_back(new Node(this, id, s, owned, from));
+    nodes.back()->slots.resize(D * Q);
+    nodes.back()->runner = runners[0].get();    // (until Start())
+    runners[0]->nodes.push_back(id);
+    for (const Send &in : from)
+        nodes[in.from]->to.push_back(id);
+    return id;
+}
+
+int Graph::Add(const Stage &s, const std::vector<Send> &from)
+{
+    return Insert(s, false, from);
+}
+
+int Graph::Mix(const std::vector<Send> &from)
+{
+    return Insert(Stage{(Filter *)nullptr}, false, from);
+}
+
+void Graph::Node::Process(const double *in, double *out, std::size_t n)
+{
+    if (stage.filter)
+        stage.filter->ProcessBlock(in, out, n);
+    else if (stage.block)
+        stage.block(stage.state, in, out, n);
+    else if (stage.sample)
+        for (std::size_t i = 0; i < n; i++)
+            out[i] = stage.sample(stage.state, in[i]);
+    else if (in != out)
+        std::copy(in, in + n, out);
+}
+
+double Graph::ProcessSample(double x)
+{
+    for (std::unique_ptr<Node> &nd : nodes) {
+        double v = x;
+
+        if (nd->id != input) {
+            v = 0.0;
+            for (const Send &in : nd->from)
+                v += in.gain * nodes[in.from]->value;
+            if (nd->stage.filter)
+                v = nd->stage.filter->ProcessSample(v);
+            else if (nd->stage.block)
+                nd->stage.block(nd->stage.state, &v, &v, 1);
+            else if (nd->stage.sample)
+                v = nd->stage.sample(nd->stage.state, v);
+        }
+        nd->value = v;
+    }
+    return nodes[out < 0 ? Last() : out]->value;
+}
+
+std::size_t Graph::Latency() const
+{
+    std::vector<std::size_t> late(nodes.size(), 0);
+
+    for (int j = 1; j < Nodes(); j++) {
+        const Node &nd = *nodes[j];
+
+        for (const Send &in : nd.from)
+            late[j] = std::max(late[j], late[in.from]);
+        if (nd.stage.filter)
+            late[j] += nd.stage.filter->Latency();
+    }
+    return late[out < 0 ? Last() : out];
+}
+
+/*
+ * Graph::Ready() - can node take quantum k
+ * every input has finished k (the input node: k is in the block), and
+ * every node reading it has finished k - depth, the last quantum in the
+ * slot k is written to
+ */
+bool Graph::Ready(int node, std::size_t k) const
+{
+    const Node &nd = *nodes[node];
+
+    if (node == input && k >= end)
+        return false;
+    for (const Send &in : nd.from)
+        if (nodes[in.from]->done.load(std::memory_order_acquire) <= k)
+            return false;
+    for (int c : nd.to)
+        if (nodes[c]->done.load(std::memory_order_acquire) + D <= k)
+            return false;
+    return true;
+}
+
+/*
+ * Graph::Step() - run node on quantum k of the block
+ * the input node copies it out of the block, the others mix their
+ * inputs into their slot (or read a single input's slot directly) and
+ * run their stage on it, and the output node copies it into the block.
+ * The runners of the nodes either side are woken, and the caller's
+ * when the node has finished the block.
+ */
+void Graph::Step(int node, std::size_t k)
+{
+    Node &nd = *nodes[node];
+    const std::size_t off = (k - first) * Q;
+    const std::size_t m = std::min(Q, bn - off);
+    const bool last = k + 1 == end;
+    double *o = Slot(node, k);
+
+    if (node == input) {
+        std::copy(bx + off, bx + off + m, o);
+    } else if (nd.from.size() == 1 && nd.from[0].gain == 1.0) {
+        nd.Process(Slot(nd.from[0].from, k), o, m);
+    } else {
+        const double *s0 = Slot(nd.from[0].from, k);
+        const double g0 = nd.from[0].gain;
+        for (std::size_t i = 0; i < m; i++)
+            o[i] = g0 * s0[i];
+        for (std::size_t j = 1; j < nd.from.size(); j++) {
+            const double *s = Slot(nd.from[j].from, k);
+            const double g = nd.from[j].gain;
+            for (std::size_t i = 0; i < m; i++)
+                o[i] += g * s[i];
+        }
+        nd.Process(o, o, m);
+    }
+    if (node == (out < 0 ? Last() : out))
+        std::copy(o, o + m, by + off);
+    // (nothing of the block is touched after this: once every node has
+    // stored its last quantum the caller returns)
+    nd.done.store(k + 1, std::memory_order_release);
+
+    if (runners.size() <= 1)
+        return;
+    for (const Send &in : nd.from)
+        if (nodes[in.from]->runner != nd.runner)
+            thread_sem_post(&nodes[in.from]->runner->wake);
+    for (int c : nd.to)
+        if (nodes[c]->runner != nd.runner)
+            thread_sem_post(&nodes[c]->runner->wake);
+    if (last && nd.runner != runners[0].get())
+        thread_sem_post(&runners[0]->wake);
+}
+
+/*
+ * Graph::Drive() - run the nodes of a runner
+ * steps each node whenever it is ready, sleeping when none is; the
+ * caller returns when every node has finished the block, a worker
+ * when the graph is stopped
+ */
+void Graph::Drive(Runner &r, bool caller)
+{
+    for (;;) {
+        bool busy = false;
+
+        for (int node : r.nodes) {
+            const std::size_t k = nodes[node]->done.load(
+                std::memory_order_relaxed);
+            if (Ready(node, k)) {
+                Step(node, k);
+                busy = true;
+            }
+        }
+        if (caller) {
+            bool left = false;
+            for (const std::unique_ptr<Node> &nd : nodes)
+                if (nd->done.load(std::memory_order_acquire) < end)
+                    left = true;
+            if (!left)
+                break;
+        } else if (stop.load()) {
+            break;
+        }
+        // (on its own the caller always has a node ready)
+        if (!busy && runners.size() > 1)
+            thread_sem_wait(&r.wake);
+    }
+}
+
+// a worker waits for Start() to give it its nodes, then runs them
+void Graph::Worker(void *arg)
+{
+    Runner *r = static_cast<Runner *>(arg);
+    thread_sem_wait(&r->wake);
+    r->g->Drive(*r, false);
+}
+
+/*
+ * Graph::Start() - start the workers
+ * the caller takes a thread of the budget for itself and runs the input,
+ * the other nodes are dealt out to as many workers as the budget has
+ * left, up to one each. Without any, the caller keeps every node.
+ */
+void Graph::Start()
+{
+    const int cpus = thread_cpu_count();
+    int workers = 0;
+
+    started = true;
+    reserved = 1;
+    budget_used++;
+    while (workers < Nodes() - 1) {
+        int used = budget_used.load();
+        if (used >= cpus)
+            break;
+        if (budget_used.compare_exchange_weak(used, used + 1))
+            workers++;
+    }
+    if (workers > 0 && thread_sem_init(&runners[0]->wake, 0) != 0)
+        workers = 0;
+    for (int w = 0; w < workers; w++) {
+        std::unique_ptr<Runner> r{new Runner{this, {}, {}, {}}};
+        if (thread_sem_init(&r->wake, 0) != 0)
+            break;
+        if (thread_create(&r->t, Worker, r.get()) != 0) {
+            thread_sem_destroy(&r->wake);
+            break;
+        }
+        runners.push_back(std::move(r));
+    }
+    budget_used -= workers - (int(runners.size()) - 1);
+    workers = int(runners.size()) - 1;
+    reserved += workers;
+    if (workers == 0) {
+        thread_sem_destroy(&runners[0]->wake);
+        return;
+    }
+
+    runners[0]->nodes.clear();
+    for (int j = 0; j < Nodes(); j++) {
+        Runner *r = runners[j == input ? 0 : 1 + (j - 1) % workers].get();
+        nodes[j]->runner = r;
+        r->nodes.push_back(j);
+    }
+    for (int w = 1; w <= workers; w++)
+        thread_sem_post(&runners[w]->wake);
+}
+
+/*
+ * Graph::ProcessBlock() - run a block through the graph
+ * the first block more than a quantum long starts the workers, which
+ * the calling thread then feeds from the input node; until then, or
+ * without workers, the calling thread runs every node in turn
+ */
+void Graph::ProcessBlock(const double *x, double *y, std::size_t n)
+{
+    if (n == 0)
+        return;
+    bx = x;
+    by = y;
+    bn = n;
+    first = end;
+    end = first + (n + Q - 1) / Q;
+    if (!started && end - first > 1 && Nodes() > 1)
+        Start();
+    Drive(*runners[0], true);
+}
+
+Graph *Graph::Clone() const
+{
+    Graph *g = new Graph(Q, D);
+
+    g->out = out;
+    for (int j = 1; j < Nodes(); j++) {
+        Stage s = nodes[j]->stage;
+        bool ok = true;
+
+        if (s.filter)
+            ok = (s.filter = s.filter->Clone()) != nullptr;
+        else if (s.block || s.sample)
+            ok = s.clone && (s.state = s.clone(s.state)) != nullptr;
+        if (!ok) {
+            delete g;
+            return nullptr;
+        }
+        g->Insert(s, true, nodes[j]->from);
+    }
+    return g;
+}
+
+} // namespace dsp
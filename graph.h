@@ -0,0 +1,193 @@
+#ifndef DSP_GRAPH_H_INCLUDED
+#define DSP_GRAPH_H_INCLUDED
+
+#include "filter.hpp"
+extern "C" {
+#include "filter.h"
+#include "thread.h"
+}
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace dsp {
+
+/*
+ * Graph - filters connected in series and in parallel, run as a pipeline
+ *
+ *  dsp::Graph g;
+ *  int eq = g.Add(&highpass);                        // after the input
+ *  g.Add(dsp::Graph::Stage{(filter_func)delay_sample, pre});
+ *  int wet = g.Add(&reverb);                         // after the delay
+ *  g.Mix({{eq, 0.7}, {wet, 0.3}});                   // dry/wet
+ *  g.Add(&limiter);                                  // the output
+ *
+ *  x --→ [highpass] --+------------------------→ (+) --→ [limiter] --→ y
+ *                     |                    0.7   ↑ 0.3
+ *                     +--→ [delay] --→ [reverb] -+
+ *
+ * node 0 is the input. Each node sums its inputs, each with a gain, and
+ * runs them through its stage: a dsp::Filter, a C block_filter_func or
+ * filter_func with its state (canfltr_block, cirfltr_block, delay_sample),
+ * or nothing for a plain mix. The output is the last node added unless
+ * Output() picks another. A node can only take input from the nodes
+ * before it, so the order they were added in is an order to run them in.
+ *
+ * ProcessBlock() cuts the block into quanta and runs the nodes on
+ * worker threads started by the first block more than a quantum long,
+ * which then stay for the life of the graph. A node takes quantum k when
+ * all its inputs have finished k, and writes it into one of depth slots,
+ * which makes the slots a bounded queue to the nodes reading from it: a
+ * node stalls until its slowest reader is less than depth quanta behind.
+ * With every stage busy on a different quantum, a chain of six stages
+ * keeps six processors busy. A worker with nothing ready sleeps until a
+ * node next to one of its own finishes a quantum, so the workers cost
+ * nothing between blocks.
+ *
+ * The workers of every graph come out of one budget of a thread per
+ * processor, less one for each thread calling ProcessBlock(): when the
+ * channels of a file are filtered by clones on their own threads, the
+ * clones share the processors rather than each starting a thread per
+ * node. Nodes beyond the workers a graph got are shared out between
+ * them, and with none the calling thread runs every node in turn.
+ *
+ * Every stage sees the same quanta in the same order whether the block
+ * is pipelined or not, so the output doesn't depend on the threads.
+ * Give the graph blocks many quanta long (wave_options.block) for the
+ * stages to overlap; until the first one, blocks only a quantum long are
+ * run on the calling thread.
+ */
+class Graph: public Filter {
+public:
+    // what a node does with its input
+    struct Stage {
+        Filter *filter;
+        block_filter_func block;
+        filter_func sample;
+        void *state;
+        void *(*clone)(void *state);    // for Clone(), or nullptr
+        void (*destroy)(void *state);   // frees what clone returned
+
+        // a dsp filter (Filter::Clone() copies it)
+        Stage(Filter *f)
+        : filter{f}, block{}, sample{}, state{}, clone{}, destroy{} {}
+        // a C module's block function and state
+        Stage(block_filter_func f, void *state,
+              void *(*clone)(void *) = nullptr,
+              void (*destroy)(void *) = nullptr)
+        : filter{}, block{f}, sample{}, state{state}, clone{clone},
+          destroy{destroy} {}
+        // a C module's sample function and state
+        Stage(filter_func f, void *state,
+              void *(*clone)(void *) = nullptr,
+              void (*destroy)(void *) = nullptr)
+        : filter{}, block{}, sample{f}, state{state}, clone{clone},
+          destroy{destroy} {}
+    };
+
+    // an input of a node: the output of node from times gain
+    struct Send {
+        int from;
+        double gain;
+    };
+
+    // the input node
+    static const int input = 0;
+
+    // quantum: samples each stage takes at a time
+    // depth: quanta a node can be ahead of the nodes reading from it
+    explicit Graph(std::size_t quantum = 1024, std::size_t depth = 4);
+    ~Graph();
+    Graph(const Graph &) = delete;
+    Graph &operator=(const Graph &) = delete;
+
+    // add a node running s on the output of the last node added
+    // Return: the new node
+    int Add(const Stage &s) { return Add(s, {{Last(), 1.0}}); }
+    // add a node running s on the output of node from
+    int Add(const Stage &s, int from) { return Add(s, {{from, 1.0}}); }
+    // add a node running s on the mix of several nodes
+    int Add(const Stage &s, const std::vector<Send> &from);
+    // add a node that only mixes several nodes
+    int Mix(const std::vector<Send> &from);
+    // take the output of the graph from node n (default the last added)
+    void Output(int n) { out = n; }
+
+    // number of nodes, including the input
+    int Nodes() const { return int(nodes.size()); }
+    int Last() const { return Nodes() - 1; }
+
+    double ProcessSample(double x);
+    void ProcessBlock(const double *x, double *y, std::size_t n);
+    // latency of the output: the stages' latencies (Filter::Latency(), 0
+    // for a C stage) added along the path to it, the longest where
+    // paths join (a mix doesn't line its inputs up: delay the shorter)
+    std::size_t Latency() const;
+
+    // a graph of clones of every stage; nullptr if a stage can't be
+    // cloned (a Filter without Clone(), a C state without clone)
+    // (the clone starts its own workers)
+    Graph *Clone() const;
+
+private:
+    struct Runner;
+
+    struct Node {
+        Graph *g;
+        int id;
+        Stage stage;
+        bool owned;                     // stage is a clone to free
+        std::vector<Send> from;         // inputs
+        std::vector<int> to;            // nodes reading this one
+        std::vector<double> slots;      // depth quanta of output
+        std::atomic<std::size_t> done;  // quanta finished, ever
+        double value;                   // output of ProcessSample()
+        Runner *runner;                 // thread running the node
+
+        Node(Graph *g, int id, const Stage &s, bool owned,
+             const std::vector<Send> &from)
+        : g{g}, id{id}, stage(s), owned{owned}, from(from), done{0},
+          value{}, runner{} {}
+
+        // run the stage on n samples (in and out may be the same)
+        void Process(const double *in, double *out, std::size_t n);
+    };
+
+    // a thread and the nodes it runs (runners[0] is the calling thread)
+    struct Runner {
+        Graph *g;
+        std::vector<int> nodes;
+        struct thread_sem wake;         // posted as its nodes may be ready
+        struct thread t;
+    };
+
+    std::size_t Q;                      // quantum
+    std::size_t D;                      // depth
+    int out;                            // output node, -1 for the last
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<std::unique_ptr<Runner>> runners;
+    bool started;                       // runners set up
+    int reserved;                       // of the thread budget
+    std::atomic<bool> stop;             // for the workers to exit
+
+    // the block being processed: quanta first up to end
+    const double *bx;
+    double *by;
+    std::size_t bn;
+    std::size_t first, end;
+
+    int Insert(const Stage &s, bool owned, const std::vector<Send> &from);
+    double *Slot(int node, std::size_t k) {
+        return &nodes[node]->slots[(k % D) * Q];
+    }
+    bool Ready(int node, std::size_t k) const;
+    void Step(int node, std::size_t k);
+    void Start();
+    void Drive(Runner &r, bool caller);
+    static void Worker(void *arg);
+};
+
+} // namespace dsp
+
+#endif
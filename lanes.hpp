@@ -0,0 +1,54 @@
+#ifndef DSP_LANES_HPP_INCLUDED
+#define DSP_LANES_HPP_INCLUDED
+
+namespace dsp {
+
+// number of doubles processed side by side by the block kernels
+const int lanes = 4;
+
+/*
+ * LanesOf<T>::type - a group of T operated on together, as many as fit
+ * in the bytes of `lanes` doubles (so 4 doubles or 8 floats)
+ * GCC and clang turn arithmetic on it into SIMD instructions; other
+ * compilers get a plain struct with the same operators. Load and store
+ * with memcpy since the buffers are only aligned for T.
+ */
+#if defined(__GNUC__)
+template <typename T>
+struct LanesOf {
+    static const int size = lanes * sizeof(double) / sizeof(T);
+    typedef T type __attribute__((vector_size(lanes * sizeof(double))));
+};
+#else
+template <typename T>
+struct LanesOf {
+    static const int size = lanes * sizeof(double) / sizeof(T);
+    struct type {
+        T v[size];
+        T& operator[](int l) { return v[l]; }
+        friend type operator*(T a, type b) {
+            for (int l = 0; l < size; l++) b[l] *= a;
+            return b;
+        }
+        friend type operator*(type a, type b) {
+            for (int l = 0; l < size; l++) a[l] *= b[l];
+            return a;
+        }
+        friend type operator+(type a, type b) {
+            for (int l = 0; l < size; l++) a[l] += b[l];
+            return a;
+        }
+        friend type operator-(type a, type b) {
+            for (int l = 0; l < size; l++) a[l] -= b[l];
+            return a;
+        }
+    };
+};
+#endif
+
+// a group of `lanes` doubles
+typedef LanesOf<double>::type Lanes;
+
+} // namespace dsp
+
+#endif
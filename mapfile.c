@@ -0,0 +1,166 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+#include "mapfile.h"
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+/* Win32 implementation of mapfile_read() */
+int mapfile_read(struct mapfile *m, const char *filename)
+{
+    LARGE_INTEGER size;
+
+    m->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m->file == INVALID_HANDLE_VALUE)
+        goto fail;
+    if (!GetFileSizeEx(m->file, &size) || size.QuadPart == 0)
+        goto fail_file;
+    m->size = (size_t)size.QuadPart;
+    m->map = CreateFileMappingA(m->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m->map)
+        goto fail_file;
+    m->addr = MapViewOfFile(m->map, FILE_MAP_READ, 0, 0, 0);
+    if (!m->addr)
+        goto fail_map;
+    return 0;
+
+fail_map:
+    CloseHandle(m->map);
+fail_file:
+    CloseHandle(m->file);
+fail:
+    fprintf(stderr, "%s: could not map file (error %lu)\n",
+            filename, (unsigned long)GetLastError());
+    return -1;
+}
+
+/* Win32 implementation of mapfile_write() */
+int mapfile_write(struct mapfile *m, const char *filename, size_t size)
+{
+    LARGE_INTEGER len;
+
+    m->file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m->file == INVALID_HANDLE_VALUE)
+        goto fail;
+    len.QuadPart = size;
+    if (!SetFilePointerEx(m->file, len, NULL, FILE_BEGIN)
+        || !SetEndOfFile(m->file))
+        goto fail_file;
+    m->size = size;
+    m->map = CreateFileMappingA(m->file, NULL, PAGE_READWRITE,
+                                (DWORD)(size >> 16 >> 16),
+                                (DWORD)size, NULL);
+    if (!m->map)
+        goto fail_file;
+    m->addr = MapViewOfFile(m->map, FILE_MAP_WRITE, 0, 0, 0);
+    if (!m->addr)
+        goto fail_map;
+    return 0;
+
+fail_map:
+    CloseHandle(m->map);
+fail_file:
+    CloseHandle(m->file);
+fail:
+    fprintf(stderr, "%s: could not map file (error %lu)\n",
+            filename, (unsigned long)GetLastError());
+    return -1;
+}
+
+/* Win32 implementation of mapfile_close() */
+void mapfile_close(struct mapfile *m)
+{
+    UnmapViewOfFile(m->addr);
+    CloseHandle(m->map);
+    CloseHandle(m->file);
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * mapfile_read() - map an entire file read only
+ * m: mapping to initialize
+ * filename: file to map
+ *
+ * Return: 0 on success
+ *        -1 on failure (a message has been printed to stderr)
+ */
+int mapfile_read(struct mapfile *m, const char *filename)
+{
+    struct stat st;
+
+    m->fd = open(filename, O_RDONLY);
+    if (m->fd < 0)
+        goto fail;
+    if (fstat(m->fd, &st) < 0)
+        goto fail_fd;
+    if (st.st_size == 0) {
+        fprintf(stderr, "%s: cannot map an empty file\n", filename);
+        close(m->fd);
+        return -1;
+    }
+    m->size = st.st_size;
+    m->addr = mmap(NULL, m->size, PROT_READ, MAP_SHARED, m->fd, 0);
+    if (m->addr == MAP_FAILED)
+        goto fail_fd;
+#ifdef POSIX_MADV_SEQUENTIAL
+    /* let the kernel read ahead aggressively */
+    posix_madvise(m->addr, m->size, POSIX_MADV_SEQUENTIAL);
+#endif
+    return 0;
+
+fail_fd:
+    close(m->fd);
+fail:
+    perror(filename);
+    return -1;
+}
+
+/*
+ * mapfile_write() - map a file read/write
+ * m: mapping to initialize
+ * filename: file to map (it must already exist)
+ * size: length to extend or truncate the file to
+ *
+ * Return: 0 on success
+ *        -1 on failure (a message has been printed to stderr)
+ */
+int mapfile_write(struct mapfile *m, const char *filename, size_t size)
+{
+    m->fd = open(filename, O_RDWR);
+    if (m->fd < 0)
+        goto fail;
+    if (ftruncate(m->fd, size) < 0)
+        goto fail_fd;
+    m->size = size;
+    m->addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0);
+    if (m->addr == MAP_FAILED)
+        goto fail_fd;
+    return 0;
+
+fail_fd:
+    close(m->fd);
+fail:
+    perror(filename);
+    return -1;
+}
+
+/*
+ * mapfile_close() - unmap and close a file
+ * m: mapping to close
+ */
+void mapfile_close(struct mapfile *m)
+{
+    munmap(m->addr, m->size);
+    close(m->fd);
+}
+
+#endif
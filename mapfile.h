@@ -0,0 +1,31 @@
+#ifndef DSP_MAPFILE_H_INCLUDED
+#define DSP_MAPFILE_H_INCLUDED
+
+/*
+ * memory mapped files
+ * POSIX mmap() or the Win32 file mapping equivalent
+ */
+
+#include <stddef.h>
+
+struct mapfile {
+    void *addr;     /* start of the mapping */
+    size_t size;    /* length of the mapping in bytes */
+#ifdef _WIN32
+    void *file;     /* file HANDLE */
+    void *map;      /* file mapping HANDLE */
+#else
+    int fd;         /* file descriptor */
+#endif
+};
+
+/* map an entire file read only */
+int mapfile_read(struct mapfile *m, const char *filename);
+
+/* map a file read/write after resizing it to size bytes */
+int mapfile_write(struct mapfile *m, const char *filename, size_t size);
+
+/* unmap and close a file */
+void mapfile_close(struct mapfile *m);
+
+#endif
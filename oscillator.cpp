@@ -0,0 +1,37 @@
+#include "oscillator.h"
+#include "filter.hpp"
+#include <cmath>
+
+namespace dsp {
+
+Oscillator::Oscillator(double f, double fs, double phase)
+: c{std::cos(phase)}, s{std::sin(phase)}
+{
+    SetFrequency(f, fs);
+}
+
+/*
+ * Oscillator::SetFrequency() - change the rate of the oscillator
+ * f: frequency in Hz
+ * fs: sample rate in Hz
+ */
+void Oscillator::SetFrequency(double f, double fs)
+{
+    const double d = 2 * pi * f / fs;
+
+    dc = std::cos(d);
+    ds = std::sin(d);
+}
+
+/*
+ * Oscillator::Block() - generate a block of the oscillator output
+ * (a control rate buffer for modulating a whole block at once)
+ * y: n output values
+ */
+void Oscillator::Block(double *y, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; i++)
+        y[i] = Next();
+}
+
+}
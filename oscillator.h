@@ -0,0 +1,49 @@
+#ifndef DSP_OSCILLATOR_H_INCLUDED
+#define DSP_OSCILLATOR_H_INCLUDED
+
+#include <cstddef>
+
+namespace dsp {
+/*
+ * recursive quadrature oscillator (sine/cosine LFO)
+ *
+ * the phase is kept as the point (c, s) on the unit circle and every
+ * sample rotates it by the phase step:
+ *
+ *   c' = c·cos(d) - s·sin(d)
+ *   s' = s·cos(d) + c·sin(d)
+ *
+ * so there is no cos() per sample and the phase never grows without bound.
+ * Rounding would slowly change the radius, so each step also pulls it
+ * back towards 1 (a first order approximation of dividing by the radius).
+ */
+
+class Oscillator {
+    double c, s;    /* cos and sin of the current phase */
+    double dc, ds;  /* cos and sin of the phase step */
+public:
+    /* f: frequency in Hz, fs: sample rate, phase: starting phase in radians */
+    Oscillator(double f = 0.0, double fs = 1.0, double phase = 0.0);
+    /* change the frequency, keeping the current phase */
+    void SetFrequency(double f, double fs);
+    /* cos of the current phase */
+    double Cos() const { return c; }
+    /* sin of the current phase */
+    double Sin() const { return s; }
+    /* advance by one sample */
+    void Step() {
+        const double c1 = c * dc - s * ds;
+        const double s1 = s * dc + c * ds;
+        const double g = 1.5 - 0.5 * (c1 * c1 + s1 * s1);
+        c = g * c1;
+        s = g * s1;
+    }
+    /* cos of the current phase, then advance by one sample */
+    double Next() { const double y = c; Step(); return y; }
+    /* fill y with the next n values of Next() */
+    void Block(double *y, std::size_t n);
+};
+
+}
+
+#endif
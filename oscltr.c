@@ -0,0 +1,51 @@
+#include "oscltr.h"
+#include <math.h>
+
+#define PI 3.14159265358979323846
+
+/*
+ * oscltr_init() - initialize an oscillator
+ * o: oscillator to initialize
+ * f: frequency in Hz
+ * fs: sample rate in Hz
+ * phase: starting phase in radians
+ */
+void oscltr_init(struct oscltr *o, double f, double fs, double phase)
+{
+    o->c = cos(phase);
+    o->s = sin(phase);
+    oscltr_freq(o, f, fs);
+}
+
+/*
+ * oscltr_freq() - change the rate of an oscillator
+ * o: pointer to the oscillator
+ * f: frequency in Hz
+ * fs: sample rate in Hz
+ */
+void oscltr_freq(struct oscltr *o, double f, double fs)
+{
+    double d = 2 * PI * f / fs;
+
+    o->dc = cos(d);
+    o->ds = sin(d);
+}
+
+/*
+ * oscltr_next() - step the oscillator
+ * o: pointer to the oscillator
+ *
+ * Return: cos of the phase before the step
+ */
+double oscltr_next(struct oscltr *o)
+{
+    double y = o->c, c1, s1, g;
+
+    c1 = o->c * o->dc - o->s * o->ds;
+    s1 = o->s * o->dc + o->c * o->ds;
+    g = 1.5 - 0.5 * (c1 * c1 + s1 * s1);
+    o->c = g * c1;
+    o->s = g * s1;
+
+    return y;
+}
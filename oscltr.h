@@ -0,0 +1,29 @@
+#ifndef DSP_OSCLTR_H_INCLUDED
+#define DSP_OSCLTR_H_INCLUDED
+
+/*
+ * recursive quadrature oscillator (sine/cosine LFO)
+ *
+ * the phase is the point (c, s) on the unit circle, rotated by the phase
+ * step every sample, so there is no cos() per sample and the phase never
+ * grows without bound. Each step also pulls the radius back towards 1 so
+ * rounding errors don't build up.
+ */
+
+struct oscltr {
+    double c;       /* cos of the current phase */
+    double s;       /* sin of the current phase */
+    double dc;      /* cos of the phase step */
+    double ds;      /* sin of the phase step */
+};
+
+/* initialize oscillator: f Hz at fs samples/s, starting at phase radians */
+void oscltr_init(struct oscltr *o, double f, double fs, double phase);
+
+/* change the frequency, keeping the current phase */
+void oscltr_freq(struct oscltr *o, double f, double fs);
+
+/* return cos of the current phase and advance by one sample */
+double oscltr_next(struct oscltr *o);
+
+#endif
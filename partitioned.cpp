@@ -0,0 +1,102 @@
+#include "partitioned.h"
+#include <algorithm>
+
+namespace dsp {
+
+// smallest power of two >= n
+static std::size_t PowerOfTwo(std::size_t n)
+{
+    std::size_t p = 1;
+
+    while (p < n)
+        p *= 2;
+    return p;
+}
+
+PartitionedConvolver::PartitionedConvolver(const std::vector<double> &h,
+                                           std::size_t block)
+: B{PowerOfTwo(std::max<std::size_t>(block, 1))},
+  P{std::max<std::size_t>((h.size() + B - 1) / B, 1)}, K{B + 1},
+  fft(2 * B), H(P * K), fdl(P * K), head{}, tail(K), X(K), Y(K),
+  x(2 * B), y(2 * B), fill{}
+{
+    for (std::size_t p = 0; p < P; p++) {
+        const std::size_t first = p * B;
+        const std::size_t last = std::min(first + B, h.size());
+
+        std::fill(y.begin(), y.end(), 0.0);
+        if (first < last)
+            std::copy(h.begin() + first, h.begin() + last, y.begin());
+        fft.Forward(y.data(), &H[p * K]);
+    }
+    std::fill(y.begin(), y.end(), 0.0);
+}
+
+/*
+ * PartitionedConvolver::Advance() - finish the current block
+ * X holds the spectrum of the completed block: store it in the FDL,
+ * form the sum over the older blocks for the next one and move the
+ * newer half of x down to make room for it.
+ */
+void PartitionedConvolver::Advance()
+{
+    std::copy(X.begin(), X.end(), fdl.begin() + head * K);
+
+    // X[k+1-p]·Hp for p = 1 .. P-1, X[k+1-p] is in slot head+1-p
+    std::fill(tail.begin(), tail.end(), complex());
+    for (std::size_t p = 1; p < P; p++) {
+        const complex *Xp = &fdl[((head + P + 1 - p) % P) * K];
+        const complex *Hp = &H[p * K];
+
+        for (std::size_t k = 0; k < K; k++)
+            tail[k] += Xp[k] * Hp[k];
+    }
+    head = (head + 1) % P;
+
+    std::copy(x.begin() + B, x.end(), x.begin());
+    fill = 0;
+}
+
+/* filter one sample
+ * x: input sample to process
+ *
+ * Return: output sample
+ */
+double PartitionedConvolver::ProcessSample(double x0)
+{
+    double y0;
+
+    PartitionedConvolver::ProcessBlock(&x0, &y0, 1);
+    return y0;
+}
+
+/* filter a block of samples
+ * in: n input samples to process
+ * out: n output samples (may be the same buffer as in)
+ */
+void PartitionedConvolver::ProcessBlock(const double *in, double *out,
+                                        std::size_t n)
+{
+    std::size_t i = 0;
+
+    while (i < n) {
+        const std::size_t r = std::min(B - fill, n - i);
+        double *xn = x.data() + B + fill;
+
+        std::copy(in + i, in + i + r, xn);
+        std::fill(xn + r, x.data() + 2 * B, 0.0);
+
+        fft.Forward(x.data(), X.data());
+        for (std::size_t k = 0; k < K; k++)
+            Y[k] = tail[k] + X[k] * H[k];
+        fft.Inverse(Y.data(), y.data());
+        std::copy(y.begin() + B + fill, y.begin() + B + fill + r, out + i);
+
+        fill += r;
+        i += r;
+        if (fill == B)
+            Advance();
+    }
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef DSP_PARTITIONED_H_INCLUDED
+#define DSP_PARTITIONED_H_INCLUDED
+
+#include "filter.hpp"
+#include "fft.h"
+#include <complex>
+#include <vector>
+
+namespace dsp {
+
+/*
+ * uniformly partitioned convolution (overlap-save with a frequency
+ * domain delay line)
+ *
+ * the impulse response is cut into P partitions of B samples, and each
+ * is transformed once with an FFT of size 2B:
+ *
+ *   h = | h0 | h1 | ... | hP-1 |        Hp = FFT(hp, zero padded to 2B)
+ *
+ * the spectrum of every input block (with the block before it) goes
+ * into the frequency domain delay line (FDL), so block k's output is
+ *
+ *   y[k] = last B samples of IFFT(X[k]·H0 + X[k-1]·H1 + ... + X[k-P+1]·HP-1)
+ *
+ * which costs one FFT, one inverse FFT and P spectrum multiplies per B
+ * samples, while latency depends only on B instead of the IR length.
+ * The sum over p >= 1 only needs past blocks, so it is formed once as
+ * soon as a block completes. A call that only covers part of a block
+ * transforms what has arrived so far, so there is no added latency for
+ * any block size, but it is cheapest to pass BlockSize() samples at a
+ * time (wave_options.block).
+ */
+class PartitionedConvolver: public Filter {
+    typedef std::complex<double> complex;
+
+    std::size_t B;              // block (partition) size
+    std::size_t P;              // number of partitions
+    std::size_t K;              // bins per spectrum (B + 1)
+    FFT fft;                    // plan for 2B point transforms
+    std::vector<complex> H;     // partition spectra [p][K]
+    std::vector<complex> fdl;   // input spectra [slot][K], a ring of P
+    std::size_t head;           // slot for the current block
+    std::vector<complex> tail;  // sum of X[k-p]·Hp for p >= 1
+    std::vector<complex> X;     // spectrum of the current block
+    std::vector<complex> Y;     // spectrum of the output
+    std::vector<double> x;      // previous and current input block (2B)
+    std::vector<double> y;      // inverse FFT (2B)
+    std::size_t fill;           // samples so far in the current block
+
+    void Advance();
+public:
+    // h: impulse response
+    // block: partition size, rounded up to a power of two
+    PartitionedConvolver(const std::vector<double> &h,
+                         std::size_t block = 256);
+
+    std::size_t BlockSize() const { return B; }
+    std::size_t Partitions() const { return P; }
+
+    // (transforms a whole block for every sample, use ProcessBlock)
+    double ProcessSample(double x);
+    void ProcessBlock(const double *x, double *y, std::size_t n);
+    PartitionedConvolver *Clone() const {
+        return new PartitionedConvolver(*this);
+    }
+    std::size_t ImpulseLength() const { return P * B; }
+};
+
+}
+
+#endif
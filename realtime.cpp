@@ -0,0 +1,179 @@
+#include "realtime.h"
+extern "C" {
+#include "convert.h"
+#include "wave.h"
+}
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace dsp {
+
+RealTime::RealTime(AudioCallback &cb, int channels, std::size_t block,
+                   std::size_t queue)
+: cb(cb), C{channels}, B{block},
+  in(queue * block * channels), out(queue * block * channels),
+  x(block * channels), y(block * channels), stop{false}, blocks{0},
+  running{false}
+{
+}
+
+/*
+ * RealTime::Run() - the audio thread
+ * takes a block whenever a whole one is queued and its output fits,
+ * polling (and yielding the processor) in between
+ */
+void RealTime::Run(void *arg)
+{
+    RealTime *rt = static_cast<RealTime *>(arg);
+    const std::size_t n = rt->B * rt->C;
+
+    convert_denormals_flush();
+    for (;;) {
+        if (rt->in.ReadAvailable() >= n && rt->out.WriteAvailable() >= n) {
+            rt->in.Read(rt->x.data(), n);
+            rt->cb.Process(rt->x.data(), rt->y.data(), rt->B);
+            rt->out.Write(rt->y.data(), n);
+            rt->blocks.store(rt->blocks.load(std::memory_order_relaxed) + 1,
+                             std::memory_order_relaxed);
+        } else if (rt->stop.load(std::memory_order_acquire)) {
+            break;
+        } else {
+            thread_yield();
+        }
+    }
+}
+
+bool RealTime::Start()
+{
+    if (running)
+        return true;
+    stop = false;
+    running = thread_create(&t, Run, this) == 0;
+    return running;
+}
+
+void RealTime::Stop()
+{
+    if (!running)
+        return;
+    stop.store(true, std::memory_order_release);
+    thread_join(&t);
+    running = false;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+ * WavDevice::Run() - run a wav file through a real-time host
+ * host: host to feed (it is started and stopped here)
+ * infile: file to play into the host's input
+ * outfile: file to record the host's output to
+ * format: WAVE_PCM or WAVE_FLOAT
+ * paced: keep to the sample rate of infile
+ *
+ * the calling thread is the I/O thread. The last block is padded with
+ * silence. Paced, block i is captured at the end of its period and its
+ * output is due two periods later; if it isn't ready then, the period
+ * is played as silence (an underrun) and the block played when it comes.
+ *
+ * Return: 0 on success
+ *         1 could not read or write a file
+ *         4 unsupported file format or channel count
+ *         8 out of memory or no audio thread
+ */
+int WavDevice::Run(RealTime &host, const char *infile, const char *outfile,
+                   int format, bool paced)
+{
+    struct wave fmt;
+    std::size_t frames;
+    double *samples = wave_load(infile, &fmt, &frames);
+    if (!samples)
+        return 1;
+    if (fmt.channels != host.Channels()
+        || (format != WAVE_PCM && format != WAVE_FLOAT)) {
+        fprintf(stderr, "%s: can't play %d channels to a %d channel host\n",
+                infile, fmt.channels, host.Channels());
+        free(samples);
+        return 4;
+    }
+
+    const std::size_t C = fmt.channels, B = host.BlockSize(), n = B * C;
+    const std::size_t total = (frames + B - 1) / B;     // blocks
+    std::vector<double> x(total * n), y(total * n);
+    std::copy(samples, samples + frames * C, x.begin());
+    free(samples);
+
+    underruns = overruns = 0;
+    if (!host.Start())
+        return 8;
+
+    const double period = double(B) / fmt.samplerate;
+    const Clock::time_point start = Clock::now();
+    std::size_t captured = 0, played = 0, received = 0;
+    while (played < total) {
+        const double now =
+            std::chrono::duration<double>(Clock::now() - start).count();
+        bool busy = false;
+
+        // capture: the next block, once its period is over
+        if (captured < total && (!paced || now >= (captured + 1) * period)) {
+            if (host.Input().WriteAvailable() >= n) {
+                host.Input().Write(&x[captured * n], n);
+                busy = true;
+            } else if (paced) {
+                overruns++;
+            }
+            if (busy || paced)
+                captured++;
+        }
+
+        // playback: the next block, or silence if it's late
+        if (host.Output().ReadAvailable() >= n && received < total) {
+            host.Output().Read(&y[received * n], n);
+            received++;
+            busy = true;
+        }
+        if (!paced) {
+            played = received;
+        } else if (now >= (played + 3) * period) {
+            if (received <= played) {
+                underruns++;
+                received++;     // (that slot stays silent)
+            }
+            played++;
+        }
+        if (!busy)
+            thread_yield();
+    }
+    host.Stop();
+    seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // write outfile in the format wave_filter() would
+    FILE *fp = fopen(outfile, "wb");
+    if (!fp) {
+        perror(outfile);
+        return 1;
+    }
+    struct wave out = fmt;
+    out.format = format;
+    out.fmt_size = 16;
+    out.bitspersample = format == WAVE_FLOAT ? 32 : 16;
+    out.blockalign = out.channels * out.bitspersample / 8;
+    out.byterate = out.blockalign * out.samplerate;
+    out.data_size = frames * out.blockalign;
+    out.riff_size = out.data_size + 16 + 8 + 8 + 4;
+    std::vector<unsigned char> raw(out.data_size + 1);
+    if (format == WAVE_FLOAT)
+        convert_double_to_float(y.data(), (float *)raw.data(), frames * C);
+    else
+        convert_double_to_pcm16(y.data(), (int16_t *)raw.data(), frames * C);
+    wave_write_header(&out, fp);
+    bool ok = fwrite(raw.data(), 1, out.data_size, fp) == out.data_size;
+    ok = fclose(fp) == 0 && ok;
+    return ok ? 0 : 1;
+}
+
+} // namespace dsp
@@ -0,0 +1,162 @@
+#ifndef DSP_REALTIME_H_INCLUDED
+#define DSP_REALTIME_H_INCLUDED
+
+#include "ringbuffer.hpp"
+extern "C" {
+#include "thread.h"
+}
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/*
+ * real-time host for the dsp filters
+ *
+ *        capture            Input()             Output()          playback
+ *  device -----→ [RingBuffer] -----→ audio thread -----→ [RingBuffer] -----→
+ *  (I/O thread)                   AudioCallback::Process()      (I/O thread)
+ *
+ * the device's I/O thread writes captured frames into one ring buffer
+ * and reads processed frames out of the other. The audio thread started
+ * by RealTime takes one fixed size block at a time through the callback
+ * as soon as a block is queued and there is room for its output. Nothing
+ * on the audio thread allocates or locks: the block buffers are made by
+ * the constructor and the queues are wait-free. Parameter changes reach
+ * the audio thread through a Mailbox (see FilterCallback).
+ *
+ * WavDevice is a virtual device that plays a wav file into the host and
+ * records what comes out, either as fast as possible or paced at the
+ * sample rate like a sound card, counting the blocks that were late.
+ */
+
+namespace dsp {
+
+// block callback run on the audio thread
+class AudioCallback {
+public:
+    virtual ~AudioCallback() {}
+
+    // process one block of n frames of interleaved samples
+    // must not allocate, lock or wait
+    virtual void Process(const double *in, double *out, std::size_t n) = 0;
+};
+
+/*
+ * FilterCallback<F, P> - a filter per channel as an AudioCallback
+ *
+ *  struct Coefficients { std::array<double,3> b, a; };
+ *  dsp::FilterCallback<dsp::BiQuad, Coefficients> cb{biquad, 2, 256,
+ *      [](dsp::BiQuad &f, const Coefficients &c) { f.b = c.b; f.a = c.a; }};
+ *  ...
+ *  cb.Update(Coefficients{b, a});     // from a control thread
+ *
+ * every channel gets a copy of f. Update() hands the parameters to the
+ * audio thread through a Mailbox, and they are applied to every channel
+ * with apply() at the start of the next block, so a change never lands
+ * in the middle of a block or between channels. The dsp filters keep
+ * their scratch buffers between blocks, so only the first block with
+ * a new size can allocate.
+ */
+template <typename F, typename P>
+class FilterCallback: public AudioCallback {
+    std::vector<F> filters;         // one per channel
+    std::vector<double> planar;     // a block of one channel
+    Mailbox<P> params;
+    void (*apply)(F &f, const P &p);
+public:
+    FilterCallback(const F &f, int channels, std::size_t block,
+                   void (*apply)(F &f, const P &p))
+    : filters(channels, f), planar(block), apply{apply} {}
+
+    // change the parameters of every channel (from one control thread)
+    void Update(const P &p) { params.Write(p); }
+
+    // the filter of channel c (not while the audio thread is running)
+    F &Channel(int c) { return filters[c]; }
+
+    void Process(const double *in, double *out, std::size_t n) {
+        const std::size_t C = filters.size();
+
+        if (const P *p = params.Read())
+            for (F &f : filters)
+                apply(f, *p);
+        for (std::size_t c = 0; c < C; c++) {
+            for (std::size_t i = 0; i < n; i++)
+                planar[i] = in[i * C + c];
+            filters[c].F::ProcessBlock(planar.data(), planar.data(), n);
+            for (std::size_t i = 0; i < n; i++)
+                out[i * C + c] = planar[i];
+        }
+    }
+};
+
+/*
+ * RealTime - runs an AudioCallback on its own thread between two queues
+ */
+class RealTime {
+    AudioCallback &cb;
+    int C;                          // channels
+    std::size_t B;                  // frames per block
+    RingBuffer<double> in, out;     // interleaved samples
+    std::vector<double> x, y;       // the block being processed
+    std::atomic<bool> stop;
+    std::atomic<std::size_t> blocks;
+    struct thread t;
+    bool running;
+
+    static void Run(void *arg);
+public:
+    // cb: processes each block on the audio thread
+    // channels: interleaved channels per frame
+    // block: frames per callback
+    // queue: blocks each ring buffer holds
+    RealTime(AudioCallback &cb, int channels, std::size_t block,
+             std::size_t queue = 4);
+    ~RealTime() { Stop(); }
+
+    int Channels() const { return C; }
+    std::size_t BlockSize() const { return B; }
+
+    // captured samples go in here (written by the device's I/O thread)
+    RingBuffer<double> &Input() { return in; }
+    // processed samples come out here (read by the device's I/O thread)
+    RingBuffer<double> &Output() { return out; }
+
+    // start the audio thread
+    // Return: false if the thread could not be started
+    bool Start();
+    // stop the audio thread once it can't take another whole block
+    void Stop();
+    // blocks processed so far
+    std::size_t Blocks() const { return blocks.load(); }
+};
+
+/*
+ * WavDevice - a wav file as the sound card of a RealTime host
+ */
+class WavDevice {
+    std::size_t underruns;
+    std::size_t overruns;
+    double seconds;
+public:
+    WavDevice() : underruns{}, overruns{}, seconds{} {}
+
+    // play infile through host and record the output to outfile
+    // (format WAVE_PCM or WAVE_FLOAT, the same length as infile)
+    // paced: feed a block every block period and expect its output two
+    //        periods later like a sound card, otherwise as fast as possible
+    // Return: 0 on success, like wave_filter()
+    int Run(RealTime &host, const char *infile, const char *outfile,
+            int format, bool paced);
+
+    // output blocks that were not ready in time (played as silence)
+    std::size_t Underruns() const { return underruns; }
+    // input blocks dropped because the input queue was full
+    std::size_t Overruns() const { return overruns; }
+    // wall time of the last Run()
+    double Seconds() const { return seconds; }
+};
+
+} // namespace dsp
+
+#endif
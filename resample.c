@@ -0,0 +1,218 @@
+#include "resample.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Kaiser window shape: about 80 dB of stop band attenuation */
+#define RESAMPLE_BETA 8.0
+
+/* cut off of h as a fraction of the lower rate (the Nyquist frequency
+   is 0.5, the transition band is centred just below it) */
+#define RESAMPLE_CUTOFF 0.45
+
+#define RESAMPLE_PI 3.14159265358979323846
+
+static unsigned long gcd(unsigned long a, unsigned long b)
+{
+    unsigned long t;
+
+    while (b) {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* modified Bessel function of the first kind, order 0 (for the window) */
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    int k;
+
+    for (k = 1; k < 100 && term > sum * 1e-17; k++) {
+        term *= (x * x / 4.0) / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+/*
+ * resample_create() - allocate a sample rate converter
+ * channels: channels per frame
+ * in_rate: sample rate of the input
+ * out_rate: sample rate of the output
+ *
+ * h is designed at L times the input rate, RESAMPLE_ZEROS zero crossings
+ * of the lower rate either side of its centre, so each phase has
+ * K = 2 * RESAMPLE_ZEROS * max(L, M) / L taps. It is scaled so every
+ * phase passes DC at unity gain on average.
+ *
+ * Return: the converter, NULL if the rates are 0, the ratio is too
+ *         awkward or out of memory
+ */
+struct resampler *
+resample_create(int channels, unsigned long in_rate, unsigned long out_rate)
+{
+    struct resampler *r;
+    unsigned long g;
+    double *proto, fc, c, t, sum;
+    int L, M, K, N, n, p, k;
+
+    if (channels < 1 || in_rate == 0 || out_rate == 0)
+        return NULL;
+    g = gcd(in_rate, out_rate);
+    if (out_rate / g > RESAMPLE_MAX_RATIO || in_rate / g > RESAMPLE_MAX_RATIO)
+        return NULL;
+    L = out_rate / g;
+    M = in_rate / g;
+    K = 2 * RESAMPLE_ZEROS * (L > M ? L : M) / L;
+    N = L * K;
+
+    r = malloc(sizeof(*r));
+    proto = malloc(N * sizeof(double));
+    if (!r || !proto) {
+        free(proto);
+        free(r);
+        return NULL;
+    }
+    r->channels = channels;
+    r->L = L;
+    r->M = M;
+    r->K = K;
+    r->h = malloc(N * sizeof(double));
+    r->cap = 2 * K + 1024;
+    r->buf = calloc(r->cap * channels, sizeof(double));
+    if (!r->h || !r->buf) {
+        free(proto);
+        resample_destroy(r);
+        return NULL;
+    }
+
+    /* windowed sinc, cut off in cycles per sample at L times in_rate */
+    fc = RESAMPLE_CUTOFF / (L > M ? L : M);
+    c = N / 2;          /* (a whole tap, so the delay is exact) */
+    sum = 0.0;
+    for (n = 0; n < N; n++) {
+        t = n - c;
+        proto[n] = t == 0.0 ? 2.0 * fc
+                            : sin(2.0 * RESAMPLE_PI * fc * t) / (RESAMPLE_PI * t);
+        proto[n] *= bessel_i0(RESAMPLE_BETA * sqrt(1.0 - (t / c) * (t / c)))
+                    / bessel_i0(RESAMPLE_BETA);
+        sum += proto[n];
+    }
+    for (p = 0; p < L; p++)
+        for (k = 0; k < K; k++)
+            r->h[p * K + k] = proto[p + k * L] * L / sum;
+    free(proto);
+
+    /* K - 1 frames of silence before the input, and the first output
+       aligned with the centre of h */
+    r->frames = K - 1;
+    r->next = K - 1 + N / 2 / L;
+    r->phase = N / 2 % L;
+    return r;
+}
+
+/*
+ * resample_destroy() - free a sample rate converter
+ * r: the converter
+ */
+void resample_destroy(struct resampler *r)
+{
+    free(r->buf);
+    free(r->h);
+    free(r);
+}
+
+/*
+ * resample_length() - length of the output
+ * r: the converter
+ * n: frames of input
+ *
+ * Return: frames of output that cover n frames of input
+ */
+size_t resample_length(const struct resampler *r, size_t n)
+{
+    return (size_t)ceil((double)n * r->L / r->M);
+}
+
+/*
+ * resample_write() - queue input
+ * r: the converter
+ * x: n interleaved frames, or NULL for n frames of silence
+ * n: frames
+ *
+ * input past the end of a file should be silence, to compute the last
+ * outputs (K frames are enough)
+ *
+ * Return: 0, or -1 if out of memory
+ */
+int resample_write(struct resampler *r, const double *x, size_t n)
+{
+    const int C = r->channels;
+    double *buf;
+    size_t cap;
+
+    if (r->frames + n > r->cap) {
+        cap = 2 * r->cap > r->frames + n ? 2 * r->cap : r->frames + n;
+        buf = realloc(r->buf, cap * C * sizeof(double));
+        if (!buf)
+            return -1;
+        r->buf = buf;
+        r->cap = cap;
+    }
+    if (x)
+        memcpy(r->buf + r->frames * C, x, n * C * sizeof(double));
+    else
+        memset(r->buf + r->frames * C, 0, n * C * sizeof(double));
+    r->frames += n;
+    return 0;
+}
+
+/*
+ * resample_read() - compute output
+ * r: the converter
+ * y: room for n interleaved frames
+ * n: most frames to compute
+ *
+ * an output is computed once its newest input has been queued: output j
+ * is phase p of h run over the K inputs up to i, where jM = iL + p (less
+ * the delay of h), and the next one is M phases on. The input no output
+ * can need any more is dropped afterwards.
+ *
+ * Return: frames computed (fewer than n when more input is needed)
+ */
+size_t resample_read(struct resampler *r, double *y, size_t n)
+{
+    const int C = r->channels, K = r->K;
+    const double *h, *x;
+    double acc;
+    size_t j, drop;
+    int c, k;
+
+    for (j = 0; j < n && r->next < r->frames; j++) {
+        h = r->h + r->phase * K;
+        x = r->buf + r->next * C;
+        for (c = 0; c < C; c++) {
+            acc = 0.0;
+            for (k = 0; k < K; k++)
+                acc += h[k] * x[c - k * C];
+            y[j * C + c] = acc;
+        }
+        r->phase += r->M;
+        r->next += r->phase / r->L;
+        r->phase %= r->L;
+    }
+
+    drop = r->next - (K - 1);
+    if (drop > r->frames)
+        drop = r->frames;
+    if (drop > 0) {
+        memmove(r->buf, r->buf + drop * C,
+                (r->frames - drop) * C * sizeof(double));
+        r->frames -= drop;
+        r->next -= drop;
+    }
+    return j;
+}
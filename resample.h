@@ -0,0 +1,65 @@
+#ifndef DSP_RESAMPLE_H_INCLUDED
+#define DSP_RESAMPLE_H_INCLUDED
+
+/*
+ * rational polyphase sample rate converter
+ *
+ * converting from fs_in to fs_out is upsampling by L, low pass filtering
+ * and downsampling by M, where L/M is fs_out/fs_in in lowest terms:
+ *
+ *  x[i] --→ (↑L) --→ [h] --→ (↓M) --→ y[j]
+ *
+ * only every M'th output of the filter is kept and all but every L'th
+ * input to it is zero, so each output is computed directly from one of
+ * the L phases of h (taps p, p + L, p + 2L, ...) and K input samples:
+ * nothing is computed for the zeros or for the outputs thrown away.
+ * h is a Kaiser windowed sinc (about 80 dB stop band) with its cut off
+ * just below the Nyquist frequency of the lower of the two rates, and
+ * the output is aligned with the input (the delay of h is compensated).
+ *
+ * samples are interleaved frames of any number of channels, pushed in
+ * with resample_write() and pulled out with resample_read().
+ */
+
+#include <stddef.h>
+
+/* zero crossings of the sinc on each side of its centre, at the lower
+   rate (sets K, the taps per output, and the width of the transition) */
+#define RESAMPLE_ZEROS 32
+
+/* largest L or M: the filter has L * K taps */
+#define RESAMPLE_MAX_RATIO 4096
+
+struct resampler {
+    int channels;
+    int L;              /* upsampling factor */
+    int M;              /* downsampling factor */
+    int K;              /* taps per phase */
+    double *h;          /* L phases of K taps, h[p * K + k] */
+    double *buf;        /* interleaved input, K - 1 frames of history first */
+    size_t frames;      /* frames in buf */
+    size_t cap;         /* frames buf can hold */
+    size_t next;        /* frame in buf of the newest input of the next
+                           output */
+    int phase;          /* phase of h for the next output */
+};
+
+/* allocate a converter from in_rate to out_rate, NULL if the ratio
+   between them is too awkward (L or M over RESAMPLE_MAX_RATIO) */
+struct resampler *
+resample_create(int channels, unsigned long in_rate, unsigned long out_rate);
+
+/* free a converter */
+void resample_destroy(struct resampler *r);
+
+/* frames out for n frames in */
+size_t resample_length(const struct resampler *r, size_t n);
+
+/* queue n frames of input (x NULL for silence), -1 if out of memory */
+int resample_write(struct resampler *r, const double *x, size_t n);
+
+/* compute up to n frames of output into y from the queued input
+   Return: frames computed */
+size_t resample_read(struct resampler *r, double *y, size_t n);
+
+#endif
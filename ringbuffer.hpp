@@ -0,0 +1,129 @@
+#ifndef DSP_RINGBUFFER_HPP_INCLUDED
+#define DSP_RINGBUFFER_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace dsp {
+
+/*
+ * RingBuffer<T> - wait-free single producer, single consumer queue
+ *
+ *  producer thread:  n = ring.Write(x, n);    consumer thread:
+ *                                              n = ring.Read(y, n);
+ *
+ * head counts the items ever written and tail the items ever read, so
+ * head - tail is the fill level even after they wrap around size_t.
+ * Only the producer stores head and only the consumer stores tail, and
+ * each publishes its side with a release store that the other side
+ * reads with an acquire load, so there are no locks and no retries: a
+ * call always finishes in a bounded number of steps. The capacity is
+ * rounded up to a power of two so wrapping the index is a mask. Nothing
+ * is allocated after construction.
+ */
+template <typename T>
+class RingBuffer {
+    std::vector<T> buf;
+    std::size_t mask;                       // buf.size() - 1
+    char pad0[64];                          // (head and tail on their own
+    std::atomic<std::size_t> head;          //  cache lines, so the two
+    char pad1[64];                          //  threads don't share one)
+    std::atomic<std::size_t> tail;
+    char pad2[64];
+
+    static std::size_t PowerOfTwo(std::size_t n) {
+        std::size_t m = 1;
+        while (m < n)
+            m <<= 1;
+        return m;
+    }
+public:
+    // capacity: most items queued at once (rounded up to a power of two)
+    explicit RingBuffer(std::size_t capacity)
+    : buf(PowerOfTwo(capacity)), mask{buf.size() - 1}, head{0}, tail{0} {}
+
+    std::size_t Capacity() const { return buf.size(); }
+
+    // items that can be read now (consumer)
+    std::size_t ReadAvailable() const {
+        return head.load(std::memory_order_acquire)
+               - tail.load(std::memory_order_relaxed);
+    }
+
+    // items that can be written now (producer)
+    std::size_t WriteAvailable() const {
+        return buf.size() - (head.load(std::memory_order_relaxed)
+                             - tail.load(std::memory_order_acquire));
+    }
+
+    // queue up to n items from x (producer)
+    // Return: number of items written
+    std::size_t Write(const T *x, std::size_t n) {
+        const std::size_t h = head.load(std::memory_order_relaxed);
+        const std::size_t free = WriteAvailable();
+        if (n > free)
+            n = free;
+        for (std::size_t i = 0; i < n; i++)
+            buf[(h + i) & mask] = x[i];
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // take up to n items into y (consumer)
+    // Return: number of items read
+    std::size_t Read(T *y, std::size_t n) {
+        const std::size_t t = tail.load(std::memory_order_relaxed);
+        const std::size_t used = ReadAvailable();
+        if (n > used)
+            n = used;
+        for (std::size_t i = 0; i < n; i++)
+            y[i] = buf[(t + i) & mask];
+        tail.store(t + n, std::memory_order_release);
+        return n;
+    }
+};
+
+/*
+ * Mailbox<T> - wait-free hand over of the latest value between threads
+ *
+ *  control thread:  box.Write(coefficients);
+ *  audio thread:    if (const P *p = box.Read()) apply(*p);
+ *
+ * a triple buffer: the writer fills its own slot and swaps it with the
+ * shared one, the reader swaps its slot with the shared one when that
+ * holds something new. Neither waits for the other and a value is never
+ * torn; values written between two reads are replaced by the newest.
+ * T is copied into a slot by assignment, so it should not allocate
+ * (e.g. std::array rather than std::vector) to keep Write() cheap.
+ */
+template <typename T>
+class Mailbox {
+    T slot[3];
+    std::atomic<int> shared;    // slot in the middle, | FRESH when unread
+    int back;                   // writer's slot
+    int front;                  // reader's slot
+
+    static const int FRESH = 4;
+public:
+    Mailbox() : shared{1}, back{0}, front{2} {}
+
+    // publish v (one writer thread)
+    void Write(const T &v) {
+        slot[back] = v;
+        back = shared.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    // newest value written since the last call, or nullptr (one reader
+    // thread, the value stays valid until the next call)
+    const T *Read() {
+        if (!(shared.load(std::memory_order_relaxed) & FRESH))
+            return nullptr;
+        front = shared.exchange(front, std::memory_order_acq_rel) & 3;
+        return &slot[front];
+    }
+};
+
+} // namespace dsp
+
+#endif
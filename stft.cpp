@@ -0,0 +1,184 @@
+#include "stft.h"
+#include <algorithm>
+#include <cmath>
+
+namespace dsp {
+
+// smallest power of two >= n
+static std::size_t PowerOfTwo(std::size_t n)
+{
+    std::size_t p = 1;
+
+    while (p < n)
+        p *= 2;
+    return p;
+}
+
+// the window over N samples (periodic, so the sums over hops are flat)
+static double WindowAt(STFT::Window window, std::size_t n, std::size_t N)
+{
+    const double c = std::cos(2.0 * pi * n / N);
+
+    switch (window) {
+    case STFT::Hann:
+        return 0.5 - 0.5 * c;
+    case STFT::Hamming:
+        return 0.54 - 0.46 * c;
+    case STFT::Blackman:
+        return 0.42 - 0.5 * c + 0.08 * std::cos(4.0 * pi * n / N);
+    default:
+        return 1.0;
+    }
+}
+
+// the longest hop each window is meant for
+static std::size_t LongestHop(STFT::Window window, std::size_t N)
+{
+    switch (window) {
+    case STFT::Hann:
+    case STFT::Hamming:
+        return N / 2;
+    case STFT::Blackman:
+        return std::max<std::size_t>(N / 3, 1);
+    default:
+        return N;
+    }
+}
+
+/*
+ * the analysis window is w·2/Σw, 2/Σw bringing a sine's bin back to its
+ * amplitude. Sample n of a hop is in frames at n, n + H, n + 2H, ... and
+ * the product of the windows summed over those positions has to be one,
+ * so with s[n] = Σ w²[n + jH] the synthesis window is w/s·Σw/2.
+ */
+STFT::STFT(std::size_t size, std::size_t hop, Window window)
+: N{PowerOfTwo(std::max<std::size_t>(size, 2))},
+  H{hop == 0 ? std::max<std::size_t>(N / 4, 1) : std::min(hop, N)},
+  K{N / 2 + 1}, fft(N), wa(N), ws(N), in(N), X(K), frame(N), ola(N),
+  fill{}, longest{LongestHop(window, N)}, exact{H <= longest}
+{
+    std::vector<double> s(H);
+    double sum = 0.0, top;
+
+    for (std::size_t n = 0; n < N; n++) {
+        wa[n] = WindowAt(window, n, N);
+        s[n % H] += wa[n] * wa[n];
+        sum += wa[n];
+    }
+    // (a sample only on the window's zeros, with too long a hop, is lost
+    // rather than blown up by rounding)
+    top = *std::max_element(s.begin(), s.end());
+    for (std::size_t n = 0; n < H; n++)
+        if (!(s[n] > 1e-9 * top))
+            exact = false;
+    for (std::size_t n = 0; n < N; n++) {
+        ws[n] = s[n % H] > 1e-9 * top ? wa[n] / s[n % H] * sum / 2.0 : 0.0;
+        wa[n] *= 2.0 / sum;
+    }
+}
+
+/* take samples into the current hop, transforming the frame it ends
+ * x: n input samples
+ *
+ * Return: samples taken, fewer than n if a frame was completed
+ */
+std::size_t STFT::Write(const double *x, std::size_t n)
+{
+    if (n == 0)
+        return 0;
+    if (fill == H) {
+        std::copy(in.begin() + H, in.end(), in.begin());
+        fill = 0;
+    }
+    const std::size_t r = std::min(n, H - fill);
+
+    std::copy(x, x + r, in.begin() + (N - H + fill));
+    fill += r;
+    if (fill == H) {
+        for (std::size_t i = 0; i < N; i++)
+            frame[i] = in[i] * wa[i];
+        fft.Forward(frame.data(), X.data());
+    }
+    return r;
+}
+
+/* overlap-add one more frame
+ * Y: its K bins
+ */
+void STFT::Add(const complex *Y)
+{
+    std::copy(ola.begin() + H, ola.end(), ola.begin());
+    std::fill(ola.end() - H, ola.end(), 0.0);
+    fft.Inverse(Y, frame.data());
+    for (std::size_t i = 0; i < N; i++)
+        ola[i] += frame[i] * ws[i];
+}
+
+SpectralFilter::SpectralFilter(SpectralProcess *process, std::size_t size,
+                               std::size_t hop, STFT::Window window)
+: stft(size, hop, window), process{process}, pos{}
+{
+}
+
+SpectralFilter::SpectralFilter(const SpectralFilter &f)
+: stft(f.stft), process{f.process ? f.process->Clone() : nullptr},
+  pos{f.pos}
+{
+}
+
+/* filter one sample
+ * x: input sample to process
+ *
+ * Return: output sample
+ */
+double SpectralFilter::ProcessSample(double x0)
+{
+    double y0;
+
+    SpectralFilter::ProcessBlock(&x0, &y0, 1);
+    return y0;
+}
+
+/* filter a block of samples
+ * x: n input samples to process
+ * y: n output samples (may be the same buffer as x)
+ *
+ * the outputs of the current hop were finished by the last frame, so
+ * each stretch of input is taken before the outputs are written over it
+ */
+void SpectralFilter::ProcessBlock(const double *x, double *y, std::size_t n)
+{
+    std::size_t i = 0;
+
+    while (i < n) {
+        const std::size_t r = stft.Write(x + i, n - i);
+        const double *out = stft.Output() + pos;
+
+        std::copy(out, out + r, y + i);
+        i += r;
+        pos += r;
+        if (stft.Ready()) {
+            if (process)
+                process->ProcessSpectrum(stft.Spectrum(), stft.Bins());
+            stft.Add(stft.Spectrum());
+            pos = 0;
+        }
+    }
+}
+
+/* turn down the quiet bins of a frame
+ * X: K bins, changed in place
+ */
+void SpectralGate::ProcessSpectrum(complex *X, std::size_t K)
+{
+    if (gain.size() != K)
+        gain.assign(K, 1.0);
+    for (std::size_t k = 0; k < K; k++) {
+        const double target = std::abs(X[k]) >= threshold ? 1.0 : floor;
+
+        gain[k] = std::max(target, gain[k] * release);
+        X[k] *= gain[k];
+    }
+}
+
+}
@@ -0,0 +1,164 @@
+#ifndef DSP_STFT_H_INCLUDED
+#define DSP_STFT_H_INCLUDED
+
+#include "filter.hpp"
+#include "fft.h"
+#include <complex>
+#include <memory>
+#include <vector>
+
+namespace dsp {
+
+/*
+ * streaming short-time Fourier transform, and its inverse
+ *
+ * every H samples (the hop) the last N (the frame, a power of two) are
+ * multiplied by the analysis window and transformed:
+ *
+ *   x: ... | hop | hop | hop | hop | ...
+ *            |<------ N ------>|  -> ·w -> FFT -> X (N/2 + 1 bins)
+ *                  |<------ N ------>|  -> ...
+ *
+ * and the inverse transforms each spectrum back, multiplies it by the
+ * synthesis window and overlap-adds it, finishing H samples a frame.
+ * The windows are worked out once for the size and hop: the analysis
+ * window is scaled so a sine of amplitude A has a bin of magnitude A,
+ * and the synthesis window so that the two together sum to one over the
+ * overlapping frames (whatever the window and hop, as long as no sample
+ * falls only on zeros of the window), so an unchanged spectrum gives the
+ * input back exactly, N samples late.
+ *
+ * the FFT, windows and buffers are allocated with the transform: memory
+ * stays the same however long the stream is.
+ */
+class STFT {
+public:
+    typedef std::complex<double> complex;
+
+    enum Window {
+        Hann,           // 0.5 - 0.5 cos, for hops up to N/2
+        Hamming,        // 0.54 - 0.46 cos, lower first side lobe
+        Blackman,       // lower side lobes still, hops up to N/3
+        Rectangular     // no window, hops up to N
+    };
+
+    // size: N, frame length (0 or not a power of two rounds it up)
+    // hop: H, samples between frames (0 for N/4), at most N
+    STFT(std::size_t size, std::size_t hop = 0, Window window = Hann);
+
+    std::size_t Size() const { return N; }
+    std::size_t Hop() const { return H; }
+    std::size_t Bins() const { return K; }
+    // longest hop the window overlaps evenly at (its enum above)
+    std::size_t MaxHop() const { return longest; }
+    // the hop suits the window: at most MaxHop(), so every sample is in
+    // frames away from the window's zeros and an unchanged spectrum
+    // gives the input back
+    bool Exact() const { return exact; }
+
+    // analysis: take up to n samples, stopping after the one that
+    // completes a frame, whose spectrum is then in Spectrum() (and
+    // Ready() is true) until the next Write()
+    // Return: samples taken
+    std::size_t Write(const double *x, std::size_t n);
+    bool Ready() const { return fill == H; }
+    complex *Spectrum() { return X.data(); }
+    const complex *Spectrum() const { return X.data(); }
+
+    // synthesis: overlap-add the inverse of K bins (a spectrum of this
+    // or another STFT of the same size, hop and window), finishing the
+    // H samples Output() points to until the next Add()
+    void Add(const complex *Y);
+    const double *Output() const { return ola.data(); }
+
+private:
+    std::size_t N;              // frame length
+    std::size_t H;              // hop
+    std::size_t K;              // bins, N/2 + 1
+    FFT fft;
+    std::vector<double> wa;     // analysis window (N)
+    std::vector<double> ws;     // synthesis window (N)
+    std::vector<double> in;     // last N input samples, oldest first
+    std::vector<complex> X;     // spectrum of the last frame
+    std::vector<double> frame;  // windowed frame for the FFT (N)
+    std::vector<double> ola;    // overlap-add sum, finished samples first
+    std::size_t fill;           // samples of the current hop written
+    std::size_t longest;        // MaxHop()
+    bool exact;                 // H <= longest, no sample of a hop lost
+};
+
+/*
+ * spectral processing for SpectralFilter: change the bins of each frame
+ * in place (X[0] is DC, X[K - 1] the Nyquist frequency, magnitudes in
+ * the units of the samples)
+ */
+class SpectralProcess {
+public:
+    typedef std::complex<double> complex;
+
+    virtual ~SpectralProcess() {}
+    virtual void ProcessSpectrum(complex *X, std::size_t K) = 0;
+    // a copy with its own state, for another channel
+    virtual SpectralProcess *Clone() const = 0;
+};
+
+/*
+ * a filter that changes the STFT of its input and resynthesises it
+ *
+ *   x -> STFT -> process -> inverse STFT (overlap-add) -> y
+ *
+ * the output is N samples late (Latency()), which FilterWav takes back
+ * out of the file. Blocks of any length work, the frames are done as
+ * each hop fills, so wave_options.block = Hop() keeps the work even.
+ * With no process (nullptr) it is a delay of N samples.
+ */
+class SpectralFilter: public Filter {
+    STFT stft;
+    std::unique_ptr<SpectralProcess> process;
+    std::size_t pos;            // samples of the current hop done
+public:
+    // process: owned by the filter, nullptr for none
+    // size, hop, window: of the STFT
+    SpectralFilter(SpectralProcess *process, std::size_t size,
+                   std::size_t hop = 0, STFT::Window window = STFT::Hann);
+    // (the copy has a clone of the process)
+    SpectralFilter(const SpectralFilter &f);
+
+    std::size_t Size() const { return stft.Size(); }
+    std::size_t Hop() const { return stft.Hop(); }
+    std::size_t MaxHop() const { return stft.MaxHop(); }
+    bool Exact() const { return stft.Exact(); }
+
+    double ProcessSample(double x);
+    void ProcessBlock(const double *x, double *y, std::size_t n);
+    SpectralFilter *Clone() const { return new SpectralFilter(*this); }
+    std::size_t Latency() const { return stft.Size(); }
+};
+
+/*
+ * spectral gate (noise reduction): bins quieter than the threshold are
+ * turned down to the floor
+ *
+ * each bin's gain follows its own level, opening at once and closing by
+ * a factor of release every frame, so short gaps in a tone don't flutter
+ * and the noise left behind doesn't sparkle ("musical noise").
+ */
+class SpectralGate: public SpectralProcess {
+    double threshold;           // bin magnitude the gate opens at
+    double floor;               // gain of a closed bin
+    double release;             // gain kept from frame to frame, < 1
+    std::vector<double> gain;   // current gain of each bin
+public:
+    // threshold: level in the units of the samples (1e-3 for -60 dBFS)
+    // floor: gain of the quiet bins (0 to remove them)
+    // release: gain held from one frame to the next as a bin closes
+    SpectralGate(double threshold, double floor = 0.0, double release = 0.5)
+    : threshold{threshold}, floor{floor}, release{release} {}
+
+    void ProcessSpectrum(complex *X, std::size_t K);
+    SpectralGate *Clone() const { return new SpectralGate(*this); }
+};
+
+}
+
+#endif
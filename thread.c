@@ -0,0 +1,182 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
+#include "thread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+
+static DWORD WINAPI thread_start(LPVOID param)
+{
+    struct thread *t = param;
+    t->func(t->arg);
+    return 0;
+}
+
+/* Win32 implementation of thread_create() */
+int thread_create(struct thread *t, void (*func)(void *arg), void *arg)
+{
+    t->func = func;
+    t->arg = arg;
+    t->handle = CreateThread(NULL, 0, thread_start, t, 0, NULL);
+    return t->handle ? 0 : -1;
+}
+
+/* Win32 implementation of thread_join() */
+void thread_join(struct thread *t)
+{
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+}
+
+/* Win32 implementation of thread_cpu_count() */
+int thread_cpu_count(void)
+{
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+}
+
+/* Win32 implementation of thread_yield() */
+void thread_yield(void)
+{
+    SwitchToThread();
+}
+
+/* Win32 implementation of thread_sem_init() */
+int thread_sem_init(struct thread_sem *s, int count)
+{
+    s->handle = CreateSemaphoreA(NULL, count, 0x7FFFFFFF, NULL);
+    return s->handle ? 0 : -1;
+}
+
+/* Win32 implementation of thread_sem_post() */
+void thread_sem_post(struct thread_sem *s)
+{
+    ReleaseSemaphore(s->handle, 1, NULL);
+}
+
+/* Win32 implementation of thread_sem_wait() */
+void thread_sem_wait(struct thread_sem *s)
+{
+    WaitForSingleObject(s->handle, INFINITE);
+}
+
+/* Win32 implementation of thread_sem_destroy() */
+void thread_sem_destroy(struct thread_sem *s)
+{
+    CloseHandle(s->handle);
+}
+
+#else
+#include <sched.h>
+#include <unistd.h>
+
+static void *thread_start(void *param)
+{
+    struct thread *t = param;
+    t->func(t->arg);
+    return NULL;
+}
+
+/*
+ * thread_create() - start a thread
+ * t: thread to start (must stay valid until thread_join())
+ * func: function for the thread to run
+ * arg: argument to pass to func
+ *
+ * Return: 0 on success
+ *        -1 if the thread could not be started
+ */
+int thread_create(struct thread *t, void (*func)(void *arg), void *arg)
+{
+    t->func = func;
+    t->arg = arg;
+    return pthread_create(&t->handle, NULL, thread_start, t)
+           ? -1 : 0;
+}
+
+/*
+ * thread_join() - wait for a thread started by thread_create() to finish
+ * t: thread to wait for
+ */
+void thread_join(struct thread *t)
+{
+    pthread_join(t->handle, NULL);
+}
+
+/*
+ * thread_cpu_count() - number of online processors
+ *
+ * Return: processor count, at least 1
+ */
+int thread_cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/*
+ * thread_yield() - give up the processor to another runnable thread
+ */
+void thread_yield(void)
+{
+    sched_yield();
+}
+
+/*
+ * thread_sem_init() - create a counting semaphore
+ * s: semaphore to create
+ * count: its starting value
+ *
+ * Return: 0 on success
+ *        -1 if it could not be created
+ */
+int thread_sem_init(struct thread_sem *s, int count)
+{
+    s->count = count;
+    if (pthread_mutex_init(&s->lock, NULL) != 0)
+        return -1;
+    if (pthread_cond_init(&s->cond, NULL) != 0) {
+        pthread_mutex_destroy(&s->lock);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * thread_sem_post() - add one to a semaphore
+ * s: semaphore
+ */
+void thread_sem_post(struct thread_sem *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->count++;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/*
+ * thread_sem_wait() - take one from a semaphore, waiting while it is 0
+ * s: semaphore
+ */
+void thread_sem_wait(struct thread_sem *s)
+{
+    pthread_mutex_lock(&s->lock);
+    while (s->count == 0)
+        pthread_cond_wait(&s->cond, &s->lock);
+    s->count--;
+    pthread_mutex_unlock(&s->lock);
+}
+
+/*
+ * thread_sem_destroy() - free a semaphore
+ * s: semaphore no thread is waiting on
+ */
+void thread_sem_destroy(struct thread_sem *s)
+{
+    pthread_cond_destroy(&s->cond);
+    pthread_mutex_destroy(&s->lock);
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef DSP_THREAD_H_INCLUDED
+#define DSP_THREAD_H_INCLUDED
+
+/*
+ * minimal threads for the C modules (POSIX threads or Win32 threads)
+ */
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+struct thread {
+#ifdef _WIN32
+    void *handle;               /* thread HANDLE */
+#else
+    pthread_t handle;           /* POSIX thread */
+#endif
+    void (*func)(void *arg);    /* function the thread runs */
+    void *arg;                  /* argument passed to func */
+};
+
+/* counting semaphore, for handing buffers between threads */
+struct thread_sem {
+#ifdef _WIN32
+    void *handle;               /* semaphore HANDLE */
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int count;
+#endif
+};
+
+/* start a thread running func(arg) */
+int thread_create(struct thread *t, void (*func)(void *arg), void *arg);
+
+/* wait for a thread to finish */
+void thread_join(struct thread *t);
+
+/* number of processors available to run threads on */
+int thread_cpu_count(void);
+
+/* let another thread run (for threads polling a lock-free queue) */
+void thread_yield(void);
+
+/* create a semaphore holding count, -1 if it can't be */
+int thread_sem_init(struct thread_sem *s, int count);
+
+/* add one to a semaphore, waking a thread waiting on it */
+void thread_sem_post(struct thread_sem *s);
+
+/* wait until a semaphore is above 0, then take one from it */
+void thread_sem_wait(struct thread_sem *s);
+
+/* free a semaphore nothing is waiting on */
+void thread_sem_destroy(struct thread_sem *s);
+
+#endif
@@ -0,0 +1,284 @@
+#ifndef DSP_TIMEPARALLEL_HPP_INCLUDED
+#define DSP_TIMEPARALLEL_HPP_INCLUDED
+
+#include "filter.hpp"
+extern "C" {
+#include "thread.h"
+}
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace dsp {
+
+/*
+ * TimeParallel<F> - filter a block on several threads despite feedback
+ *
+ *  dsp::TimeParallel<dsp::BiQuad> f{dsp::BiQuad{b, a}, 8};
+ *
+ * for a linear filter with state s, the output of a chunk starting from
+ * state s is the zero state response (ZSR) of the chunk plus the zero
+ * input response (ZIR) of s, and its final state is the ZSR's final
+ * state plus Φ·s, where Φ is the state transition over the chunk length:
+ *
+ *   x: | chunk 0 | chunk 1 | chunk 2 | ...
+ *   1. every chunk from its true state (chunk 0) or zero state, in parallel
+ *   2. s[k] = end[k-1] + Φ·s[k-1], serially (a few K·K products)
+ *   3. every chunk k >= 1 adds the ZIR of s[k], in parallel
+ *
+ * so each sample is filtered about twice, but on as many threads as
+ * there are chunks. Φ is built from one step of the filter by repeated
+ * squaring. Blocks must be large for this to pay (wave_options.block),
+ * smaller ones are filtered serially. The threads are started by the
+ * first parallel block and wait on a semaphore for each step after
+ * that, until the filter is destroyed; a clone (for another channel)
+ * copies the filter but starts threads of its own.
+ *
+ * F must be linear and provide StateSize(), GetState() and SetState()
+ * (BiQuad and DirectForm2T do). The result matches the serial filter
+ * to rounding; with tolerance > 0 every block is also filtered serially
+ * and the serial output is kept wherever the two differ by more than
+ * tolerance (counted in mismatches).
+ */
+template <typename F>
+class TimeParallel: public Filter {
+    struct Chunk {
+        F f;                        // this chunk's copy of the filter
+        TimeParallel *p;
+        struct thread t;
+        struct thread_sem go;       // posted for each step, and to stop
+        const double *x;
+        double *y;
+        std::size_t n;
+        std::vector<double> zir;    // zero input response
+        std::vector<double> zero;   // zero input
+
+        Chunk(const F &f, TimeParallel *p)
+        : f(f), p{p}, t{}, go{}, x{}, y{}, n{} {}
+    };
+
+    F f;                            // filter, carries the true state
+    int T;                          // most threads
+    std::size_t min_chunk;          // shortest chunk given its own thread
+    std::vector<std::unique_ptr<Chunk>> chunks;     // T, once started
+    std::vector<double> check;      // serial output for the tolerance check
+    bool started;                   // chunks set up
+    int running;                    // chunks 1 up to running have threads
+    bool stop;                      // for the threads to exit
+    void (*job)(Chunk *);           // the step the threads are running
+    struct thread_sem done;         // posted by a thread after each step
+
+    typedef std::vector<double> Matrix;  // K·K, row major
+
+    static void Multiply(const Matrix &A, const Matrix &B, Matrix &C,
+                         std::size_t K) {
+        for (std::size_t i = 0; i < K; i++)
+            for (std::size_t j = 0; j < K; j++) {
+                double acc = 0.0;
+                for (std::size_t k = 0; k < K; k++)
+                    acc += A[i * K + k] * B[k * K + j];
+                C[i * K + j] = acc;
+            }
+    }
+
+    // state transition over n samples of zero input
+    Matrix Transition(std::size_t n) const {
+        const std::size_t K = f.F::StateSize();
+        Matrix step(K * K), result(K * K, 0.0), tmp(K * K);
+        std::vector<double> s(K);
+
+        for (std::size_t j = 0; j < K; j++) {
+            F g = f;
+            std::fill(s.begin(), s.end(), 0.0);
+            s[j] = 1.0;
+            g.F::SetState(s.data());
+            g.F::ProcessSample(0.0);
+            g.F::GetState(s.data());
+            for (std::size_t i = 0; i < K; i++)
+                step[i * K + j] = s[i];
+            result[j * K + j] = 1.0;
+        }
+        for (; n; n >>= 1) {
+            if (n & 1) {
+                Multiply(result, step, tmp, K);
+                result.swap(tmp);
+            }
+            Multiply(step, step, tmp, K);
+            step.swap(tmp);
+        }
+        return result;
+    }
+
+    static void ZeroState(Chunk *c) {
+        c->f.F::ProcessBlock(c->x, c->y, c->n);
+    }
+
+    static void AddZeroInput(Chunk *c) {
+        c->zero.assign(c->n, 0.0);
+        c->zir.resize(c->n);
+        c->f.F::ProcessBlock(c->zero.data(), c->zir.data(), c->n);
+        for (std::size_t i = 0; i < c->n; i++)
+            c->y[i] += c->zir[i];
+    }
+
+    // a chunk's thread: run each step it is given until stopped
+    static void Worker(void *arg) {
+        Chunk *c = static_cast<Chunk *>(arg);
+        TimeParallel *p = c->p;
+
+        for (;;) {
+            thread_sem_wait(&c->go);
+            if (p->stop)
+                break;
+            p->job(c);
+            thread_sem_post(&p->done);
+        }
+    }
+
+    // set up T chunks and start a thread for each but the first (the
+    // caller's); chunks whose thread didn't start are run by the caller
+    void Start() {
+        started = true;
+        for (int k = 0; k < T; k++)
+            chunks.emplace_back(new Chunk(f, this));
+        if (T < 2 || thread_sem_init(&done, 0) != 0)
+            return;
+        for (int k = 1; k < T; k++) {
+            Chunk &c = *chunks[k];
+            if (thread_sem_init(&c.go, 0) != 0)
+                break;
+            if (thread_create(&c.t, Worker, &c) != 0) {
+                thread_sem_destroy(&c.go);
+                break;
+            }
+            running = k;
+        }
+        if (running == 0)
+            thread_sem_destroy(&done);
+    }
+
+    // run func on chunks begin .. end-1, begin on this thread
+    void ForkJoin(void (*func)(Chunk *), std::size_t begin, std::size_t end) {
+        std::size_t posted = 0;
+
+        job = func;
+        for (std::size_t k = begin + 1; k < end; k++)
+            if (k <= std::size_t(running)) {
+                thread_sem_post(&chunks[k]->go);
+                posted++;
+            }
+        func(chunks[begin].get());
+        for (std::size_t k = std::max<std::size_t>(begin + 1, running + 1);
+             k < end; k++)
+            func(chunks[k].get());
+        for (; posted; posted--)
+            thread_sem_wait(&done);
+    }
+
+public:
+    double tolerance;               // > 0 checks against the serial filter
+    std::size_t mismatches;         // samples that failed the check
+    double max_error;               // largest difference seen by the check
+
+    // f: the filter
+    // threads: most threads to use (0 for one per processor)
+    // chunk: shortest chunk worth its own thread
+    TimeParallel(const F &f, int threads = 0, std::size_t chunk = 65536)
+    : f(f), T{threads > 0 ? threads : thread_cpu_count()},
+      min_chunk{chunk}, started{false}, running{0}, stop{false}, job{},
+      done{}, tolerance{}, mismatches{}, max_error{} {}
+    // (a copy has the filter and its settings, and no threads yet)
+    TimeParallel(const TimeParallel &p)
+    : f(p.f), T{p.T}, min_chunk{p.min_chunk}, started{false}, running{0},
+      stop{false}, job{}, done{}, tolerance{p.tolerance},
+      mismatches{p.mismatches}, max_error{p.max_error} {}
+    TimeParallel &operator=(const TimeParallel &) = delete;
+    ~TimeParallel() {
+        stop = true;
+        for (int k = 1; k <= running; k++)
+            thread_sem_post(&chunks[k]->go);
+        for (int k = 1; k <= running; k++) {
+            thread_join(&chunks[k]->t);
+            thread_sem_destroy(&chunks[k]->go);
+        }
+        if (running > 0)
+            thread_sem_destroy(&done);
+    }
+
+    // the filter itself (e.g. to change coefficients)
+    F &Inner() { return f; }
+
+    double ProcessSample(double x) { return f.F::ProcessSample(x); }
+
+    void ProcessBlock(const double *x, double *y, std::size_t n) {
+        const std::size_t K = f.F::StateSize();
+        std::size_t C = std::min<std::size_t>(T, n / min_chunk);
+
+        if (C <= 1) {
+            f.F::ProcessBlock(x, y, n);
+            return;
+        }
+        if (tolerance > 0.0) {
+            F g = f;
+            check.resize(n);
+            g.F::ProcessBlock(x, check.data(), n);
+        }
+
+        // 1. chunk 0 from the true state, the others from zero state
+        std::vector<double> zero(K, 0.0), s(K), end(K);
+        if (!started)
+            Start();
+        for (std::size_t k = 0; k < C; k++) {
+            Chunk &c = *chunks[k];
+            const std::size_t first = n * k / C, last = n * (k + 1) / C;
+            c.f = f;
+            if (k > 0)
+                c.f.F::SetState(zero.data());
+            c.x = x + first;
+            c.y = y + first;
+            c.n = last - first;
+        }
+        ForkJoin(ZeroState, 0, C);
+
+        // 2. carry the true state from chunk to chunk
+        const std::size_t n0 = n / C;
+        const Matrix phi0 = Transition(n0), phi1 = Transition(n0 + 1);
+        chunks[0]->f.F::GetState(s.data());
+        for (std::size_t k = 1; k < C; k++) {
+            Chunk &c = *chunks[k];
+            const Matrix &phi = c.n == n0 ? phi0 : phi1;
+            c.f.F::GetState(end.data());
+            c.f.F::SetState(s.data());  // (start of the zero input run)
+            for (std::size_t i = 0; i < K; i++) {
+                double acc = end[i];
+                for (std::size_t j = 0; j < K; j++)
+                    acc += phi[i * K + j] * s[j];
+                end[i] = acc;
+            }
+            s.swap(end);
+        }
+        f.F::SetState(s.data());
+
+        // 3. add each chunk's zero input response
+        ForkJoin(AddZeroInput, 1, C);
+
+        if (tolerance > 0.0) {
+            for (std::size_t i = 0; i < n; i++) {
+                const double e = std::fabs(y[i] - check[i]);
+                max_error = std::max(max_error, e);
+                if (e > tolerance) {
+                    y[i] = check[i];
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    TimeParallel *Clone() const { return new TimeParallel(*this); }
+};
+
+} // namespace dsp
+
+#endif
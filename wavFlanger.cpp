@@ -2,15 +2,25 @@
 #include "wave.hpp"
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: wavFlanger infile outfile\n");
+    const int stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+
+    if (argc - stats != 3) {
+        fprintf(stderr, "Usage: wavFlanger [--stats] infile outfile\n");
         return EXIT_FAILURE;
     }
 
     dsp::Flanger f{200, 44100, 0.125};
+    wave_stats st{};
+    wave_options opts{};
+    opts.stats = stats ? &st : nullptr;
 
-    return FilterWav(argv[1], argv[2], &f, WAVE_PCM, 0.0);
+    int rv = FilterWav(argv[1 + stats], argv[2 + stats], &f, WAVE_PCM, 0.0,
+                       &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
 }
@@ -1,21 +1,56 @@
 #include "circular.h"
+#include "partitioned.h"
 #include "wave.hpp"
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: wavReverb infile outfile\n");
+    const int stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+
+    if (argc - stats != 3 && argc - stats != 4) {
+        fprintf(stderr,
+                "Usage: wavReverb [--stats] infile outfile [irfile]\n");
         return EXIT_FAILURE;
     }
-    const char *infile = argv[1];
-    const char *outfile = argv[2];
+    const char *infile = argv[1 + stats];
+    const char *outfile = argv[2 + stats];
+    wave_stats st{};
+    wave_options opts{};
+    opts.stats = stats ? &st : nullptr;
+    opts.silence = 1e-6;    // stop the 2 s tail once it is below -120 dBFS
+    int rv;
+
+    if (argc - stats == 3) {
+        dsp::Circular f{5000};
+        f.b[1] = 0.4;
+        f.b[3500] = 0.4;
+        f.a[3000] = 0.6;
+
+        rv = FilterWav(infile, outfile, &f, WAVE_PCM, 2.0, &opts);
+        if (stats && rv == 0)
+            wave_print_stats(&st, stderr);
+        return rv;
+    }
+
+    // measured room: partitioned convolution with the first channel of
+    // the impulse response, one 256 sample block of the file at a time
+    struct wave ir;
+    size_t M;
+    double *samples = wave_load(argv[3 + stats], &ir, &M);
+    if (!samples)
+        return EXIT_FAILURE;
+    std::vector<double> h(M);
+    for (size_t i = 0; i < M; i++)
+        h[i] = samples[i * ir.channels];
+    free(samples);
 
-    dsp::Circular f{5000};
-    f.b[1] = 0.4;
-    f.b[3500] = 0.4;
-    f.a[3000] = 0.6;
+    dsp::PartitionedConvolver f{h, 256};
+    opts.block = f.BlockSize();
 
-    return FilterWav(infile, outfile, &f, WAVE_PCM, 2.0);
+    rv = FilterWav(infile, outfile, &f, WAVE_PCM, 2.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
 }
@@ -1,15 +1,13 @@
 #include "wave.h"
 #include "delayline.h"
+#include "oscltr.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <math.h>
-
-#define PI 3.14159265358979323846
+#include <string.h>
 
 struct flanger
 {
-    double rate;
-    double phase;
+    struct oscltr lfo;
     struct delay *delay;
 };
 
@@ -20,34 +18,48 @@ double flanger_sample(struct flanger *f, double x)
     double y;
     double n;
 
-    n = (N-1) * (0.5 * cos(2 * PI * f->rate * f->phase) + 0.5);
+    n = (N-1) * (0.5 * oscltr_next(&f->lfo) + 0.5);
 
     *delay_w0(delay) = x;
 
     y = 0.5 * delay_w(delay, N / 2) + 0.5 * delay_w(delay, n);
 
     delay_dec(delay);
-    f->phase += 1.0 / 44100.0;
 
     return y;
 }
 
+void flanger_block(struct flanger *f, const double *x, double *y, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        y[i] = flanger_sample(f, x[i]);
+}
+
 int main(int argc, char *argv[])
 {
     const char *infile, *outfile;
     struct flanger f;
+    struct wave_options opts = {0};
+    struct wave_stats st;
+    int stats, rv;
 
-    if (argc != 3) {
-        fprintf(stderr, "Usage: wavflanger infile outfile\n");
+    stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+    if (argc - stats != 3) {
+        fprintf(stderr, "Usage: wavflanger [--stats] infile outfile\n");
         return EXIT_FAILURE;
     }
-    infile = argv[1];
-    outfile = argv[2];
+    infile = argv[1 + stats];
+    outfile = argv[2 + stats];
 
-    f.rate = 0.125;
-    f.phase = 0.0;
+    oscltr_init(&f.lfo, 0.125, 44100.0, 0.0);
     f.delay = delay_create(200);
 
-    return wave_filter(infile, outfile,
-                       (filter_func)flanger_sample, &f, WAVE_PCM, 0.0);
+    opts.stats = stats ? &st : NULL;
+    rv = wave_filter_ex(infile, outfile, (block_filter_func)flanger_block,
+                        &f, WAVE_PCM, 0.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
 }
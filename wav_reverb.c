@@ -2,6 +2,7 @@
 #include "cirfltr.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 int     b_i[2] = {1, 3500};
 double  b_v[2] = {0.4, 0.4};
@@ -12,16 +13,25 @@ int main(int argc, char *argv[])
 {
     const char *infile, *outfile;
     struct cirfltr *cf;
+    struct wave_options opts = {0};
+    struct wave_stats st;
+    int stats, rv;
 
-    if (argc != 3) {
-        fprintf(stderr, "Usage: wavreverb infile outfile\n");
+    stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+    if (argc - stats != 3) {
+        fprintf(stderr, "Usage: wavreverb [--stats] infile outfile\n");
         return EXIT_FAILURE;
     }
 
-    infile = argv[1];
-    outfile = argv[2];
+    infile = argv[1 + stats];
+    outfile = argv[2 + stats];
 
-    cf = cirfltr_create(5000, 2, b_i, b_v, 2, a_i, a_v);
-    return wave_filter(infile, outfile, (filter_func)cirfltr_sample, cf,
-                       WAVE_PCM, 2.0);
+    cf = cirfltr_create(5000, 2, b_i, b_v, 1, a_i, a_v);
+    opts.stats = stats ? &st : NULL;
+    opts.silence = 1e-6;    /* stop the 2 s tail once it is below -120 dBFS */
+    rv = wave_filter_ex(infile, outfile, (block_filter_func)cirfltr_block,
+                        cf, WAVE_PCM, 2.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
 }
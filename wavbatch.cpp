@@ -0,0 +1,323 @@
+#include "biquad.h"
+#include "cascade.h"
+#include "circular.h"
+#include "directform.h"
+#include "flanger.hpp"
+#include "wave.hpp"
+extern "C" {
+#include "convert.h"
+#include "thread.h"
+}
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+/*
+ * wavbatch - run one of the demo filters over many files
+ *
+ *  wavbatch [--stats] [-j threads] filter manifest
+ *  wavbatch [--stats] [-j threads] filter indir outdir
+ *
+ * a manifest is a text file of "infile<tab>outfile" lines (or, for
+ * names without spaces, "infile outfile"), and a line that is neither
+ * is reported and stops the run before it starts. A directory has every
+ * .wav file in it filtered into outdir under the same name. Each
+ * filter is built once and cloned for every file, and the files are
+ * shared out between the threads as they become free. A file that
+ * fails is reported and the rest carry on. With --stats the run
+ * statistics of every file are printed at the end.
+ */
+
+// a filter prototype and how the single file tool runs it
+struct Tool {
+    const char *name;
+    dsp::Filter *(*create)();
+    int format;
+    double duration;
+};
+
+static dsp::Filter *CreateBiQuad()
+{
+    return new dsp::BiQuad{{0.00425, 0.0, -0.00425}, {1.0, -1.98, 0.991}};
+}
+
+static dsp::Filter *CreateCascade()
+{
+    return new dsp::BiQuadCascade{{
+        {0.00425, 0.0, -0.00425, 1.0, -1.98, 0.991},
+        {0.00425, 0.0, -0.00425, 1.0, -1.98, 0.991},
+    }};
+}
+
+static dsp::Filter *CreateDir1()
+{
+    return new dsp::DirectForm1{{1.0}, {1.0, 0.5}};
+}
+
+static dsp::Filter *CreateDir2()
+{
+    return new dsp::DirectForm2{{1.0, 0.4}, {1.0, 0.3, 0.3}};
+}
+
+static dsp::Filter *CreateDir2T()
+{
+    return new dsp::DirectForm2T{{1.0, 0.4}, {1.0, 0.3, 0.3}};
+}
+
+static dsp::Filter *CreateReverb()
+{
+    dsp::Circular *f = new dsp::Circular{5000};
+    f->b[1] = 0.4;
+    f->b[3500] = 0.4;
+    f->a[3000] = 0.6;
+    return f;
+}
+
+static dsp::Filter *CreateFlanger()
+{
+    return new dsp::Flanger{200, 44100, 0.125};
+}
+
+static const Tool tools[] = {
+    {"biquad", CreateBiQuad, WAVE_FLOAT, 0.0},
+    {"cascade", CreateCascade, WAVE_FLOAT, 0.0},
+    {"dir1", CreateDir1, WAVE_FLOAT, 0.0},
+    {"dir2", CreateDir2, WAVE_FLOAT, 0.0},
+    {"dir2t", CreateDir2T, WAVE_FLOAT, 0.0},
+    {"reverb", CreateReverb, WAVE_PCM, 2.0},
+    {"flanger", CreateFlanger, WAVE_PCM, 0.0},
+};
+
+struct Job {
+    std::string infile;
+    std::string outfile;
+    int rv;
+    wave_stats stats;
+};
+
+// work shared by the threads
+struct Batch {
+    const Tool *tool;
+    const dsp::Filter *prototype;
+    std::vector<Job> jobs;
+    std::atomic<std::size_t> next;  // first job not yet taken
+    bool stats;                     // collect Job::stats
+};
+
+// take jobs until there are none left
+static void Worker(void *arg)
+{
+    Batch *b = static_cast<Batch *>(arg);
+    wave_options opts{};
+    opts.threads = 1;   // (the files are the parallelism)
+
+    for (;;) {
+        const std::size_t i = b->next++;
+        if (i >= b->jobs.size())
+            break;
+        Job &job = b->jobs[i];
+        std::unique_ptr<dsp::Filter> f{b->prototype->Clone()};
+        if (!f) {
+            job.rv = 8;
+            continue;
+        }
+        opts.stats = b->stats ? &job.stats : nullptr;
+        job.rv = dsp::FilterWav(job.infile.c_str(), job.outfile.c_str(),
+                                f.get(), b->tool->format,
+                                b->tool->duration, &opts);
+    }
+}
+
+// split a manifest line into infile and outfile: at its one tab, or
+// without a tab at the space between two names with no spaces in them
+static bool SplitLine(const std::string &line, Job &job)
+{
+    std::size_t i = line.find('\t');
+
+    if (i != std::string::npos) {
+        if (line.find('\t', i + 1) != std::string::npos)
+            return false;
+        job.infile = line.substr(0, i);
+        job.outfile = line.substr(i + 1);
+    } else {
+        const std::size_t a = line.find_first_not_of(" ");
+        const std::size_t b = line.find(' ', a);
+        const std::size_t c = line.find_first_not_of(" ", b);
+        const std::size_t d = line.find(' ', c);
+
+        if (c == std::string::npos
+            || line.find_first_not_of(" ", d) != std::string::npos)
+            return false;
+        job.infile = line.substr(a, b - a);
+        job.outfile = line.substr(c, d - c);
+    }
+    return !job.infile.empty() && !job.outfile.empty();
+}
+
+// read "infile<tab>outfile" lines (blank lines are skipped), reporting
+// every line that isn't one
+static bool ReadManifest(const char *manifest, std::vector<Job> &jobs)
+{
+    FILE *fp = fopen(manifest, "r");
+    char buf[4096];
+    std::string line;
+    bool ok = true;
+    int number = 0;
+
+    if (!fp) {
+        perror(manifest);
+        return false;
+    }
+    while (fgets(buf, sizeof(buf), fp)) {
+        line += buf;
+        if (line.back() != '\n' && !feof(fp))
+            continue;       // (the rest of a long line)
+        number++;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+            line.pop_back();
+        Job job{};
+        if (line.find_first_not_of(" \t") == std::string::npos) {
+            // blank
+        } else if (SplitLine(line, job)) {
+            jobs.push_back(job);
+        } else {
+            fprintf(stderr, "%s:%d: expected \"infile<tab>outfile\"\n",
+                    manifest, number);
+            ok = false;
+        }
+        line.clear();
+    }
+    if (ferror(fp)) {
+        perror(manifest);
+        ok = false;
+    }
+    fclose(fp);
+    return ok;
+}
+
+static bool IsWav(const std::string &name)
+{
+    return name.size() > 4
+           && (name.compare(name.size() - 4, 4, ".wav") == 0
+               || name.compare(name.size() - 4, 4, ".WAV") == 0);
+}
+
+// every .wav file in indir, written to outdir
+static bool ReadDirectory(const char *indir, const char *outdir,
+                          std::vector<Job> &jobs)
+{
+    const std::string in = std::string(indir) + "/";
+    const std::string out = std::string(outdir) + "/";
+#ifdef _WIN32
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA((in + "*.wav").c_str(), &fd);
+
+    if (h == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "%s: could not list directory\n", indir);
+        return false;
+    }
+    do {
+        if (IsWav(fd.cFileName))
+            jobs.push_back(Job{in + fd.cFileName, out + fd.cFileName, 0});
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    DIR *d = opendir(indir);
+    struct dirent *de;
+
+    if (!d) {
+        perror(indir);
+        return false;
+    }
+    while ((de = readdir(d)) != nullptr)
+        if (IsWav(de->d_name))
+            jobs.push_back(Job{in + de->d_name, out + de->d_name, 0});
+    closedir(d);
+#endif
+    return true;
+}
+
+static int Usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [--stats] [-j threads] filter manifest\n",
+            prog);
+    fprintf(stderr, "       %s [--stats] [-j threads] filter indir outdir\n",
+            prog);
+    fprintf(stderr, "filters:");
+    for (const Tool &t : tools)
+        fprintf(stderr, " %s", t.name);
+    fprintf(stderr, "\n");
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+    int threads = 0;
+    int arg = 1;
+    bool stats = false;
+
+    if (arg < argc && strcmp(argv[arg], "--stats") == 0) {
+        stats = true;
+        arg++;
+    }
+    if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0) {
+        threads = atoi(argv[arg + 1]);
+        arg += 2;
+    }
+    if (argc - arg != 2 && argc - arg != 3)
+        return Usage(argv[0]);
+
+    Batch b;
+    b.tool = nullptr;
+    for (const Tool &t : tools)
+        if (strcmp(argv[arg], t.name) == 0)
+            b.tool = &t;
+    if (!b.tool)
+        return Usage(argv[0]);
+    std::unique_ptr<dsp::Filter> prototype{b.tool->create()};
+    b.prototype = prototype.get();
+
+    if (argc - arg == 2 ? !ReadManifest(argv[arg + 1], b.jobs)
+                        : !ReadDirectory(argv[arg + 1], argv[arg + 2], b.jobs))
+        return EXIT_FAILURE;
+    b.next = 0;
+    b.stats = stats;
+
+    if (threads <= 0)
+        threads = thread_cpu_count();
+    if ((std::size_t)threads > b.jobs.size())
+        threads = b.jobs.size() > 0 ? b.jobs.size() : 1;
+
+    convert_init();
+    std::vector<struct thread> pool(threads);
+    std::vector<int> started(threads);
+    for (int t = 1; t < threads; t++)
+        started[t] = thread_create(&pool[t], Worker, &b) == 0;
+    Worker(&b);
+    for (int t = 1; t < threads; t++)
+        if (started[t])
+            thread_join(&pool[t]);
+
+    std::size_t failed = 0;
+    for (const Job &job : b.jobs) {
+        if (job.rv != 0) {
+            fprintf(stderr, "%s: failed (%d)\n", job.infile.c_str(), job.rv);
+            failed++;
+        } else if (stats) {
+            fprintf(stderr, "%s:\n", job.infile.c_str());
+            wave_print_stats(&job.stats, stderr);
+        }
+    }
+    fprintf(stderr, "%zu files, %zu failed\n", b.jobs.size(), failed);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
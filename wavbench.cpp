@@ -0,0 +1,406 @@
+#include "biquad.h"
+#include "cascade.h"
+#include "chorus.hpp"
+#include "circular.h"
+#include "convolver.h"
+#include "directform.h"
+#include "flanger.hpp"
+#include "partitioned.h"
+#include "stft.h"
+#include "wave.hpp"
+extern "C" {
+#include "canfltr.h"
+#include "cirfltr.h"
+#include "convert.h"
+}
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * wavbench - throughput of every filter, conversion and wave_filter path
+ *
+ * prints one CSV line per measurement (see `make bench`):
+ *
+ *   group,name,param,block,samples,seconds,samples_per_sec
+ *
+ * param is the size that matters for the test (taps, sections, ...), and
+ * block the number of samples per call (1 for ProcessSample). Every test
+ * repeats until it has run for at least MIN_SECONDS.
+ */
+
+static const double MIN_SECONDS = 0.1;
+static const std::size_t SIGNAL = 1 << 16;          // samples per pass
+static const int FS = 44100;
+
+typedef std::chrono::steady_clock Clock;
+static volatile double sink;    // keeps results from being optimized out
+
+static std::vector<double> Noise(std::size_t n)
+{
+    std::vector<double> x(n);
+    unsigned r = 1;
+    for (double &v : x) {
+        r = r * 1103515245 + 12345;
+        v = ((r >> 8) & 0xffff) / 32768.0 - 1.0;
+    }
+    return x;
+}
+
+static void Report(const char *group, const std::string &name, long param,
+                   std::size_t block, double samples, double seconds)
+{
+    printf("%s,%s,%ld,%zu,%.0f,%.6f,%.0f\n", group, name.c_str(), param,
+           block, samples, seconds, samples / seconds);
+    fflush(stdout);
+}
+
+// time pass(), which processes `samples` samples, until MIN_SECONDS
+template <typename Pass>
+static void Time(const char *group, const std::string &name, long param,
+                 std::size_t block, std::size_t samples, Pass pass)
+{
+    double total = 0.0, seconds = 0.0;
+    const Clock::time_point start = Clock::now();
+
+    do {
+        pass();
+        total += samples;
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (seconds < MIN_SECONDS);
+    Report(group, name, param, block, total, seconds);
+}
+
+// ProcessSample() and ProcessBlock() in a range of block sizes
+template <typename T>
+static void BenchFilter(const std::string &name, long param,
+                        dsp::BasicFilter<T> &f)
+{
+    static const std::size_t blocks[] = {1, 64, 1024, 16384};
+    const std::vector<double> noise = Noise(SIGNAL);
+    const std::vector<T> x(noise.begin(), noise.end());
+    std::vector<T> y(SIGNAL);
+
+    for (std::size_t block : blocks) {
+        Time("filter", name, param, block, SIGNAL, [&] {
+            if (block == 1) {
+                for (std::size_t i = 0; i < SIGNAL; i++)
+                    y[i] = f.ProcessSample(x[i]);
+            } else {
+                for (std::size_t i = 0; i < SIGNAL; i += block)
+                    f.ProcessBlock(&x[i], &y[i], block);
+            }
+            sink = y[SIGNAL - 1];
+        });
+    }
+}
+
+// ProcessBlockQ15() on 16 bit samples, 1024 at a time
+template <typename T>
+static void BenchFixed(const std::string &name, long param,
+                       dsp::BasicFilter<T> &f)
+{
+    const std::vector<double> noise = Noise(SIGNAL);
+    std::vector<int16_t> x(SIGNAL), y(SIGNAL);
+
+    convert_double_to_pcm16(noise.data(), x.data(), SIGNAL);
+    Time("fixed", name, param, 1024, SIGNAL, [&] {
+        for (std::size_t i = 0; i < SIGNAL; i += 1024)
+            f.ProcessBlockQ15(&x[i], &y[i], 1024);
+        sink = y[SIGNAL - 1];
+    });
+}
+
+static std::vector<double> Taps(std::size_t n, double scale)
+{
+    std::vector<double> t = Noise(n);
+    for (double &v : t)
+        v *= scale / n;
+    return t;
+}
+
+static void BenchFilters()
+{
+    static const std::size_t taps[] = {8, 64, 512, 4096};
+
+    for (std::size_t n : taps) {
+        const std::vector<double> b = Taps(n, 1.0);
+        std::vector<double> a = Taps(n, 0.5);
+        a[0] = 1.0;
+        dsp::DirectForm1 fir1{b, {1.0}};
+        dsp::DirectForm1 df1{b, a};
+        dsp::DirectForm2 df2{b, a};
+        dsp::DirectForm2T df2t{b, a};
+        BenchFilter("DirectForm1(fir)", n, fir1);
+        BenchFilter("DirectForm1", n, df1);
+        BenchFilter("DirectForm2", n, df2);
+        BenchFilter("DirectForm2T", n, df2t);
+        BenchFixed("DirectForm1(fir)", n, fir1);
+        BenchFixed("DirectForm1", n, df1);
+
+        const std::vector<float> bf(b.begin(), b.end());
+        dsp::BasicDirectForm1<float> fir1f{bf, {1.0f}};
+        BenchFilter("DirectForm1<float>(fir)", n, fir1f);
+    }
+
+    dsp::BiQuad bq{{0.00425, 0.0, -0.00425}, {1.0, -1.98, 0.991}};
+    BenchFilter("BiQuad", 3, bq);
+    BenchFixed("BiQuad", 3, bq);
+    dsp::BasicBiQuad<float> bqf{{0.00425f, 0.0f, -0.00425f},
+                                {1.0f, -1.98f, 0.991f}};
+    BenchFilter("BiQuad<float>", 3, bqf);
+
+    static const int sections[] = {2, 10};
+    for (int k : sections) {
+        std::vector<std::array<double,6>> sos(k,
+            {{0.00425, 0.0, -0.00425, 1.0, -1.98, 0.991}});
+        dsp::BiQuadCascade c{sos};
+        BenchFilter("BiQuadCascade", k, c);
+    }
+
+    static const int lines[] = {5000, 100000};
+    for (int n : lines) {
+        dsp::Circular c{n};
+        for (int k = 1; k <= 24; k++)
+            c.b[k * (n / 25)] = 0.02;
+        for (int k = 1; k <= 8; k++)
+            c.a[k * (n / 9)] = 0.05;
+        BenchFilter("Circular", n, c);
+
+        dsp::BasicCircular<float> cf{n};
+        for (auto t : c.b)
+            cf.b[t.first] = t.second;
+        for (auto t : c.a)
+            cf.a[t.first] = t.second;
+        BenchFilter("Circular<float>", n, cf);
+    }
+
+    dsp::Flanger fl{200, FS, 0.125};
+    BenchFilter("Flanger", 200, fl);
+
+    static const int voices[] = {8, 16};
+    for (int v : voices) {
+        dsp::Chorus ch{v, 1000, FS, 0.3};
+        BenchFilter("Chorus", v, ch);
+    }
+
+    static const std::size_t irs[] = {4096, 65536};
+    for (std::size_t m : irs) {
+        dsp::Convolver cv{Taps(m, 1.0)};
+        dsp::PartitionedConvolver pc{Taps(m, 1.0), 256};
+        BenchFilter("Convolver", m, cv);
+        BenchFilter("PartitionedConvolver", m, pc);
+    }
+
+    static const std::size_t frames[] = {512, 2048};
+    for (std::size_t n : frames) {
+        dsp::SpectralFilter sf{new dsp::SpectralGate{1e-3}, n};
+        BenchFilter("SpectralFilter(gate)", n, sf);
+    }
+}
+
+// the C modules, sample by sample and by block
+template <typename S, typename B>
+static void BenchModule(const std::string &name, long param, S sample,
+                        B block)
+{
+    const std::vector<double> x = Noise(SIGNAL);
+    std::vector<double> y(SIGNAL);
+
+    Time("module", name, param, 1, SIGNAL, [&] {
+        for (std::size_t i = 0; i < SIGNAL; i++)
+            y[i] = sample(x[i]);
+        sink = y[SIGNAL - 1];
+    });
+    Time("module", name, param, 1024, SIGNAL, [&] {
+        for (std::size_t i = 0; i < SIGNAL; i += 1024)
+            block(&x[i], &y[i], 1024);
+        sink = y[SIGNAL - 1];
+    });
+}
+
+static void BenchModules()
+{
+    static const int taps[] = {8, 64, 512, 4096};
+
+    for (int n : taps) {
+        std::vector<double> b = Taps(n, 1.0), a = Taps(n, 0.5);
+        a[0] = 1.0;
+        struct canfltr *s = canfltr_create(n, b.data(), a.data());
+        BenchModule("canfltr", n,
+                    [&](double x) { return canfltr_sample(s, x); },
+                    [&](const double *x, double *y, std::size_t m) {
+                        canfltr_block(s, x, y, m);
+                    });
+
+        const std::vector<double> noise = Noise(SIGNAL);
+        std::vector<int16_t> x(SIGNAL), y(SIGNAL);
+        convert_double_to_pcm16(noise.data(), x.data(), SIGNAL);
+        Time("fixed", "canfltr", n, 1024, SIGNAL, [&] {
+            for (std::size_t i = 0; i < SIGNAL; i += 1024)
+                canfltr_block_q15(s, &x[i], &y[i], 1024);
+            sink = y[SIGNAL - 1];
+        });
+        canfltr_destroy(s);
+    }
+
+    static const int lines[] = {5000, 100000};
+    for (int n : lines) {
+        std::vector<int> bi, ai;
+        std::vector<double> bv, av;
+        for (int k = 1; k <= 24; k++)
+            bi.push_back(k * (n / 25)), bv.push_back(0.02);
+        for (int k = 1; k <= 8; k++)
+            ai.push_back(k * (n / 9)), av.push_back(0.05);
+        struct cirfltr *s = cirfltr_create(n, bi.size(), bi.data(), bv.data(),
+                                           ai.size(), ai.data(), av.data());
+        BenchModule("cirfltr", n,
+                    [&](double x) { return cirfltr_sample(s, x); },
+                    [&](const double *x, double *y, std::size_t m) {
+                        cirfltr_block(s, x, y, m);
+                    });
+        cirfltr_destroy(s);
+    }
+}
+
+static void BenchConvert()
+{
+    static const std::size_t sizes[] = {64, 1024, 65536};
+    const std::string isa = convert_isa();
+
+    for (std::size_t n : sizes) {
+        std::vector<double> d = Noise(n);
+        std::vector<int16_t> p(n);
+        std::vector<float> f(n);
+        const std::size_t reps = SIGNAL / n > 0 ? SIGNAL / n : 1;
+
+        Time("convert", "double_to_pcm16/" + isa, n, n, reps * n, [&] {
+            for (std::size_t r = 0; r < reps; r++)
+                convert_double_to_pcm16(d.data(), p.data(), n);
+        });
+        Time("convert", "pcm16_to_double/" + isa, n, n, reps * n, [&] {
+            for (std::size_t r = 0; r < reps; r++)
+                convert_pcm16_to_double(p.data(), d.data(), n);
+        });
+        Time("convert", "double_to_float/" + isa, n, n, reps * n, [&] {
+            for (std::size_t r = 0; r < reps; r++)
+                convert_double_to_float(d.data(), f.data(), n);
+        });
+        Time("convert", "float_to_double/" + isa, n, n, reps * n, [&] {
+            for (std::size_t r = 0; r < reps; r++)
+                convert_float_to_double(f.data(), d.data(), n);
+        });
+        std::vector<uint8_t> b(3 * n);
+        for (std::size_t i = 0; i < b.size(); i++)
+            b[i] = (uint8_t)(i * 2654435761u >> 24);
+        Time("convert", "pcm24_to_double/" + isa, n, n, reps * n, [&] {
+            for (std::size_t r = 0; r < reps; r++)
+                convert_pcm24_to_double(b.data(), d.data(), n);
+        });
+        Time("convert", "ulaw_to_double", n, n, reps * n, [&] {
+            for (std::size_t r = 0; r < reps; r++)
+                convert_ulaw_to_double(b.data(), d.data(), n);
+        });
+    }
+}
+
+// write a mono test file of n frames in the given format
+static bool WriteTestFile(const char *filename, int format, std::size_t n)
+{
+    const std::vector<double> x = Noise(n);
+    struct wave w;
+    FILE *fp = fopen(filename, "wb");
+
+    if (!fp) {
+        perror(filename);
+        return false;
+    }
+    memcpy(w.riff_tag, "RIFF", 4);
+    memcpy(w.wave_tag, "WAVE", 4);
+    memcpy(w.fmt_tag, "fmt ", 4);
+    memcpy(w.data_tag, "data", 4);
+    w.fmt_size = 16;
+    w.format = format;
+    w.channels = 1;
+    w.samplerate = FS;
+    w.bitspersample = format == WAVE_FLOAT ? 32 : 16;
+    w.blockalign = w.bitspersample / 8;
+    w.byterate = w.blockalign * FS;
+    w.data_size = n * w.blockalign;
+    w.riff_size = w.data_size + 36;
+    wave_write_header(&w, fp);
+    if (format == WAVE_FLOAT) {
+        std::vector<float> f(n);
+        convert_double_to_float(x.data(), f.data(), n);
+        fwrite(f.data(), sizeof(float), n, fp);
+    } else {
+        std::vector<int16_t> p(n);
+        convert_double_to_pcm16(x.data(), p.data(), n);
+        fwrite(p.data(), sizeof(int16_t), n, fp);
+    }
+    fclose(fp);
+    return true;
+}
+
+// the four wave_filter conversion paths, through stdio and mapped files
+static void BenchWaveFilter()
+{
+    static const struct {
+        const char *name;
+        int in, out;
+    } paths[] = {
+        {"pcm2pcm", WAVE_PCM, WAVE_PCM},
+        {"pcm2float", WAVE_PCM, WAVE_FLOAT},
+        {"float2float", WAVE_FLOAT, WAVE_FLOAT},
+        {"float2pcm", WAVE_FLOAT, WAVE_PCM},
+    };
+    const std::size_t n = 10 * FS;
+    const char *pcm = "wavbench_pcm.wav", *flt = "wavbench_float.wav";
+    const char *out = "wavbench_out.wav";
+
+    if (!WriteTestFile(pcm, WAVE_PCM, n) || !WriteTestFile(flt, WAVE_FLOAT, n))
+        return;
+    for (const auto &p : paths) {
+        for (int mmap = 0; mmap <= 1; mmap++) {
+            dsp::BiQuad f{{0.00425, 0.0, -0.00425}, {1.0, -1.98, 0.991}};
+            wave_options opts{};
+            opts.mmap = mmap;
+            Time("wave_filter", std::string(p.name) + (mmap ? "/mmap" : "/stdio"),
+                 n, 1024, n, [&] {
+                dsp::FilterWav(p.in == WAVE_PCM ? pcm : flt, out, &f, p.out,
+                               0.0, &opts);
+            });
+        }
+    }
+    // pcm2pcm above runs the biquad in fixed point, this in double
+    for (int mmap = 0; mmap <= 1; mmap++) {
+        dsp::BiQuad f{{0.00425, 0.0, -0.00425}, {1.0, -1.98, 0.991}};
+        wave_options opts{};
+        opts.mmap = mmap;
+        Time("wave_filter",
+             mmap ? "pcm2pcm-double/mmap" : "pcm2pcm-double/stdio",
+             n, 1024, n, [&] {
+            wave_filter_ex(pcm, out,
+                           (block_filter_func)dsp::FilterWavProcessBlock, &f,
+                           WAVE_PCM, 0.0, &opts);
+        });
+    }
+    remove(out);
+    remove(flt);
+    remove(pcm);
+}
+
+int main()
+{
+    printf("group,name,param,block,samples,seconds,samples_per_sec\n");
+    BenchFilters();
+    BenchModules();
+    BenchConvert();
+    BenchWaveFilter();
+    return EXIT_SUCCESS;
+}
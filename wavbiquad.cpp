@@ -1,18 +1,37 @@
 #include "biquad.h"
+#include "timeparallel.hpp"
 #include "wave.hpp"
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 dsp::BiQuad f{{0.00425, 0.0, -0.00425}, {1.0, -1.98, 0.991}};
 
 int main(int argc, char *argv[])
 {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s infile outfile\n", argv[0]);
+    const int stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+
+    if (argc - stats != 3 && argc - stats != 4) {
+        fprintf(stderr, "Usage: %s [--stats] infile outfile [threads]\n",
+                argv[0]);
         return EXIT_FAILURE;
     }
-    const char *infile = argv[1];
-    const char *outfile = argv[2];
+    const char *infile = argv[1 + stats];
+    const char *outfile = argv[2 + stats];
+    wave_stats st{};
+    wave_options opts{};
+    opts.stats = stats ? &st : nullptr;
+    int rv;
 
-    return FilterWav(infile, outfile, &f, WAVE_FLOAT, 0.0);
+    if (argc - stats == 3) {
+        rv = FilterWav(infile, outfile, &f, WAVE_FLOAT, 0.0, &opts);
+    } else {
+        // parallel in time: large blocks split between the threads
+        dsp::TimeParallel<dsp::BiQuad> p{f, atoi(argv[3 + stats])};
+        opts.block = 1 << 20;
+        rv = FilterWav(infile, outfile, &p, WAVE_FLOAT, 0.0, &opts);
+    }
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
 }
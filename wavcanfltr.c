@@ -2,6 +2,7 @@
 #include "canfltr.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 double b[3] = {0.2, 0.2, 0.2};
 double a[3] = {1.0, 0.3, 0.3};
@@ -9,17 +10,27 @@ double a[3] = {1.0, 0.3, 0.3};
 int main(int argc, char *argv[])
 {
     struct canfltr *fs;
-    int rv;
+    struct wave_options opts = {0};
+    struct wave_stats st;
+    int stats, rv;
 
-    if (argc != 3) {
-        fprintf(stderr, "Usage: wavcanfilt infile outfile\n");
+    stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+    if (argc - stats != 3) {
+        fprintf(stderr, "Usage: wavcanfilt [--stats] infile outfile\n");
         return EXIT_FAILURE;
     }
 
     fs = canfltr_create(3, b, a);
-    rv = wave_filter(argv[1], argv[2],
-                     (filter_func)canfltr_sample,
-                     fs, WAVE_PCM, 0.0);
+    opts.clone = (void *(*)(void *))canfltr_clone;
+    opts.destroy = (void (*)(void *))canfltr_destroy;
+    opts.taps = canfltr_taps(fs);   /* 0 here, a has feedback */
+    opts.q15 = (block_filter_q15_func)canfltr_block_q15;
+    opts.stats = stats ? &st : NULL;
+    rv = wave_filter_ex(argv[1 + stats], argv[2 + stats],
+                        (block_filter_func)canfltr_block,
+                        fs, WAVE_PCM, 0.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
 
     return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,50 @@
+#include "cascade.h"
+#include "wave.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// two band pass sections (the wavbiquad filter twice)
+const std::vector<std::array<double,6>> sos = {
+    {0.00425, 0.0, -0.00425, 1.0, -1.98, 0.991},
+    {0.00425, 0.0, -0.00425, 1.0, -1.98, 0.991},
+};
+
+// wave_options.interleaved passes n frames, not samples
+static void ProcessFrames(void *f, const double *x, double *y, std::size_t n)
+{
+    static_cast<dsp::BiQuadCascade *>(f)->ProcessFrames(x, y, n);
+}
+
+static int SetChannels(void *f, int channels)
+{
+    static_cast<dsp::BiQuadCascade *>(f)->SetChannels(channels);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const int stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+
+    if (argc - stats != 3) {
+        fprintf(stderr, "Usage: %s [--stats] infile outfile\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *infile = argv[1 + stats];
+    const char *outfile = argv[2 + stats];
+
+    // one cascade filters all the channels side by side, sized for
+    // them by the engine once it has read the header
+    dsp::BiQuadCascade f{sos};
+    wave_stats st{};
+    wave_options opts{};
+    opts.interleaved = 1;
+    opts.setup = SetChannels;
+    opts.stats = stats ? &st : nullptr;
+
+    int rv = wave_filter_ex(infile, outfile, ProcessFrames, &f, WAVE_FLOAT,
+                            0.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
+}
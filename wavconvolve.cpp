@@ -0,0 +1,49 @@
+#include "convolver.h"
+#include "wave.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int main(int argc, char *argv[])
+{
+    const int stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+    // --normalize dB: scale the output to that peak level (0 for full
+    // scale) instead of clipping it, in a second pass
+    const int norm = argc > 2 + stats
+                     && strcmp(argv[1 + stats], "--normalize") == 0 ? 2 : 0;
+
+    if (argc - stats - norm != 4) {
+        fprintf(stderr, "Usage: %s [--stats] [--normalize dB] "
+                        "irfile infile outfile\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *irfile = argv[1 + stats + norm];
+    const char *infile = argv[2 + stats + norm];
+    const char *outfile = argv[3 + stats + norm];
+
+    // the impulse response (its first channel is used for every channel)
+    struct wave ir;
+    size_t M;
+    double *samples = wave_load(irfile, &ir, &M);
+    if (!samples)
+        return EXIT_FAILURE;
+    std::vector<double> h(M);
+    for (size_t i = 0; i < M; i++)
+        h[i] = samples[i * ir.channels];
+    free(samples);
+
+    dsp::Convolver f{h};
+    wave_stats st{};
+    wave_options opts{};
+    opts.block = f.BlockSize();
+    opts.tail = f.ImpulseLength() - 1;  // the tail of the last input sample
+    opts.stats = stats ? &st : nullptr;
+    if (norm)
+        opts.normalize = std::pow(10.0, atof(argv[2 + stats]) / 20.0);
+
+    int rv = FilterWav(infile, outfile, &f, WAVE_FLOAT, 0.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
+}
@@ -2,19 +2,28 @@
 #include "wave.hpp"
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 dsp::DirectForm1 f{{1.0}, {1.0, 0.5}};
 
 int main(int argc, char *argv[])
 {
     const char *infile, *outfile;
+    const int stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
 
-    if (argc != 3) {
-        fprintf(stderr, "Usage: wavCanFilt infile outfile\n");
+    if (argc - stats != 3) {
+        fprintf(stderr, "Usage: wavCanFilt [--stats] infile outfile\n");
         return EXIT_FAILURE;
     }
-    infile = argv[1];
-    outfile = argv[2];
+    infile = argv[1 + stats];
+    outfile = argv[2 + stats];
 
-    return FilterWav(infile, outfile, &f, WAVE_FLOAT, 0.0);
+    wave_stats st{};
+    wave_options opts{};
+    opts.stats = stats ? &st : nullptr;
+
+    int rv = FilterWav(infile, outfile, &f, WAVE_FLOAT, 0.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
 }
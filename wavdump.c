@@ -1,20 +1,323 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L
+#endif
 #include "wave.h"
+#include "thread.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <assert.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+/*
+ * wavdump - print the header of a wav file, or a line for each of many
+ *
+ *  wavdump wavfile
+ *  wavdump [--json] [-j threads] path...
+ *
+ * given more than one path, a directory or an option, every file named
+ * is scanned (with wave_scan_header()) along with every .wav file under
+ * the directories named (not following links to directories found on
+ * the way), and "-" reads more paths from stdin, one per line. The files
+ * are shared out between the threads a batch at a time and printed in
+ * the order they were found, one line each:
+ *
+ *  RIFF 1 2 44100 16 4 44 176400 path/to/file.wav
+ *
+ * the container, format, channels, sample rate, bits per sample, block
+ * align, offset of the data and bytes of data, or "error open" or "error
+ * parse" for a file that can't be read (diagnosed on stderr). --json
+ * prints a JSON object per line instead.
+ */
+
+/* files scanned between printing */
+#define WAVDUMP_BATCH 4096
+
+/* most threads scanning at once */
+#define WAVDUMP_MAX_THREADS 64
+
+struct entry {
+    char *name;
+    struct wave fmt;
+    long start;             /* from wave_scan_header() */
+};
+
+struct inventory {
+    struct entry e[WAVDUMP_BATCH];
+    size_t n;               /* files in e */
+    int threads;
+    int json;
+    size_t failed;
+};
+
+/* a thread scanning every stride'th file of a batch */
+struct scanner {
+    struct inventory *inv;
+    struct thread t;
+    int first;
+    int stride;
+};
+
+static void scan_files(void *arg)
+{
+    struct scanner *s = arg;
+    struct inventory *inv = s->inv;
+    size_t i;
+
+    for (i = s->first; i < inv->n; i += s->stride)
+        inv->e[i].start = wave_scan_header(&inv->e[i].fmt, inv->e[i].name);
+}
+
+/* a string as JSON */
+static void print_json_string(const char *s)
+{
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            printf("\\u%04x", (unsigned char)*s);
+        else
+            putchar(*s);
+    }
+    putchar('"');
+}
+
+static void print_entry(const struct inventory *inv, const struct entry *e)
+{
+    const struct wave *w = &e->fmt;
+    const char *error = e->start < 0 ? "open" : e->start == 0 ? "parse" : NULL;
+
+    /* (the data size as a double is exact up to 2^53 bytes) */
+    if (!inv->json && error) {
+        printf("error %s %s\n", error, e->name);
+    } else if (!inv->json) {
+        printf("%.4s %d %d %lu %d %d %ld %.0f %s\n", w->riff_tag, w->format,
+               w->channels, (unsigned long)w->samplerate, w->bitspersample,
+               w->blockalign, e->start, (double)w->data_size, e->name);
+    } else {
+        printf("{\"file\": ");
+        print_json_string(e->name);
+        if (error)
+            printf(", \"error\": \"%s\"}\n", error);
+        else
+            printf(", \"container\": \"%.4s\", \"format\": %d, "
+                   "\"channels\": %d, \"samplerate\": %lu, \"bits\": %d, "
+                   "\"blockalign\": %d, \"data_offset\": %ld, "
+                   "\"data_size\": %.0f}\n",
+                   w->riff_tag, w->format, w->channels,
+                   (unsigned long)w->samplerate, w->bitspersample,
+                   w->blockalign, e->start, (double)w->data_size);
+    }
+}
+
+/* scan the files of the batch on the threads, print and free them */
+static void flush_batch(struct inventory *inv)
+{
+    struct scanner s[WAVDUMP_MAX_THREADS];
+    int started[WAVDUMP_MAX_THREADS];
+    int t, T = inv->threads;
+    size_t i;
+
+    if ((size_t)T > inv->n)
+        T = inv->n > 0 ? (int)inv->n : 1;
+    for (t = 0; t < T; t++) {
+        s[t].inv = inv;
+        s[t].first = t;
+        s[t].stride = T;
+    }
+    for (t = 1; t < T; t++)
+        started[t] = thread_create(&s[t].t, scan_files, &s[t]) == 0;
+    scan_files(&s[0]);
+    for (t = 1; t < T; t++) {
+        if (started[t])
+            thread_join(&s[t].t);
+        else
+            scan_files(&s[t]);
+    }
+    for (i = 0; i < inv->n; i++) {
+        print_entry(inv, &inv->e[i]);
+        if (inv->e[i].start <= 0)
+            inv->failed++;
+        free(inv->e[i].name);
+    }
+    inv->n = 0;
+}
+
+static void add_file(struct inventory *inv, const char *name)
+{
+    char *copy = malloc(strlen(name) + 1);
+
+    if (!copy) {
+        fprintf(stderr, "%s: out of memory\n", name);
+        inv->failed++;
+        return;
+    }
+    strcpy(copy, name);
+    inv->e[inv->n++].name = copy;
+    if (inv->n == WAVDUMP_BATCH)
+        flush_batch(inv);
+}
+
+static int is_wav(const char *name)
+{
+    const size_t n = strlen(name);
+
+    return n > 4 && (strcmp(name + n - 4, ".wav") == 0
+                     || strcmp(name + n - 4, ".WAV") == 0);
+}
+
+static int is_directory(const char *path)
+{
+#ifdef _WIN32
+    const DWORD a = GetFileAttributesA(path);
+    return a != INVALID_FILE_ATTRIBUTES && (a & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+/* a symbolic link (or a junction): the walk doesn't follow those to
+   directories, so a link back up the tree can't loop or list a file twice */
+static int is_link(const char *path)
+{
+#ifdef _WIN32
+    const DWORD a = GetFileAttributesA(path);
+    return a != INVALID_FILE_ATTRIBUTES
+           && (a & FILE_ATTRIBUTE_REPARSE_POINT);
+#else
+    struct stat st;
+    return lstat(path, &st) == 0 && S_ISLNK(st.st_mode);
+#endif
+}
+
+static void add_directory(struct inventory *inv, const char *dir);
+
+/* an entry of directory dir: a directory to walk, or maybe a .wav file */
+static void add_entry(struct inventory *inv, const char *dir,
+                      const char *name)
+{
+    char *path;
+
+    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+        return;
+    path = malloc(strlen(dir) + strlen(name) + 2);
+    if (!path)
+        return;
+    sprintf(path, "%s/%s", dir, name);
+    if (is_directory(path)) {
+        if (!is_link(path))
+            add_directory(inv, path);
+    } else if (is_wav(name)) {
+        add_file(inv, path);
+    }
+    free(path);
+}
+
+/* every .wav file under dir */
+static void add_directory(struct inventory *inv, const char *dir)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA fd;
+    HANDLE h;
+    char *pattern = malloc(strlen(dir) + 3);
+
+    if (!pattern)
+        return;
+    sprintf(pattern, "%s/*", dir);
+    h = FindFirstFileA(pattern, &fd);
+    free(pattern);
+    if (h == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "%s: could not list directory\n", dir);
+        inv->failed++;
+        return;
+    }
+    do
+        add_entry(inv, dir, fd.cFileName);
+    while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    DIR *d = opendir(dir);
+    struct dirent *de;
+
+    if (!d) {
+        perror(dir);
+        inv->failed++;
+        return;
+    }
+    while ((de = readdir(d)) != NULL)
+        add_entry(inv, dir, de->d_name);
+    closedir(d);
+#endif
+}
+
+static void add_path(struct inventory *inv, const char *path)
+{
+    if (is_directory(path))
+        add_directory(inv, path);
+    else
+        add_file(inv, path);
+}
+
+/* paths from stdin, one per line */
+static void add_list(struct inventory *inv)
+{
+    char line[4096];
+    size_t n;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        n = strlen(line);
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r'))
+            line[--n] = '\0';
+        if (n > 0)
+            add_path(inv, line);
+    }
+}
+
+static int usage(void)
+{
+    fprintf(stderr, "Usage: wavdump wavfile\n");
+    fprintf(stderr, "       wavdump [--json] [-j threads] path...\n");
+    return EXIT_FAILURE;
+}
 
 int main(int argc, char *argv[])
 {
-    char *filename;
-    int rv;
+    static struct inventory inv;    /* (too big for the stack) */
+    int threads = 0, bulk = 0, arg = 1;
 
-    if (argc != 2) {
-        fprintf(stderr, "Usage: wavdump wavfile\n");
-        return EXIT_FAILURE;
+    for (; arg < argc && argv[arg][0] == '-' && argv[arg][1]; arg++) {
+        if (strcmp(argv[arg], "--json") == 0)
+            inv.json = 1;
+        else if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+            threads = atoi(argv[++arg]);
+        else
+            return usage();
+        bulk = 1;
     }
+    if (arg >= argc)
+        return usage();
+    if (!bulk && argc - arg == 1 && strcmp(argv[arg], "-") != 0
+        && !is_directory(argv[arg]))
+        return wave_dump(argv[arg]) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 
-    filename = argv[1];
-    rv = wave_dump(filename);
+    if (threads <= 0)
+        threads = thread_cpu_count();
+    if (threads > WAVDUMP_MAX_THREADS)
+        threads = WAVDUMP_MAX_THREADS;
+    inv.threads = threads;
+    for (; arg < argc; arg++) {
+        if (strcmp(argv[arg], "-") == 0)
+            add_list(&inv);
+        else
+            add_path(&inv, argv[arg]);
+    }
+    flush_batch(&inv);
 
-    return (rv == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    return inv.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -1,44 +1,190 @@
+#define _POSIX_C_SOURCE 200809L
+#define _FILE_OFFSET_BITS 64
+
 #include "wave.h"
+#include "mapfile.h"
+#include "convert.h"
+#include "thread.h"
+#include "resample.h"
+#include <float.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
-/* helper for wave_read_header */
-static long read_fmt(struct wave *fmt, const char *fn, FILE *fp)
+/* seek and tell with 64 bit offsets, where long may be 32 bits */
+#ifdef _WIN32
+#define wave_fseek _fseeki64
+#define wave_ftell _ftelli64
+#else
+#define wave_fseek fseeko
+#define wave_ftell ftello
+#endif
+
+/* helper for wave_read_header: skip n bytes by reading them, so that it
+   works on pipes as well as files */
+static long skip_bytes(FILE *fp, long n)
+{
+    char buf[256];
+    long skipped = 0;
+    size_t k;
+
+    while (skipped < n) {
+        k = n - skipped < (long)sizeof(buf) ? n - skipped : sizeof(buf);
+        k = fread(buf, 1, k, fp);
+        if (k == 0)
+            break;
+        skipped += k;
+    }
+    return skipped;
+}
+
+/* bytes wave_scan_header() reads at a time */
+#define WAVE_SCAN_WINDOW 4096
+
+/* where parse_header() reads from: a FILE (read straight through, for
+   pipes), or else a file descriptor read a window at a time with
+   pread(), so that skipping a chunk is only moving pos */
+struct header_source {
+    FILE *fp;
+    int fd;
+    uint64_t pos;           /* offset of the next byte to read from fd */
+    unsigned char *win;     /* WAVE_SCAN_WINDOW bytes of fd */
+    uint64_t base;          /* offset of win[0] */
+    size_t len;             /* bytes in win */
+    int eof;                /* a read came up short */
+};
+
+/* read len bytes at offset pos of fd, return the bytes read */
+static size_t read_at(int fd, void *buf, size_t len, uint64_t pos)
+{
+#ifdef _WIN32
+    int n;
+
+    if (_lseeki64(fd, (__int64)pos, SEEK_SET) < 0)
+        return 0;
+    n = _read(fd, buf, (unsigned)len);
+#else
+    ssize_t n;
+
+    do
+        n = pread(fd, buf, len, (off_t)pos);
+    while (n < 0 && errno == EINTR);
+#endif
+    return n > 0 ? (size_t)n : 0;
+}
+
+/* helper for parse_header: read n bytes, return the bytes read */
+static size_t src_read(struct header_source *src, void *buf, size_t n)
+{
+    size_t got = 0, k;
+
+    if (src->fp) {
+        got = fread(buf, 1, n, src->fp);
+        src->eof = feof(src->fp);
+        return got;
+    }
+    while (got < n) {
+        if (src->pos < src->base || src->pos >= src->base + src->len) {
+            src->base = src->pos;
+            src->len = read_at(src->fd, src->win, WAVE_SCAN_WINDOW, src->pos);
+            if (src->len == 0) {
+                src->eof = 1;
+                break;
+            }
+        }
+        k = src->base + src->len - src->pos;
+        if (k > n - got)
+            k = n - got;
+        memcpy((unsigned char *)buf + got, src->win + (src->pos - src->base),
+               k);
+        got += k;
+        src->pos += k;
+    }
+    return got;
+}
+
+/* helper for parse_header: skip n bytes (past the end of the file shows
+   up as a short read afterwards) */
+static long src_skip(struct header_source *src, long n)
+{
+    if (src->fp)
+        return skip_bytes(src->fp, n);
+    src->pos += n;
+    return n;
+}
+
+/* helper for wave_read_header: the fields of a chunk fmt of
+   fmt->fmt_size bytes (the chunk size has been read already) */
+static long read_fmt_body(struct wave *fmt, const char *fn,
+                          struct header_source *src)
 {
     long bytecount = 0;
 
-    bytecount += fread(&fmt->fmt_size, 4, 1, fp) * 4;
     if (fmt->fmt_size >= 16) {
-        bytecount += fread(&fmt->format, 2, 1, fp) * 2;
-        bytecount += fread(&fmt->channels, 2, 1, fp) * 2;
-        bytecount += fread(&fmt->samplerate, 4, 1, fp) * 4;
-        bytecount += fread(&fmt->byterate, 4, 1, fp) * 4;
-        bytecount += fread(&fmt->blockalign, 2, 1, fp) * 2;
-        bytecount += fread(&fmt->bitspersample, 2, 1, fp) * 2;
-    } else {
+        bytecount += src_read(src, &fmt->format, 2);
+        bytecount += src_read(src, &fmt->channels, 2);
+        bytecount += src_read(src, &fmt->samplerate, 4);
+        bytecount += src_read(src, &fmt->byterate, 4);
+        bytecount += src_read(src, &fmt->blockalign, 2);
+        bytecount += src_read(src, &fmt->bitspersample, 2);
+    }
+    if (fmt->fmt_size >= 40 && fmt->format == WAVE_EXTENSIBLE) {
+        /* the format is the start of the sub format GUID, after the
+           extra size, the valid bits and the channel mask */
+        bytecount += src_skip(src, 8);
+        bytecount += src_read(src, &fmt->format, 2);
+        bytecount += src_skip(src, 14);
+    } else if (fmt->fmt_size < 16) {
         fprintf(stderr,
                 "%s: expected length of chunk fmt >= 16 bytes, got %d\n",
                 fn, fmt->fmt_size);
     }
-    if (bytecount < fmt->fmt_size + 4) {
-        long skip = fmt->fmt_size + 4 - bytecount;
+    if (bytecount < fmt->fmt_size) {
+        long skip = fmt->fmt_size - bytecount;
         fprintf(stderr,
                 "%s: skipping extra %ld bytes at end of chunk fmt\n",
                 fn, skip);
-        fseek(fp, skip, SEEK_CUR);
-        bytecount += skip;
+        bytecount += src_skip(src, skip);
     }
 
     return bytecount;
 }
 
 /* helper for wave_read_header */
-static long read_data(struct wave *fmt, const char *fn, FILE *fp)
+static long read_fmt(struct wave *fmt, const char *fn,
+                     struct header_source *src)
+{
+    long bytecount = 0;
+
+    bytecount += src_read(src, &fmt->fmt_size, 4);
+    bytecount += read_fmt_body(fmt, fn, src);
+
+    return bytecount;
+}
+
+/* helper for wave_read_header */
+static long read_data(struct wave *fmt, const char *fn,
+                      struct header_source *src)
 {
     long bytecount = 0;
+    uint32_t size = 0;
 
-    bytecount += fread(&fmt->data_size, 4, 1, fp) * 4;
+    bytecount += src_read(src, &size, 4);
+    fmt->data_size = size;
 
     /* don't actually read the data.
        leave the file pointer right at the beginning of it
@@ -47,6 +193,90 @@ static long read_data(struct wave *fmt, const char *fn, FILE *fp)
     return bytecount;
 }
 
+/* helper for wave_read_header: the 64 bit sizes of an RF64 file, the
+   riff size into fmt and the data size into *data_size (the data chunk
+   itself says 0xFFFFFFFF) */
+static long read_ds64(struct wave *fmt, uint64_t *data_size,
+                      struct header_source *src)
+{
+    long bytecount = 0;
+    uint32_t size = 0;
+
+    bytecount += src_read(src, &size, 4);
+    if (size >= 16) {
+        bytecount += src_read(src, &fmt->riff_size, 8);
+        bytecount += src_read(src, data_size, 8);
+        size -= 16;
+    }
+    /* (the sample count and the table of other chunk sizes) */
+    bytecount += src_skip(src, size + (size & 1));
+
+    return bytecount;
+}
+
+/* the GUIDs of the chunks of a Wave64 file are the RIFF tag followed by
+   w64_tail, except for the one of the riff chunk */
+static const unsigned char w64_riff[12] = {
+    0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00
+};
+static const unsigned char w64_tail[12] = {
+    0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+
+/*
+ * read_w64() - helper for wave_read_header: the rest of a Wave64 header
+ * after its first 4 bytes (riff)
+ *
+ * each chunk is a 16 byte GUID, then a 64 bit size that counts those 24
+ * bytes, padded to a multiple of 8 bytes
+ *
+ * Return: offset of the start of wave data, 0 if it could not be parsed
+ */
+static long read_w64(struct wave *fmt, const char *fn,
+                     struct header_source *src)
+{
+    unsigned char guid[16];
+    uint64_t size;
+    long bytecount = 4;
+
+    bytecount += src_read(src, guid, 12);
+    bytecount += src_read(src, &size, 8);
+    fmt->riff_size = size - 8;
+    if (memcmp(guid, w64_riff, 12) != 0) {
+        fprintf(stderr, "%s: expected chunk riff of Wave64\n", fn);
+        return 0;
+    }
+    bytecount += src_read(src, guid, 16);
+    if (memcmp(guid, "wave", 4) != 0 || memcmp(guid + 4, w64_tail, 12) != 0) {
+        fprintf(stderr,
+                "%s: expected chunk wave, but got %.4s\n", fn, (char *)guid);
+        return 0;
+    }
+    memcpy(fmt->wave_tag, guid, 4);
+
+    while (src_read(src, guid, 16) == 16 && src_read(src, &size, 8) == 8) {
+        bytecount += 24;
+        size = size < 24 ? 0 : size - 24;
+        if (memcmp(guid + 4, w64_tail, 12) == 0
+            && memcmp(guid, "fmt ", 4) == 0) {
+            memcpy(fmt->fmt_tag, guid, 4);
+            fmt->fmt_size = (uint32_t)size;
+            bytecount += read_fmt_body(fmt, fn, src);
+        } else if (memcmp(guid + 4, w64_tail, 12) == 0
+                   && memcmp(guid, "data", 4) == 0) {
+            memcpy(fmt->data_tag, guid, 4);
+            fmt->data_size = size;
+            return bytecount;
+        } else {
+            fprintf(stderr, "%s: ignoring chunk %.4s\n", fn, (char *)guid);
+            bytecount += src_skip(src, (long)size);
+        }
+        bytecount += src_skip(src, (long)(-size & 7));
+    }
+    fprintf(stderr, "%s: no chunk data\n", fn);
+    return 0;
+}
+
 /*
  * wave_format_str() - string representation of wave format type
  * buf: buffer to store string into
@@ -67,6 +297,9 @@ char *wave_format_str(char *buf, int format)
     case WAVE_uLAW:
         sprintf(buf, "%d (8 bit mu-law)", format);
         break;
+    case WAVE_EXTENSIBLE:
+        sprintf(buf, "%d (extensible)", format);
+        break;
     default:
         sprintf(buf, "%d (unknown)", format);
     }
@@ -74,27 +307,40 @@ char *wave_format_str(char *buf, int format)
 }
 
 /*
- * wave_read_header() - read the wave RIFF header
+ * parse_header() - read the wave RIFF header from a source
  * fmt: pointer to the format header structure to fill
  * fn:  filename (for better error messages)
- * fp:  the file to read it from
+ * src: where to read it from
+ *
+ * RF64 (and BW64) files have their sizes taken from the ds64 chunk, and
+ * Wave64 ones are read the same way with their own chunk layout
  *
  * Return: offset of the start of wave data on a successful read of format
  *         0 otherwise
  */
-long wave_read_header(struct wave *fmt, const char *fn, FILE *fp)
+static long parse_header(struct wave *fmt, const char *fn,
+                         struct header_source *src)
 {
     long bytecount = 0;
+    uint32_t riff_size = 0;
+    uint64_t ds64_data = 0xFFFFFFFF;
+    int rf64;
 
-    bytecount += fread(fmt->riff_tag, 1, 4, fp);
-    if (strncmp(fmt->riff_tag, "RIFF", 4) != 0) {
+    bytecount += src_read(src, fmt->riff_tag, 4);
+    if (strncmp(fmt->riff_tag, "riff", 4) == 0)
+        return read_w64(fmt, fn, src);
+    /* (BW64 is RF64 by another name) */
+    rf64 = strncmp(fmt->riff_tag, "RF64", 4) == 0
+           || strncmp(fmt->riff_tag, "BW64", 4) == 0;
+    if (strncmp(fmt->riff_tag, "RIFF", 4) != 0 && !rf64) {
         fprintf(stderr,
                 "%s: expected chunk RIFF, but got %.4s\n",
                 fn, fmt->riff_tag);
         goto fail;
     }
-    bytecount += fread(&fmt->riff_size, 4, 1, fp) * 4;
-    bytecount += fread(fmt->wave_tag, 1, 4, fp);
+    bytecount += src_read(src, &riff_size, 4);
+    fmt->riff_size = riff_size;
+    bytecount += src_read(src, fmt->wave_tag, 4);
     if (strncmp(fmt->wave_tag, "WAVE", 4) != 0) {
         fprintf(stderr,
                 "%s: expected chunk WAVE, but got %.4s\n",
@@ -102,42 +348,185 @@ long wave_read_header(struct wave *fmt, const char *fn, FILE *fp)
         goto fail;
     }
 
-    while (!feof(fp)) {
+    while (!src->eof) {
         /* read chunk tag and the chunk */
         char chunktag[4];
-        bytecount += fread(chunktag, 1, 4, fp);
+        bytecount += src_read(src, chunktag, 4);
         if (strncmp(chunktag, "fmt ", 4) == 0) {
             strncpy(fmt->fmt_tag, chunktag, 4);
-            bytecount += read_fmt(fmt, fn, fp);
+            bytecount += read_fmt(fmt, fn, src);
+        } else if (rf64 && strncmp(chunktag, "ds64", 4) == 0) {
+            bytecount += read_ds64(fmt, &ds64_data, src);
         } else if (strncmp(chunktag, "data", 4) == 0) {
             strncpy(fmt->data_tag, chunktag, 4);
-            bytecount += read_data(fmt, fn, fp);
+            bytecount += read_data(fmt, fn, src);
+            if (rf64 && fmt->data_size == 0xFFFFFFFF)
+                fmt->data_size = ds64_data;
             goto success;
         } else {
             /* ignore chunk */
-            uint32_t chunksize;
-            fprintf(stderr, "%s: ignoring chunk %.4s\n", fn, chunktag);
-            bytecount += fread(&chunksize, 4, 1, fp) * 4;
-            fseek(fp, chunksize, SEEK_CUR);
-            bytecount += chunksize;
+            uint32_t chunksize = 0;
+            /* (JUNK is padding, e.g. room for a ds64 chunk) */
+            if (strncmp(chunktag, "JUNK", 4) != 0)
+                fprintf(stderr, "%s: ignoring chunk %.4s\n", fn, chunktag);
+            bytecount += src_read(src, &chunksize, 4);
+            /* (chunks are padded to an even length) */
+            bytecount += src_skip(src, chunksize + (chunksize & 1));
         }
     }
+    fprintf(stderr, "%s: no chunk data\n", fn);
 
-success:
-    return bytecount;   /* SUCCESS */
 fail:
     return 0;   /* FAILURE - could not parse header properly */
+success:
+    return bytecount;   /* SUCCESS */
+}
+
+/*
+ * wave_read_header() - read the wave RIFF header
+ * fmt: pointer to the format header structure to fill
+ * fn:  filename (for better error messages)
+ * fp:  the file to read it from, left at the start of the data
+ *
+ * Return: offset of the start of wave data on a successful read of format
+ *         0 otherwise
+ */
+long wave_read_header(struct wave *fmt, const char *fn, FILE *fp)
+{
+    struct header_source src;
+
+    memset(&src, 0, sizeof(src));
+    src.fp = fp;
+    return parse_header(fmt, fn, &src);
+}
+
+/*
+ * wave_scan_header() - read the wave RIFF header of a file with positioned
+ *                      reads
+ * fmt: pointer to the format header structure to fill
+ * filename: file to read it from
+ *
+ * the file is read WAVE_SCAN_WINDOW bytes at a time with pread(), at
+ * wherever the chunks lead (the chunks skipped over are never read), so
+ * most headers cost an open, one read and a close. The diagnostics are
+ * those of wave_read_header(), and it can run on many threads at once.
+ *
+ * Return: offset of the start of wave data on a successful read of format
+ *         0 if the header could not be parsed, -1 if the file could not
+ *         be opened
+ */
+long wave_scan_header(struct wave *fmt, const char *filename)
+{
+    unsigned char win[WAVE_SCAN_WINDOW];
+    struct header_source src;
+    long rv;
+
+    memset(&src, 0, sizeof(src));
+    src.win = win;
+#ifdef _WIN32
+    src.fd = _open(filename, _O_RDONLY | _O_BINARY);
+#else
+    src.fd = open(filename, O_RDONLY);
+#endif
+    if (src.fd < 0) {
+        perror(filename);
+        return -1;
+    }
+    rv = parse_header(fmt, filename, &src);
+#ifdef _WIN32
+    _close(src.fd);
+#else
+    close(src.fd);
+#endif
+    return rv;
+}
+
+/* the layouts of header write_header() can write: plain RIFF (44 bytes),
+   RF64 and RIFF with a JUNK chunk where the ds64 one would be (80 bytes,
+   so one can be rewritten as the other in place) */
+enum { HEADER_RIFF, HEADER_RF64, HEADER_JUNK };
+
+/* bytes of the body of a ds64 chunk without a table (and of the JUNK
+   chunk that reserves room for one) */
+#define WAVE_DS64_SIZE 28
+
+/* helper for wave_write_header, riff_size is as in a plain RIFF header */
+static long write_header(const struct wave *fmt, int layout, FILE *fp)
+{
+    static const char junk[WAVE_DS64_SIZE] = {0};
+    const uint32_t fmt_size = 16, ds64_size = WAVE_DS64_SIZE, table = 0;
+    uint64_t riff = fmt->riff_size, frames;
+    uint32_t riff32, data32;
+    long bytecount = 0;
+
+    if (layout != HEADER_RIFF && riff != 0xFFFFFFFF)
+        riff += 8 + WAVE_DS64_SIZE;
+    riff32 = layout == HEADER_RF64 ? 0xFFFFFFFF : (uint32_t)riff;
+    data32 = layout == HEADER_RF64 ? 0xFFFFFFFF : (uint32_t)fmt->data_size;
+    frames = fmt->blockalign ? fmt->data_size / fmt->blockalign : 0;
+
+    bytecount += fwrite(layout == HEADER_RF64 ? "RF64" : "RIFF", 1, 4, fp);
+    bytecount += fwrite(&riff32, 4, 1, fp) * 4;
+    bytecount += fwrite("WAVE", 1, 4, fp);
+    if (layout == HEADER_RF64) {
+        bytecount += fwrite("ds64", 1, 4, fp);
+        bytecount += fwrite(&ds64_size, 4, 1, fp) * 4;
+        bytecount += fwrite(&riff, 8, 1, fp) * 8;
+        bytecount += fwrite(&fmt->data_size, 8, 1, fp) * 8;
+        bytecount += fwrite(&frames, 8, 1, fp) * 8;
+        bytecount += fwrite(&table, 4, 1, fp) * 4;
+    } else if (layout == HEADER_JUNK) {
+        bytecount += fwrite("JUNK", 1, 4, fp);
+        bytecount += fwrite(&ds64_size, 4, 1, fp) * 4;
+        bytecount += fwrite(junk, 1, sizeof(junk), fp);
+    }
+    bytecount += fwrite("fmt ", 1, 4, fp);
+    bytecount += fwrite(&fmt_size, 4, 1, fp) * 4;
+    bytecount += fwrite(&fmt->format, 2, 1, fp) * 2;
+    bytecount += fwrite(&fmt->channels, 2, 1, fp) * 2;
+    bytecount += fwrite(&fmt->samplerate, 4, 1, fp) * 4;
+    bytecount += fwrite(&fmt->byterate, 4, 1, fp) * 4;
+    bytecount += fwrite(&fmt->blockalign, 2, 1, fp) * 2;
+    bytecount += fwrite(&fmt->bitspersample, 2, 1, fp) * 2;
+    bytecount += fwrite("data", 1, 4, fp);
+    bytecount += fwrite(&data32, 4, 1, fp) * 4;
+
+    return bytecount;
 }
 
 /*
  * wave_write_header() - write wave RIFF header to file
  * fmt: pointer to the format header struct to write
  *
+ * riff_size and data_size of 0xFFFFFFFF are an unknown length (a
+ * stream). The header is RF64 if riff_tag is "RF64" or the sizes are
+ * too big for a RIFF header: 4 GiB or more.
+ *
  * Return: bytes written to file
  */
 long wave_write_header(const struct wave *fmt, FILE *fp)
 {
-    return fwrite(fmt, sizeof(*fmt), 1, fp);
+    const int rf64 = strncmp(fmt->riff_tag, "RF64", 4) == 0
+                     || fmt->riff_size > 0xFFFFFFFF
+                     || fmt->data_size > 0xFFFFFFFF;
+
+    return write_header(fmt, rf64 ? HEADER_RF64 : HEADER_RIFF, fp);
+}
+
+/* decimal string of a 64 bit size (there is no printf format for one) */
+static char *size_str(char *buf, uint64_t v)
+{
+    char tmp[24];
+    int n = 0, i;
+
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    for (i = 0; i < n; i++)
+        buf[i] = tmp[n - 1 - i];
+    buf[n] = '\0';
+    return buf;
 }
 
 /*
@@ -156,14 +545,43 @@ void wave_print_header(const struct wave *fmt)
 {
     char buf[64];
 
-    printf("file length: %u\n", fmt->riff_size + 8);
+    printf("file length: %s", size_str(buf, fmt->riff_size + 8));
+    if (strncmp(fmt->riff_tag, "riff", 4) == 0)
+        printf(" (Wave64)");
+    else if (strncmp(fmt->riff_tag, "RIFF", 4) != 0)
+        printf(" (%.4s)", fmt->riff_tag);
+    printf("\n");
     printf("format: %s\n", wave_format_str(buf, fmt->format));
     printf("channels: %d\n", fmt->channels);
     printf("sample rate: %d\n", fmt->samplerate);
     printf("byte rate: %d\n", fmt->byterate);
     printf("block align: %d\n", fmt->blockalign);
     printf("bits per sample: %d\n", fmt->bitspersample);
-    printf("data length (bytes): %d\n", fmt->data_size);
+    printf("data length (bytes): %s\n", size_str(buf, fmt->data_size));
+}
+
+/*
+ * wave_print_stats() - print the statistics of a wave_filter_ex() run
+ * s: statistics filled in through wave_options.stats
+ * fp: where to print them (stderr, when the output is going to stdout)
+ */
+void wave_print_stats(const struct wave_stats *s, FILE *fp)
+{
+    fprintf(fp, "parse: %.6f s\n", s->parse);
+    fprintf(fp, "read: %.6f s\n", s->read);
+    fprintf(fp, "filter: %.6f s\n", s->filter);
+    fprintf(fp, "write: %.6f s\n", s->write);
+    fprintf(fp, "total: %.6f s\n", s->total);
+    fprintf(fp, "frames: %lu\n", (unsigned long)s->frames);
+    fprintf(fp, "samples: %lu (%.0f per second)\n",
+            (unsigned long)s->samples, s->rate);
+    fprintf(fp, "peak: %.6f\n", s->peak);
+    fprintf(fp, "clipped: %lu\n", (unsigned long)s->clipped);
+    fprintf(fp, "denormals: %lu\n", (unsigned long)s->denormals);
+    fprintf(fp, "nans: %lu\n", (unsigned long)s->nans);
+    fprintf(fp, "silent tail: %lu frames\n", (unsigned long)s->silent);
+    if (s->gain > 0.0)
+        fprintf(fp, "normalized: %+.2f dB\n", 20.0 * log10(s->gain));
 }
 
 /*
@@ -178,21 +596,16 @@ void wave_print_header(const struct wave *fmt)
  */
 int wave_dump(const char *filename)
 {
-    FILE *fp;
     struct wave fmt;
     long data_seek_start;
 
-    fp = fopen(filename, "rb");
-    if (!fp) {
-        perror(filename);
+    data_seek_start = wave_scan_header(&fmt, filename);
+    if (data_seek_start < 0)
         return -2;
-    }
-    data_seek_start = wave_read_header(&fmt, filename, fp);
     if (!data_seek_start) {
-        /* wave_read_header has already displayed a helpful error message */
+        /* wave_scan_header has already displayed a helpful error message */
         return -3;
     }
-    fclose(fp);
 
     wave_print_header(&fmt);
     printf("data seek start: 0x%08lx\n", data_seek_start);
@@ -200,186 +613,1759 @@ int wave_dump(const char *filename)
     return 0;
 }
 
-static double clamp(double d, double min, double max) {
-    const double t = d < min ? min : d;
-    return t > max ? max : t;
+/* number of frames sent to the filter per block */
+#define WAVE_BLOCK_SIZE 1024
+
+/* frames per block when the channels are filtered on separate threads */
+#define WAVE_THREAD_BLOCK_SIZE 65536
+
+/* most threads used to filter the channels of one file */
+#define WAVE_MAX_THREADS 64
+
+/* blocks filter_async() reads ahead of the filter, and writes behind */
+#define WAVE_IO_BUFFERS 4
+
+/* names filter_normalized() tries for its temporary file */
+#define WAVE_TEMP_TRIES 1000
+
+/* frames wave_load() reads before it has to grow its buffer */
+#define WAVE_LOAD_FRAMES 65536
+
+/* shortest segment of an FIR filtered file given its own thread */
+#define WAVE_MIN_SEGMENT 65536
+
+/* input fed to the filter after the end of the file when the cpu can't
+   flush denormals to zero: keeps decaying feedback out of the subnormal
+   range (about -600 dB, so it quantizes to silence) */
+#define WAVE_DENORMAL_PAD 1e-30
+
+/* wall clock in seconds for struct wave_stats */
+static double wave_clock(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER f, t;
+
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&t);
+    return (double)t.QuadPart / (double)f.QuadPart;
+#else
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+#endif
+}
+
+/* helpers for the wave_filter_ex() conversion loops */
+static void decode_pcm16(const void *raw, double *x, size_t n)
+{
+    convert_pcm16_to_double(raw, x, n);
 }
 
-static void filter_pcm2float(FILE *fpi, FILE *fpo,
-                             filter_func f, void *state,
-                             uint32_t Nin, uint32_t Nout)
+static void decode_float(const void *raw, double *x, size_t n)
 {
-    float x, y;
-    int16_t samp16;
-    uint32_t n = 0;
+    convert_float_to_double(raw, x, n);
+}
 
-    while (n < Nin) {
-        n += fread(&samp16, 2, 1, fpi);
-        x = samp16 / 32767.0;
-        y = clamp(f(state, x), -1.0, 1.0);
-        fwrite(&y, 4, 1, fpo);
-    }
-    while (n < Nout) {
-        n++;
-        x = 0.0;
-        y = clamp(f(state, x), -1.0, 1.0);
-        fwrite(&y, 4, 1, fpo);
-    }
+static void decode_pcm8(const void *raw, double *x, size_t n)
+{
+    convert_pcm8_to_double(raw, x, n);
 }
 
-static void filter_pcm2pcm(FILE *fpi, FILE *fpo,
-                           filter_func f, void *state,
-                           uint32_t Nin, uint32_t Nout)
+static void decode_pcm24(const void *raw, double *x, size_t n)
 {
-    float x, y;
-    int16_t samp16;
-    uint32_t n = 0;
+    convert_pcm24_to_double(raw, x, n);
+}
 
-    while (n < Nin) {
-        n += fread(&samp16, 2, 1, fpi);
-        x = samp16 / 32767.0;
-        y = clamp(f(state, x), -1.0, 1.0);
-        samp16 = (int)(32768.5 + 32767.0 * y) - 32768;
-        fwrite(&samp16, 2, 1, fpo);
-    }
-    while (n < Nout) {
-        n++;
-        x = 0.0;
-        y = clamp(f(state, x), -1.0, 1.0);
-        samp16 = (int)(32768.5 + 32767.0 * y) - 32768;
-        fwrite(&samp16, 2, 1, fpo);
+static void decode_alaw(const void *raw, double *x, size_t n)
+{
+    convert_alaw_to_double(raw, x, n);
+}
+
+static void decode_ulaw(const void *raw, double *x, size_t n)
+{
+    convert_ulaw_to_double(raw, x, n);
+}
+
+static void encode_pcm16(const double *y, void *raw, size_t n)
+{
+    convert_double_to_pcm16(y, raw, n);
+}
+
+static void encode_float(const double *y, void *raw, size_t n)
+{
+    convert_double_to_float(y, raw, n);
+}
+
+/* (the first pass of a normalized run keeps levels over full scale) */
+static void encode_float_unclipped(const double *y, void *raw, size_t n)
+{
+    float *dst = raw;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        dst[i] = (float)y[i];
+}
+
+typedef void (*decode_func)(const void *raw, double *x, size_t n);
+typedef void (*encode_func)(const double *y, void *raw, size_t n);
+
+/* the decoder for the samples of a file, NULL if it has none: 8, 16 and
+   24 bit PCM, 32 bit float and 8 bit A-law and mu-law (packed samples) */
+static decode_func wave_decoder(const struct wave *fmt)
+{
+    if (fmt->blockalign != fmt->channels * (fmt->bitspersample / 8))
+        return NULL;
+    switch (fmt->format) {
+    case WAVE_PCM:
+        return fmt->bitspersample == 8 ? decode_pcm8
+               : fmt->bitspersample == 16 ? decode_pcm16
+               : fmt->bitspersample == 24 ? decode_pcm24 : NULL;
+    case WAVE_FLOAT:
+        return fmt->bitspersample == 32 ? decode_float : NULL;
+    case WAVE_ALAW:
+        return fmt->bitspersample == 8 ? decode_alaw : NULL;
+    case WAVE_uLAW:
+        return fmt->bitspersample == 8 ? decode_ulaw : NULL;
     }
+    return NULL;
 }
 
+struct engine;
+
+/* a thread filtering every e->threads'th channel of a block, started by
+   engine_alloc() and kept until engine_free() */
+struct channel_worker {
+    struct engine *e;
+    struct thread t;
+    struct thread_sem go;   /* posted with each block, and to stop */
+    int first;              /* first channel for this worker */
+    size_t m;               /* frames in the current block */
+};
 
-static void filter_float2float(FILE *fpi, FILE *fpo,
-                               filter_func f, void *state,
-                               uint32_t Nin, uint32_t Nout)
+/* state shared by the conversion loops of wave_filter_ex() */
+struct engine {
+    decode_func decode;
+    int in_size;            /* bytes per input sample */
+    encode_func encode;
+    int out_size;           /* bytes per output sample */
+    int channels;
+    int interleaved;        /* f takes interleaved frames */
+    block_filter_func f;
+    block_filter_q15_func q15;  /* run instead of f on 16 bit PCM (Q15) */
+    void **state;           /* filter state for each channel */
+    int threads;            /* number of workers the channels are split over */
+    size_t block;           /* frames per block */
+    double *x;              /* interleaved samples (block * channels) */
+    double *p;              /* planar samples (block * channels) */
+    int16_t *q;             /* planar Q15 samples for q15 (block * channels) */
+    unsigned char *raw;     /* file samples for the stdio loop */
+    struct channel_worker *workers;
+    int running;            /* workers 1 up to running have threads */
+    int stop;               /* for the worker threads to exit */
+    struct thread_sem done; /* posted by a worker as it finishes a block */
+    int flush;              /* flush denormals to zero on worker threads */
+    double pad;             /* input after the end of the file */
+    double silence;         /* level the tail has to stay below, 0 for off */
+    size_t hold;            /* frames it has to stay below silence */
+    size_t quiet;           /* frames it has been below silence so far */
+    uint64_t preroll;       /* output frames thrown away before a region
+                               and for the latency of the filter */
+    size_t latency;         /* frames the filter delays its output by */
+    size_t tail;            /* frames it rings on for after the input */
+    int timed;              /* collect statistics in st */
+    double lap;             /* wave_clock() at the end of the last phase */
+    struct wave_stats st;
+    struct resampler *rs;   /* converts the input to the output rate */
+    double *rsx;            /* a block of input for rs */
+    size_t rs_left;         /* input frames left in the data chunk */
+    size_t rs_in;           /* input frames queued in rs */
+    size_t rs_out;          /* frames taken out of rs */
+    int rs_end;             /* the end of the input has been queued */
+};
+
+/* with statistics on, add the time since the last lap to phase */
+static void lap(struct engine *e, double *phase)
+{
+    double now;
+
+    if (!e->timed)
+        return;
+    now = wave_clock();
+    *phase += now - e->lap;
+    e->lap = now;
+}
+
+/* with statistics on, count the peak, clipped, denormal and NaN samples
+   of n filtered samples about to be encoded */
+static void scan_output(struct engine *e, const double *y, size_t n)
 {
-    float x, y;
-    uint32_t n = 0;
+    struct wave_stats *s = &e->st;
+    size_t i;
+    double a;
 
-    while (n < Nin) {
-        n += fread(&x, 4, 1, fpi);
-        y = clamp(f(state, x), -1.0, 1.0);
-        fwrite(&y, 4, 1, fpo);
+    if (!e->timed)
+        return;
+    for (i = 0; i < n; i++) {
+        a = y[i] < 0.0 ? -y[i] : y[i];
+        if (y[i] != y[i]) {
+            s->nans++;
+            continue;
+        }
+        if (a > s->peak)
+            s->peak = a;
+        if (a > 1.0)
+            s->clipped++;
+        else if (a < DBL_MIN && a != 0.0)
+            s->denormals++;
     }
-    while (n < Nout) {
-        n++;
-        x = 0.0;
-        y = clamp(f(state, x), -1.0, 1.0);
-        fwrite(&y, 4, 1, fpo);
+}
+
+/* feed the filter e->pad for frames k up to m of the block in e->x */
+static void pad_frames(struct engine *e, size_t k, size_t m)
+{
+    const int C = e->channels;
+    size_t i;
+
+    if (e->pad == 0.0) {
+        memset(e->x + k * C, 0, (m - k) * C * sizeof(double));
+        return;
     }
+    for (i = k * C; i < m * C; i++)
+        e->x[i] = e->pad;
 }
 
-static void filter_float2pcm(FILE *fpi, FILE *fpo,
-                             filter_func f, void *state,
-                             uint32_t Nin, uint32_t Nout)
+/* after filtering frames k (the first after the end of the input) up to
+   m of the block in e->x, count how long the output has been silent */
+static void track_silence(struct engine *e, size_t k, size_t m)
 {
-    float x, y;
-    int16_t samp16;
-    uint32_t n = 0;
+    const int C = e->channels;
+    size_t i;
+    int c;
 
-    while (n < Nin) {
-        n += fread(&x, 4, 1, fpi);
-        y = clamp(f(state, x), -1.0, 1.0);
-        samp16 = (int)(32768.5 + 32767.0 * y) - 32768;
-        fwrite(&samp16, 2, 1, fpo);
+    if (e->silence <= 0.0 || k >= m)
+        return;
+    for (i = k; i < m; i++) {
+        for (c = 0; c < C; c++)
+            if (!(e->x[i * C + c] < e->silence
+                  && e->x[i * C + c] > -e->silence))
+                break;
+        e->quiet = c < C ? 0 : e->quiet + 1;
     }
+}
+
+/* frames in the block starting at frame n: e->block, or fewer to stop at
+   frame N or at the end of the pre-roll */
+static size_t block_frames(const struct engine *e, uint64_t n, uint64_t N)
+{
+    const uint64_t end = n < e->preroll && e->preroll < N ? e->preroll : N;
+
+    return end - n < e->block ? (size_t)(end - n) : e->block;
+}
+
+/* the rest of the tail is silence: no more input and a quiet output */
+static int tail_silent(const struct engine *e)
+{
+    return e->silence > 0.0 && e->quiet >= e->hold;
+}
+
+/* write frames n up to Nout as silence (all zero bits in both formats)
+   with buf, a buffer of e->block frames */
+static void write_silence(struct engine *e, FILE *fp, void *buf,
+                          uint64_t n, uint64_t Nout)
+{
+    const size_t size = e->out_size * e->channels;
+    size_t m;
+
+    memset(buf, 0, e->block * size);
+    e->st.silent += Nout - n;
     while (n < Nout) {
-        n++;
-        x = 0.0;
-        y = clamp(f(state, x), -1.0, 1.0);
-        samp16 = (int)(32768.5 + 32767.0 * y) - 32768;
-        fwrite(&samp16, 2, 1, fpo);
+        m = Nout - n < e->block ? Nout - n : e->block;
+        fwrite(buf, size, m, fp);
+        n += m;
     }
+    lap(e, &e->st.write);
+}
+
+/* add the statistics of another engine (a segment worker) to s */
+static void stats_add(struct wave_stats *s, const struct wave_stats *t)
+{
+    s->read += t->read;
+    s->filter += t->filter;
+    s->write += t->write;
+    if (t->peak > s->peak)
+        s->peak = t->peak;
+    s->clipped += t->clipped;
+    s->denormals += t->denormals;
+    s->nans += t->nans;
+    s->silent += t->silent;
 }
 
+static void channel_thread(void *arg);
+
 /*
- * wave_filter() - sample by sample filter
- * infile: filename of input wav file
- * outfile: filename of output wav file
- * f: callback function for sample by sample processing
- * state: state to pass to sample processing function
- * format: WAVE_FLOAT or WAVE_PCM
- * t: length of time to run filter
- *
- * signal process infile to outfile (float)
- * t = 0.0 will make the output the same length as the input
+ * engine_alloc() - allocate the buffers of an engine and start its workers
+ * the workers wait for run_workers() to hand them blocks; workers whose
+ * thread didn't start have their channels filtered by the caller
  *
- * Return: 0 on success
- *         1 could not open file
- *         2 could not parse file
- *         4 unsupported file format
+ * Return: 0, or -1 out of memory (engine_free() cleans up either way)
  */
-int wave_filter(const char *infile, const char *outfile,
-                filter_func f, void *state, int format, double t)
+static int engine_alloc(struct engine *e)
 {
-    FILE *fpi, *fpo;        /* file pointers */
-    struct wave in, out;    /* wave file headers */
-    unsigned int Nin, Nout; /* number of samples for in and out */
-    char cbuf[64];          /* character buffer for string formatting */
+    const size_t n = e->block * e->channels;
+    const int size = e->in_size > e->out_size ? e->in_size : e->out_size;
+    int t;
 
-    fpi = fopen(infile, "rb");
-    if (!fpi) {
-        perror(infile);
-        return 1;
+    e->running = 0;
+    e->stop = 0;
+    e->x = malloc(n * sizeof(double));
+    e->p = e->channels > 1 ? malloc(n * sizeof(double)) : NULL;
+    e->q = e->q15 ? malloc(n * sizeof(int16_t)) : NULL;
+    e->raw = malloc(n * size);
+    e->workers = malloc(e->threads * sizeof(struct channel_worker));
+    if (!e->x || (e->channels > 1 && !e->p) || (e->q15 && !e->q) || !e->raw
+        || !e->workers)
+        return -1;
+    for (t = 0; t < e->threads; t++) {
+        e->workers[t].e = e;
+        e->workers[t].first = t;
     }
-    fpo = fopen(outfile, "wb");
-    if (!fpo) {
-        perror(outfile);
-        return 1;
-    }
-    if (!wave_read_header(&in, infile, fpi)) {
-        return 2;
+    if (e->threads < 2 || thread_sem_init(&e->done, 0) != 0)
+        return 0;
+    for (t = 1; t < e->threads; t++) {
+        if (thread_sem_init(&e->workers[t].go, 0) != 0)
+            break;
+        if (thread_create(&e->workers[t].t, channel_thread,
+                          &e->workers[t]) != 0) {
+            thread_sem_destroy(&e->workers[t].go);
+            break;
+        }
+        e->running = t;
     }
-    if (in.channels != 1) {
-        fprintf(stderr, "%s: number of channels must be 1\n", infile);
-        return 4;
+    if (e->running == 0)
+        thread_sem_destroy(&e->done);
+    return 0;
+}
+
+static void engine_free(struct engine *e)
+{
+    int t;
+
+    e->stop = 1;
+    for (t = 1; t <= e->running; t++)
+        thread_sem_post(&e->workers[t].go);
+    for (t = 1; t <= e->running; t++) {
+        thread_join(&e->workers[t].t);
+        thread_sem_destroy(&e->workers[t].go);
     }
-    if (format != WAVE_PCM && format != WAVE_FLOAT) {
-        fprintf(stderr, "unsupported output format %s\n",
-                wave_format_str(cbuf, format));
-        return 4;
+    if (e->running > 0)
+        thread_sem_destroy(&e->done);
+    e->running = 0;
+    free(e->workers);
+    free(e->raw);
+    free(e->q);
+    free(e->p);
+    free(e->x);
+}
+
+/* filter the channels of worker w over the current block */
+static void filter_channels(struct channel_worker *w)
+{
+    struct engine *e = w->e;
+    double *p;
+    int16_t *q;
+    int c;
+
+    for (c = w->first; c < e->channels; c += e->threads) {
+        if (e->q15) {
+            q = e->q + c * e->block;
+            e->q15(e->state[c], q, q, w->m);
+            continue;
+        }
+        p = e->p + c * e->block;
+        e->f(e->state[c], p, p, w->m);
     }
+}
 
-    out = in;
-    Nin = in.data_size / in.blockalign;
-    Nout = (t == 0.0) ? Nin : out.samplerate * t;
-    out.format = format;
-    out.fmt_size = 16;
-    out.bitspersample = (format == WAVE_FLOAT) ? 32 : 16;
-    out.blockalign = (format == WAVE_FLOAT) ? 4 : 2;
-    out.byterate = out.blockalign * out.samplerate;
-    out.data_size = Nout * out.blockalign;
-    out.riff_size = out.data_size + 16 + 8 + 8 + 4;
-    wave_write_header(&out, fpo);
-
-    if (in.format == WAVE_PCM && in.bitspersample == 16) {
-        if (out.format == WAVE_FLOAT)
-            filter_pcm2float(fpi, fpo, f, state, Nin, Nout);
-        else if (out.format == WAVE_PCM)
-            filter_pcm2pcm(fpi, fpo, f, state, Nin, Nout);
-        else
-            goto fail;
-    } else if (in.format == WAVE_FLOAT && in.bitspersample == 32) {
-        if (out.format == WAVE_FLOAT)
-            filter_float2float(fpi, fpo, f, state, Nin, Nout);
-        else if (out.format == WAVE_PCM)
-            filter_float2pcm(fpi, fpo, f, state, Nin, Nout);
-        else
-            goto fail;
-    } else {
-        goto fail;
+/* a worker thread: filter each block handed over until the engine stops */
+static void channel_thread(void *arg)
+{
+    struct channel_worker *w = arg;
+    struct engine *e = w->e;
+
+    if (e->flush)
+        convert_denormals_flush();  /* (a thread's own mode) */
+    for (;;) {
+        thread_sem_wait(&w->go);
+        if (e->stop)
+            break;
+        filter_channels(w);
+        thread_sem_post(&e->done);
     }
+}
 
-    fclose(fpi);
-    fclose(fpo);
-    return 0;
+/* run the channel workers over m frames of the planar block, the caller
+   taking the first worker's channels and those of any without a thread */
+static void run_workers(struct engine *e, size_t m)
+{
+    int t;
 
-fail:
+    for (t = 0; t < e->threads; t++)
+        e->workers[t].m = m;
+    for (t = 1; t <= e->running; t++)
+        thread_sem_post(&e->workers[t].go);
+    filter_channels(&e->workers[0]);
+    for (t = e->running + 1; t < e->threads; t++)
+        filter_channels(&e->workers[t]);
+    for (t = 1; t <= e->running; t++)
+        thread_sem_wait(&e->done);
+}
+
+/*
+ * filter_frames() - filter m frames of interleaved samples in place in e->x
+ * multichannel frames are split into one planar block per channel and
+ * the channels are shared out between e->threads threads
+ */
+static void filter_frames(struct engine *e, size_t m)
+{
+    const int C = e->channels;
+    size_t i;
+    int c;
+
+    if (C == 1 || e->interleaved) {
+        e->f(e->state[0], e->x, e->x, m);
+        return;
+    }
+
+    for (i = 0; i < m; i++)
+        for (c = 0; c < C; c++)
+            e->p[c * e->block + i] = e->x[i * C + c];
+    run_workers(e, m);
+    for (i = 0; i < m; i++)
+        for (c = 0; c < C; c++)
+            e->x[i * C + c] = e->p[c * e->block + i];
+}
+
+/*
+ * filter_frames_q15() - filter a block of 16 bit PCM frames with e->q15
+ * src: k frames of input samples from the file (may be dst)
+ * dst: room for m frames of output samples, NULL to throw them away
+ * frames k up to m are after the end of the input and are fed zeros;
+ * the output is tracked for silence and scanned as filter_raw() does
+ * (a full scale sample counts as clipped)
+ */
+static void filter_frames_q15(struct engine *e, const int16_t *src,
+                              int16_t *dst, size_t k, size_t m)
+{
+    const int C = e->channels;
+    const double quiet = e->silence * 32767.0;
+    struct wave_stats *s = &e->st;
+    int16_t *y;
+    size_t i;
+    int c, a;
+
+    if (C == 1 || e->interleaved) {
+        y = dst ? dst : e->q;
+        if (y != src)
+            memcpy(y, src, k * C * sizeof(int16_t));
+        memset(y + k * C, 0, (m - k) * C * sizeof(int16_t));
+        lap(e, &e->st.read);
+        e->q15(e->state[0], y, y, m);
+        lap(e, &e->st.filter);
+    } else {
+        for (i = 0; i < k; i++)
+            for (c = 0; c < C; c++)
+                e->q[c * e->block + i] = src[i * C + c];
+        for (c = 0; c < C; c++)
+            memset(e->q + c * e->block + k, 0, (m - k) * sizeof(int16_t));
+        lap(e, &e->st.read);
+        run_workers(e, m);
+        lap(e, &e->st.filter);
+        if (!dst)
+            return;
+        for (i = 0; i < m; i++)
+            for (c = 0; c < C; c++)
+                dst[i * C + c] = e->q[c * e->block + i];
+        y = dst;
+    }
+    if (!dst)
+        return;
+
+    if (e->silence > 0.0) {
+        for (i = k; i < m; i++) {
+            for (c = 0; c < C; c++)
+                if (!(y[i * C + c] < quiet && y[i * C + c] > -quiet))
+                    break;
+            e->quiet = c < C ? 0 : e->quiet + 1;
+        }
+    }
+    if (e->timed) {
+        for (i = 0; i < m * C; i++) {
+            a = y[i] < 0 ? -y[i] : y[i];
+            if (a / 32767.0 > s->peak)
+                s->peak = a / 32767.0;
+            if (a >= 32767)
+                s->clipped++;
+        }
+    }
+}
+
+/*
+ * filter_raw() - filter a block from the format of the input file to the
+ *                format of the output file
+ * src: k frames of input samples as read, NULL if read_frames() has
+ *      already decoded them into e->x
+ * dst: room for m frames of output samples, NULL to throw them away
+ * frames k up to m are after the end of the input
+ */
+static void filter_raw(struct engine *e, const void *src, void *dst,
+                       size_t k, size_t m)
+{
+    const int C = e->channels;
+
+    if (e->q15) {
+        filter_frames_q15(e, src, dst, k, m);
+        return;
+    }
+    if (src)
+        e->decode(src, e->x, k * C);
+    pad_frames(e, k, m);
+    lap(e, &e->st.read);
+    filter_frames(e, m);
+    lap(e, &e->st.filter);
+    track_silence(e, k, m);
+    if (dst) {
+        scan_output(e, e->x, m * C);
+        e->encode(e->x, dst, m * C);
+    }
+}
+
+/*
+ * read_frames() - read k frames of input into e->raw
+ * with e->rs, the frames are decoded into e->x instead, at the output
+ * rate: input is read a block at a time into the resampler until k
+ * frames come out of it, and at the end of the input it is given the
+ * silence it needs for its last frames
+ *
+ * Return: frames read, fewer than k at the end of the input
+ */
+static size_t read_frames(struct engine *e, FILE *fp, size_t k)
+{
+    const int C = e->channels;
+    size_t got = 0, want, r, valid;
+
+    if (!e->rs)
+        return fread(e->raw, e->in_size * C, k, fp);
+    for (;;) {
+        got += resample_read(e->rs, e->x + got * C, k - got);
+        if (got == k || e->rs_end)
+            break;
+        want = e->rs_left < e->block ? e->rs_left : e->block;
+        r = want ? fread(e->raw, e->in_size * C, want, fp) : 0;
+        e->decode(e->raw, e->rsx, r * C);
+        e->rs_left -= r;
+        if (resample_write(e->rs, e->rsx, r) != 0)
+            r = 0;      /* (out of memory: end the input here) */
+        e->rs_in += r;
+        if (r < want || want == 0) {
+            e->rs_end = 1;
+            resample_write(e->rs, NULL, e->rs->K);
+        }
+    }
+    if (e->rs_end) {
+        valid = resample_length(e->rs, e->rs_in) - e->rs_out;
+        if (got > valid)
+            got = valid;
+    }
+    e->rs_out += got;
+    return got;
+}
+
+/*
+ * filter_blocks() - read, filter and write the data chunk a block at a time
+ * Nin frames are read from fpi, after which zeros are fed to the filter
+ * until Nout frames have been filtered, and written to fpo after the
+ * first e->preroll
+ * with follow, the output ends where the input does (unknown length)
+ *
+ * Return: number of frames filtered (written and pre-roll)
+ */
+static uint64_t filter_blocks(struct engine *e, FILE *fpi, FILE *fpo,
+                              uint64_t Nin, uint64_t Nout, int follow)
+{
+    const int C = e->channels;
+    uint64_t n = 0;
+    size_t m, k;
+
+    while (n < Nout) {
+        m = block_frames(e, n, Nout);
+        k = 0;
+        if (n < Nin) {
+            k = Nin - n < m ? Nin - n : m;
+            k = read_frames(e, fpi, k);
+            if (k < m && n + k < Nin) {
+                Nin = n + k;    /* input is shorter than its header says */
+                if (follow) {
+                    Nout = Nin + e->latency + e->tail;
+                    m = Nout - n < m ? (size_t)(Nout - n) : m;
+                }
+            }
+        }
+        if (m == 0)
+            break;
+        if (k == 0 && tail_silent(e)) {
+            write_silence(e, fpo, e->raw, n, Nout);
+            return Nout;
+        }
+        if (n < e->preroll) {
+            filter_raw(e, e->rs ? NULL : e->raw, NULL, k, m);
+        } else {
+            filter_raw(e, e->rs ? NULL : e->raw, e->raw, k, m);
+            fwrite(e->raw, e->out_size * C, m, fpo);
+            lap(e, &e->st.write);
+        }
+        n += m;
+    }
+    return n;
+}
+
+/* a buffer of frames passed between filter_async() and an I/O thread */
+struct io_slot {
+    unsigned char *buf;
+    size_t count;           /* frames to transfer, (size_t)-1 to stop */
+    size_t done;            /* frames transferred */
+};
+
+/*
+ * the reader or the writer of filter_async(), a thread for the whole run
+ * going round a ring of slots: take counts the slots handed to it (to
+ * fill for the reader, to write out for the writer), give the ones it
+ * has finished with and handed back
+ */
+struct io_queue {
+    struct thread t;
+    FILE *fp;
+    size_t size;            /* bytes per frame */
+    struct io_slot slot[WAVE_IO_BUFFERS];
+    struct thread_sem take; /* slots for the thread to work on */
+    struct thread_sem give; /* slots it has finished with */
+    int stop;               /* (read by the reader after take) */
+    const struct engine *e; /* the reader's block sizes */
+    uint64_t frames;        /* frames for the reader to read */
+};
+
+/* read the blocks of the input ahead of the filter, until it ends or the
+   filter stops the queue */
+static void read_ahead(void *arg)
+{
+    struct io_queue *q = arg;
+    struct io_slot *s;
+    uint64_t n = 0;
+    int i = 0;
+
+    while (n < q->frames) {
+        thread_sem_wait(&q->take);
+        if (q->stop)
+            break;
+        s = &q->slot[i];
+        s->count = block_frames(q->e, n, q->frames);
+        s->done = fread(s->buf, q->size, s->count, q->fp);
+        thread_sem_post(&q->give);
+        if (s->done < s->count)
+            break;          /* end of the input */
+        n += s->count;
+        i = (i + 1) % WAVE_IO_BUFFERS;
+    }
+}
+
+/* write the blocks the filter hands over, until a count of (size_t)-1 */
+static void write_behind(void *arg)
+{
+    struct io_queue *q = arg;
+    struct io_slot *s;
+    int i = 0;
+
+    for (;;) {
+        thread_sem_wait(&q->take);
+        s = &q->slot[i];
+        if (s->count == (size_t)-1)
+            break;
+        s->done = s->count ? fwrite(s->buf, q->size, s->count, q->fp) : 0;
+        thread_sem_post(&q->give);
+        i = (i + 1) % WAVE_IO_BUFFERS;
+    }
+}
+
+/* set up a queue, buffers of bytes each, with every slot to be taken
+   (filled) or given back (empty); on failure nothing is left allocated */
+static int io_init(struct io_queue *q, FILE *fp, size_t size, size_t bytes,
+                   int filled)
+{
+    int i;
+
+    memset(q, 0, sizeof(*q));
+    q->fp = fp;
+    q->size = size;
+    for (i = 0; i < WAVE_IO_BUFFERS; i++)
+        if (!(q->slot[i].buf = malloc(bytes)))
+            goto fail;
+    if (thread_sem_init(&q->take, filled ? WAVE_IO_BUFFERS : 0) != 0)
+        goto fail;
+    if (thread_sem_init(&q->give, filled ? 0 : WAVE_IO_BUFFERS) != 0) {
+        thread_sem_destroy(&q->take);
+        goto fail;
+    }
+    return 0;
+fail:
+    for (i = 0; i < WAVE_IO_BUFFERS; i++)
+        free(q->slot[i].buf);
+    return -1;
+}
+
+/* free a queue set up by io_init(), its thread finished */
+static void io_free(struct io_queue *q)
+{
+    int i;
+
+    thread_sem_destroy(&q->give);
+    thread_sem_destroy(&q->take);
+    for (i = 0; i < WAVE_IO_BUFFERS; i++)
+        free(q->slot[i].buf);
+}
+
+/* hand the writer a stop and wait for it to write everything before */
+static void io_finish(struct io_queue *wr, int *slot)
+{
+    thread_sem_wait(&wr->give);
+    wr->slot[*slot].count = (size_t)-1;
+    thread_sem_post(&wr->take);
+    thread_join(&wr->t);
+}
+
+/*
+ * filter_async() - filter_blocks() with the reads and writes overlapped
+ * a reader thread reads up to WAVE_IO_BUFFERS blocks ahead of the filter
+ * and a writer thread writes them out behind it, both running for the
+ * whole file and swapping buffers with the filter through queues
+ *
+ * Return: number of frames filtered (written and pre-roll)
+ */
+static uint64_t filter_async(struct engine *e, FILE *fpi, FILE *fpo,
+                             uint64_t Nin, uint64_t Nout, int follow)
+{
+    const int C = e->channels;
+    struct io_queue rd, wr;
+    struct io_slot *in, *out;
+    uint64_t n = 0;
+    size_t m, k;
+    int ri = 0, wi = 0, ok;
+
+    /* the reader's queue starts with every slot to fill, the writer's
+       with none to write (without the threads, it's done in line) */
+    if (io_init(&rd, fpi, e->in_size * C, e->block * C * e->in_size, 1))
+        return filter_blocks(e, fpi, fpo, Nin, Nout, follow);
+    ok = io_init(&wr, fpo, e->out_size * C, e->block * C * e->out_size, 0)
+         == 0;
+    if (ok && thread_create(&wr.t, write_behind, &wr) != 0) {
+        io_free(&wr);
+        ok = 0;
+    }
+    if (ok) {
+        rd.e = e;
+        rd.frames = Nin < Nout ? Nin : Nout;
+        if (thread_create(&rd.t, read_ahead, &rd) != 0) {
+            io_finish(&wr, &wi);
+            io_free(&wr);
+            ok = 0;
+        }
+    }
+    if (!ok) {
+        io_free(&rd);
+        return filter_blocks(e, fpi, fpo, Nin, Nout, follow);
+    }
+
+    while (n < Nout) {
+        m = block_frames(e, n, Nout);
+        k = 0;
+        in = NULL;
+        if (n < Nin) {
+            thread_sem_wait(&rd.give);
+            lap(e, &e->st.read);
+            in = &rd.slot[ri];
+            k = in->done;
+            if (k < m && n + k < Nin) {
+                Nin = n + k;    /* input is shorter than its header says */
+                if (follow) {
+                    Nout = Nin + e->latency + e->tail;
+                    m = Nout - n < m ? (size_t)(Nout - n) : m;
+                }
+            }
+        }
+        if (m == 0)
+            break;
+        if (k == 0 && tail_silent(e)) {
+            io_finish(&wr, &wi);
+            write_silence(e, fpo, wr.slot[0].buf, n, Nout);
+            n = Nout;
+            goto done;
+        }
+
+        /* filter this block, while the next ones are being read and the
+           last ones written */
+        out = NULL;
+        if (n >= e->preroll) {
+            thread_sem_wait(&wr.give);
+            lap(e, &e->st.write);
+            out = &wr.slot[wi];
+        }
+        filter_raw(e, in ? in->buf : rd.slot[ri].buf,
+                   out ? out->buf : NULL, k, m);
+        if (in) {
+            thread_sem_post(&rd.take);
+            ri = (ri + 1) % WAVE_IO_BUFFERS;
+        }
+        if (out) {
+            out->count = m;
+            thread_sem_post(&wr.take);
+            wi = (wi + 1) % WAVE_IO_BUFFERS;
+        }
+        n += m;
+    }
+    io_finish(&wr, &wi);
+done:
+    lap(e, &e->st.write);
+    rd.stop = 1;
+    thread_sem_post(&rd.take);
+    thread_join(&rd.t);
+
+    io_free(&wr);
+    io_free(&rd);
+    return n;
+}
+
+/*
+ * filter_mem() - same as filter_blocks() for memory mapped data chunks
+ * the samples are converted straight from src and into dst
+ * frames first up to last are filtered (dst NULL throws the output away),
+ * frame n going to frame n - e->preroll of dst
+ */
+static void filter_mem(struct engine *e, const char *src, char *dst,
+                       uint64_t Nin, uint64_t first, uint64_t last)
+{
+    const int C = e->channels;
+    uint64_t n = first;
+    size_t m, k;
+
+    while (n < last) {
+        m = block_frames(e, n, last);
+        k = n < Nin ? (Nin - n < m ? Nin - n : m) : 0;
+        if (k == 0 && dst && tail_silent(e)) {
+            e->st.silent += last - n;   /* (a new mapping is all zeros) */
+            break;
+        }
+        if (dst && n >= e->preroll) {
+            filter_raw(e, src + (size_t)n * C * e->in_size,
+                       dst + (size_t)(n - e->preroll) * C * e->out_size,
+                       k, m);
+            lap(e, &e->st.write);
+        } else {
+            filter_raw(e, src + (size_t)n * C * e->in_size, NULL, k, m);
+        }
+        n += m;
+    }
+}
+
+/* a thread filtering one segment of a file with an FIR filter */
+struct segment_worker {
+    struct engine e;        /* own buffers and filter states */
+    struct thread t;
+    const char *src;
+    char *dst;
+    uint64_t Nin;
+    uint64_t first, last;   /* frames of the segment */
+    uint64_t warm;          /* frames filtered before first to settle */
+};
+
+static void filter_segment(void *arg)
+{
+    struct segment_worker *w = arg;
+    uint64_t start = w->first > w->warm ? w->first - w->warm : 0;
+
+    if (w->e.flush)
+        convert_denormals_flush();
+    if (w->e.timed)
+        w->e.lap = wave_clock();
+    filter_mem(&w->e, w->src, NULL, w->Nin, start, w->first);
+    filter_mem(&w->e, w->src, w->dst, w->Nin, w->first, w->last);
+}
+
+/*
+ * filter_segments() - filter a memory mapped data chunk in segments
+ * segment 0 uses e, the others their own engines in s[1..S-1]
+ */
+static void filter_segments(struct engine *e, struct segment_worker *s,
+                            int S, const char *src, char *dst,
+                            uint64_t Nin, uint64_t Nout, uint64_t warm)
+{
+    int started[WAVE_MAX_THREADS];
+    int k;
+
+    s[0].e = *e;
+    for (k = 0; k < S; k++) {
+        s[k].src = src;
+        s[k].dst = dst;
+        s[k].Nin = Nin;
+        s[k].first = (uint64_t)((double)Nout * k / S);
+        s[k].last = (uint64_t)((double)Nout * (k + 1) / S);
+        s[k].warm = warm;
+    }
+    for (k = 1; k < S; k++)
+        started[k] = thread_create(&s[k].t, filter_segment, &s[k]) == 0;
+    filter_segment(&s[0]);
+    for (k = 1; k < S; k++) {
+        if (started[k])
+            thread_join(&s[k].t);
+        else
+            filter_segment(&s[k]);
+    }
+    for (k = 0; k < S; k++)
+        stats_add(&e->st, &s[k].e.st);
+}
+
+/* give the engines of the segment workers buffers and filter states */
+static int segments_alloc(struct segment_worker *s, int S,
+                          const struct engine *e, void *state,
+                          const struct wave_options *opts)
+{
+    int k, c;
+
+    /* (s is zeroed, so segments_free() can clean up a partial setup) */
+    for (k = 1; k < S; k++) {
+        s[k].e = *e;
+        s[k].e.state = calloc(e->channels, sizeof(void *));
+        if (engine_alloc(&s[k].e) != 0 || !s[k].e.state)
+            return -1;
+        for (c = 0; c < (e->interleaved ? 1 : e->channels); c++)
+            if (!(s[k].e.state[c] = opts->clone(state)))
+                return -1;
+    }
+    return 0;
+}
+
+static void segments_free(struct segment_worker *s, int S,
+                          const struct wave_options *opts)
+{
+    int k, c;
+
+    for (k = 1; k < S; k++) {
+        if (s[k].e.state) {
+            for (c = 0; c < s[k].e.channels; c++)
+                if (s[k].e.state[c] && opts->destroy)
+                    opts->destroy(s[k].e.state[c]);
+            free(s[k].e.state);
+        }
+        engine_free(&s[k].e);
+    }
+}
+
+/*
+ * wave_load() - read all the samples of a wav file into memory
+ * filename: wav file to read (any format wave_filter_ex() reads)
+ * fmt: filled in with the header of the file
+ * frames: filled in with the number of frames read
+ *
+ * e.g. to load the impulse response of a convolution filter
+ * the data chunk is read up to its end or the end of the file, whichever
+ * comes first (to the end of the file if its length is unknown)
+ *
+ * Return: frames * fmt->channels interleaved samples to free(),
+ *         or NULL if the file could not be read
+ */
+double *wave_load(const char *filename, struct wave *fmt, size_t *frames)
+{
+    FILE *fp;
+    decode_func decode;
+    void *raw, *grown;
+    double *x = NULL;
+    size_t n, cap, limit;
+    int unknown;
+    char cbuf[64];
+
+    fp = fopen(filename, "rb");
+    if (!fp) {
+        perror(filename);
+        return NULL;
+    }
+    if (!wave_read_header(fmt, filename, fp)) {
+        fclose(fp);
+        return NULL;
+    }
+    decode = wave_decoder(fmt);
+    if (!decode) {
+        fprintf(stderr, "%s: can't load %d bit %s\n", filename,
+                fmt->bitspersample, wave_format_str(cbuf, fmt->format));
+        fclose(fp);
+        return NULL;
+    }
+
+    if (fmt->channels < 1 || fmt->blockalign == 0) {
+        fprintf(stderr, "%s: no channels\n", filename);
+        fclose(fp);
+        return NULL;
+    }
+
+    /* read up to the end of the data chunk, or of the file if that comes
+       first (or the length is unknown), growing the buffer as it goes */
+    unknown = fmt->data_size == 0 || fmt->data_size == 0xFFFFFFFF;
+    limit = unknown || fmt->data_size / fmt->blockalign > (size_t)-1 / 2
+            ? (size_t)-1 / 2 : (size_t)(fmt->data_size / fmt->blockalign);
+    cap = limit < WAVE_LOAD_FRAMES ? limit : WAVE_LOAD_FRAMES;
+    raw = malloc(cap * fmt->blockalign + 1);
+    n = 0;
+    while (raw) {
+        n += fread((char *)raw + n * fmt->blockalign, fmt->blockalign,
+                   cap - n, fp);
+        if (n < cap || n == limit)
+            break;
+        cap = cap < limit / 2 ? 2 * cap : limit;
+        if (cap > (size_t)-1 / fmt->blockalign - 1
+            || !(grown = realloc(raw, cap * fmt->blockalign + 1))) {
+            free(raw);
+            raw = NULL;
+        } else {
+            raw = grown;
+        }
+    }
+    if (raw && n <= (size_t)-1 / sizeof(double) / fmt->channels - 1)
+        x = malloc(n * fmt->channels * sizeof(double) + 1);
+    if (!raw || !x) {
+        fprintf(stderr, "%s: out of memory\n", filename);
+    } else {
+        convert_init();
+        decode(raw, x, n * fmt->channels);
+        *frames = n;
+    }
+    free(raw);
+    fclose(fp);
+    return x;
+}
+
+/* adapts a sample by sample filter_func to a block_filter_func */
+struct sample_adapter {
+    filter_func f;
+    void *state;
+};
+
+static void sample_adapter_block(void *state, const double *x, double *y,
+                                 size_t n)
+{
+    struct sample_adapter *s = state;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        y[i] = s->f(s->state, x[i]);
+}
+
+/*
+ * wave_filter() - sample by sample filter
+ * infile: filename of input wav file
+ * outfile: filename of output wav file
+ * f: callback function for sample by sample processing
+ * state: state to pass to sample processing function
+ * format: WAVE_FLOAT or WAVE_PCM
+ * t: length of time to run filter
+ *
+ * signal process infile to outfile (float)
+ * t = 0.0 will make the output the same length as the input
+ *
+ * Return: 0 on success
+ *         1 could not open file
+ *         2 could not parse file
+ *         4 unsupported file format
+ */
+int wave_filter(const char *infile, const char *outfile,
+                filter_func f, void *state, int format, double t)
+{
+    struct sample_adapter s;
+
+    s.f = f;
+    s.state = state;
+    return wave_filter_block(infile, outfile, sample_adapter_block, &s,
+                             format, t);
+}
+
+/*
+ * wave_filter_block() - block by block filter
+ * infile: filename of input wav file
+ * outfile: filename of output wav file
+ * f: callback function for block processing
+ * state: state to pass to block processing function
+ * format: WAVE_FLOAT or WAVE_PCM
+ * t: length of time to run filter
+ *
+ * same as wave_filter() but the data is read, converted and passed to f
+ * up to WAVE_BLOCK_SIZE samples at a time
+ *
+ * Return: same as wave_filter()
+ */
+int wave_filter_block(const char *infile, const char *outfile,
+                      block_filter_func f, void *state, int format, double t)
+{
+    return wave_filter_ex(infile, outfile, f, state, format, t, NULL);
+}
+
+/* fopen() for wave_filter_ex(), "-" is stdin or stdout */
+static FILE *open_file(const char *filename, const char *mode)
+{
+    FILE *fp;
+
+    if (strcmp(filename, "-") != 0)
+        return fopen(filename, mode);
+    fp = mode[0] == 'r' ? stdin : stdout;
+#ifdef _WIN32
+    _setmode(_fileno(fp), _O_BINARY);
+#endif
+    return fp;
+}
+
+/* move fp on n frames of size bytes into the data chunk that starts at
+   data_start: a seek, or reading them on a pipe (a short file ends up at
+   its end, to be found by the next read) */
+static void skip_frames(FILE *fp, long data_start, uint64_t n, int size)
+{
+    uint64_t bytes = n * size;
+    long k;
+
+    if (n == 0
+        || (fp != stdin
+            && wave_fseek(fp, (int64_t)data_start + bytes, SEEK_SET) == 0))
+        return;
+    while (bytes > 0) {
+        k = bytes < 0x40000000 ? (long)bytes : 0x40000000;
+        if (skip_bytes(fp, k) < k)
+            return;
+        bytes -= k;
+    }
+}
+
+/* fclose() for files from open_file() */
+static void close_file(FILE *fp)
+{
+    if (fp == stdin)
+        return;
+    if (fp == stdout)
+        fflush(fp);
+    else
+        fclose(fp);
+}
+
+/*
+ * filter_file() - wave_filter_ex() in one pass
+ * unclipped: float output is written as it is, not clamped to [-1, 1]
+ */
+static int filter_file(const char *infile, const char *outfile,
+                       block_filter_func f, void *state, int format, double t,
+                       const struct wave_options *opts, int unclipped)
+{
+    FILE *fpi, *fpo;        /* file pointers */
+    struct wave in, out;    /* wave file headers */
+    uint64_t Nin, Nout;     /* number of frames for in and out */
+    uint64_t first;         /* first frame of a region of the input */
+    uint64_t skip = 0;      /* input frames before it (and its pre-roll) */
+    uint64_t pre = 0;       /* frames of pre-roll */
+    long data_start;        /* offset of the input data chunk */
+    const char *data;       /* the mapped input, from the first frame read */
+    long head;              /* bytes of the output header */
+    char cbuf[64];          /* character buffer for string formatting */
+    struct engine e;
+    struct mapfile mi, mo;
+    struct segment_worker *segs;
+    int S = 1;              /* number of segments for an FIR filter */
+    int multi;              /* can filter more than one channel */
+    int stream;             /* stdin or stdout, no mapping or seeking */
+    int unknown;            /* the length of the input is unknown */
+    int follow;             /* output as long as the input turns out to be */
+    int reserve;            /* room in the header to make it RF64 later */
+    int mappable;           /* the files can be memory mapped */
+    int64_t end;
+    double start;           /* wave_clock() at the start, for opts->stats */
+    long fpmode = -1;       /* from convert_denormals_flush() */
+    int c, rv = 0;
+
+    memset(&e, 0, sizeof(e));
+    e.timed = opts && opts->stats;
+    start = e.lap = e.timed ? wave_clock() : 0.0;
+    stream = strcmp(infile, "-") == 0 || strcmp(outfile, "-") == 0;
+    fpi = open_file(infile, "rb");
+    if (!fpi) {
+        perror(infile);
+        return 1;
+    }
+    fpo = open_file(outfile, "wb");
+    if (!fpo) {
+        perror(outfile);
+        close_file(fpi);
+        return 1;
+    }
+    data_start = wave_read_header(&in, infile, fpi);
+    if (!data_start) {
+        close_file(fpi);
+        close_file(fpo);
+        return 2;
+    }
+    multi = opts && (opts->clone || opts->interleaved);
+    if (in.channels < 1 || (in.channels > 1 && !multi)) {
+        fprintf(stderr, "%s: number of channels must be 1\n", infile);
+        close_file(fpi);
+        close_file(fpo);
+        return 4;
+    }
+    if (opts && opts->setup && opts->setup(state, in.channels) != 0) {
+        fprintf(stderr, "%s: filter can't take %d channels\n", infile,
+                in.channels);
+        close_file(fpi);
+        close_file(fpo);
+        return 4;
+    }
+    if (format != WAVE_PCM && format != WAVE_FLOAT) {
+        fprintf(stderr, "unsupported output format %s\n",
+                wave_format_str(cbuf, format));
+        close_file(fpi);
+        close_file(fpo);
+        return 4;
+    }
+
+    /* streamed files have a data_size of 0 or 0xFFFFFFFF, if this is a
+       real file find the length from its size */
+    unknown = in.data_size == 0 || in.data_size == 0xFFFFFFFF;
+    if (unknown && fpi != stdin && wave_fseek(fpi, 0, SEEK_END) == 0
+        && (end = wave_ftell(fpi)) >= data_start
+        && wave_fseek(fpi, data_start, SEEK_SET) == 0) {
+        in.data_size = end - data_start;
+        unknown = 0;
+    }
+    follow = unknown && t == 0.0;
+
+    /* a different output rate: resample the input as it is read */
+    if (opts && opts->samplerate && opts->samplerate != in.samplerate) {
+        e.rs = resample_create(in.channels, in.samplerate, opts->samplerate);
+        if (!e.rs) {
+            fprintf(stderr, "%s: can't resample %lu Hz to %lu Hz\n", infile,
+                    (unsigned long)in.samplerate, opts->samplerate);
+            close_file(fpi);
+            close_file(fpo);
+            return 4;
+        }
+    }
+
+    out = in;
+    memcpy(out.riff_tag, "RIFF", 4);    /* (RF64 only if it has to be) */
+    Nin = unknown ? (uint64_t)-1 : in.data_size / in.blockalign;
+    if (opts && (opts->start || opts->end)) {
+        /* a region: seek straight to its start less the pre-roll, and
+           read no further than its end */
+        if (opts->end && opts->end < Nin)
+            Nin = opts->end;
+        first = opts->start < Nin ? opts->start : Nin;
+        pre = opts->preroll < first ? opts->preroll : first;
+        skip = first - pre;
+        if (Nin != (uint64_t)-1)
+            Nin -= skip;
+        skip_frames(fpi, data_start, skip, in.blockalign);
+    }
+    if (e.rs) {
+        e.rs_left = Nin;
+        out.samplerate = opts->samplerate;
+        if (Nin != (uint64_t)-1)
+            Nin = resample_length(e.rs, Nin);  /* (at the output rate) */
+        pre = resample_length(e.rs, pre);
+    }
+    if (opts && opts->latency) {
+        /* run the filter that much longer and drop its first outputs, so
+           the output lines up with the input */
+        e.latency = opts->latency;
+        pre += e.latency;
+    }
+    if (opts)
+        e.tail = opts->tail;
+    e.preroll = pre;
+    Nout = (t != 0.0) ? pre + (uint64_t)(out.samplerate * t)
+         : (Nin == (uint64_t)-1) ? Nin : Nin + e.latency + e.tail;
+    out.format = format;
+    out.fmt_size = 16;
+    out.bitspersample = (format == WAVE_FLOAT) ? 32 : 16;
+    out.blockalign = out.channels * out.bitspersample / 8;
+    out.byterate = out.blockalign * out.samplerate;
+    out.data_size = follow ? 0xFFFFFFFF : (Nout - pre) * out.blockalign;
+    out.riff_size = follow ? 0xFFFFFFFF : out.data_size + 16 + 8 + 8 + 4;
+
+    e.decode = wave_decoder(&in);
+    if (!e.decode)
+        goto fail;
+    e.encode = out.format != WAVE_FLOAT ? encode_pcm16
+             : unclipped ? encode_float_unclipped : encode_float;
+    e.in_size = in.bitspersample / 8;
+    e.out_size = out.bitspersample / 8;
+    e.channels = in.channels;
+    e.interleaved = opts && opts->interleaved;
+    e.f = f;
+    if (opts && opts->q15 && !e.rs && e.decode == decode_pcm16
+        && out.format == WAVE_PCM)
+        e.q15 = opts->q15;      /* 16 bit PCM in and out: fixed point */
+    e.threads = opts && opts->threads > 0 ? opts->threads
+                                          : thread_cpu_count();
+    if (e.interleaved)
+        e.threads = 1;
+    if (e.threads > e.channels)
+        e.threads = e.channels;
+    if (e.threads > WAVE_MAX_THREADS)
+        e.threads = WAVE_MAX_THREADS;
+    /* (a mapping has to fit in the address space of a 32 bit build) */
+    mappable = !stream && !unknown && !e.rs
+               && in.data_size < (size_t)-1 / 2
+               && out.data_size < (size_t)-1 / 2;
+    if (opts && opts->taps > 0 && opts->clone && mappable) {
+        /* FIR filter: split the file between the threads instead */
+        S = opts->threads > 0 ? opts->threads : thread_cpu_count();
+        if (S > WAVE_MAX_THREADS)
+            S = WAVE_MAX_THREADS;
+        if ((uint64_t)S > Nout / WAVE_MIN_SEGMENT)
+            S = (int)(Nout / WAVE_MIN_SEGMENT);
+        if (S > 1)
+            e.threads = 1;
+        else
+            S = 1;
+    }
+    e.block = e.threads > 1 ? WAVE_THREAD_BLOCK_SIZE : WAVE_BLOCK_SIZE;
+    if ((stream || (opts && opts->async)) && e.block < WAVE_THREAD_BLOCK_SIZE)
+        e.block = WAVE_THREAD_BLOCK_SIZE;   /* worth a thread per read */
+    if (opts && opts->block > 0)
+        e.block = opts->block;
+    convert_init();
+    if (!opts || !opts->denormals) {
+        fpmode = convert_denormals_flush();
+        e.flush = fpmode >= 0;
+        e.pad = e.flush ? 0.0 : WAVE_DENORMAL_PAD;
+    }
+    if (opts && opts->silence > 0.0) {
+        e.silence = opts->silence;
+        e.hold = opts->silence_hold ? opts->silence_hold : out.samplerate;
+    }
+
+    e.state = NULL;
+    segs = NULL;
+    if (engine_alloc(&e) != 0
+        || !(e.state = calloc(e.channels, sizeof(void *)))
+        || (e.rs && !(e.rsx = malloc(e.block * e.channels * sizeof(double))))) {
+        fprintf(stderr, "%s: out of memory\n", infile);
+        rv = 8;
+        goto done;
+    }
+    e.state[0] = state;
+    for (c = 1; c < e.channels && !e.interleaved; c++) {
+        e.state[c] = opts->clone(state);
+        if (!e.state[c]) {
+            fprintf(stderr, "%s: could not clone filter for channel %d\n",
+                    infile, c);
+            rv = 8;
+            goto done;
+        }
+    }
+    if (S > 1 && (!(segs = calloc(S, sizeof(*segs)))
+                  || segments_alloc(segs, S, &e, state, opts) != 0)) {
+        fprintf(stderr, "%s: could not create filters for %d segments\n",
+                infile, S);
+        rv = 8;
+        goto done;
+    }
+
+    /* a file of unknown length gets room for a ds64 chunk, in case it
+       turns out to need RF64 when the header is fixed up */
+    reserve = follow && wave_ftell(fpo) == 0;
+    head = reserve ? write_header(&out, HEADER_JUNK, fpo)
+                   : wave_write_header(&out, fpo);
+    lap(&e, &e.st.parse);
+    if (!mappable || ((!opts || !opts->mmap) && S == 1)) {
+        if ((stream || (opts && opts->async)) && !e.rs)
+            Nout = filter_async(&e, fpi, fpo, Nin, Nout, follow);
+        else
+            Nout = filter_blocks(&e, fpi, fpo, Nin, Nout, follow);
+        Nout = Nout > pre ? Nout - pre : 0;     /* (frames written) */
+        if (reserve) {
+            /* now the length is known, fix the header if possible */
+            out.data_size = Nout * out.blockalign;
+            out.riff_size = out.data_size + 16 + 8 + 8 + 4;
+            if (wave_fseek(fpo, 0, SEEK_SET) == 0)
+                write_header(&out, out.riff_size + 8 + WAVE_DS64_SIZE
+                                   > 0xFFFFFFFF ? HEADER_RF64 : HEADER_JUNK,
+                             fpo);
+        }
+        goto done;
+    }
+
+    /* memory mapped: the header is in place, map the rest of the file */
+    close_file(fpi);
+    close_file(fpo);
+    fpi = fpo = NULL;
+    if (mapfile_read(&mi, infile) != 0) {
+        rv = 1;
+        goto done;
+    }
+    if (mapfile_write(&mo, outfile, head + out.data_size) != 0) {
+        mapfile_close(&mi);
+        rv = 1;
+        goto done;
+    }
+    if (data_start + (skip + Nin) * in.blockalign > mi.size) {
+        end = (mi.size - data_start) / in.blockalign;
+        Nin = (uint64_t)end > skip ? end - skip : 0;
+    }
+    data = (const char *)mi.addr + data_start + skip * in.blockalign;
+    lap(&e, &e.st.parse);
+    if (S > 1)
+        filter_segments(&e, segs, S, data, (char *)mo.addr + head, Nin, Nout,
+                        opts->taps - 1);
+    else
+        filter_mem(&e, data, (char *)mo.addr + head, Nin, 0, Nout);
+    mapfile_close(&mo);
+    mapfile_close(&mi);
+    lap(&e, &e.st.write);
+    Nout -= pre;
+
+done:
+    if (e.timed && rv == 0) {
+        e.st.total = wave_clock() - start;
+        e.st.frames = Nout;
+        e.st.samples = (size_t)Nout * e.channels;
+        e.st.rate = e.st.total > 0.0 ? e.st.samples / e.st.total : 0.0;
+        *opts->stats = e.st;
+    }
+    if (segs) {
+        segments_free(segs, S, opts);
+        free(segs);
+    }
+    if (e.state) {
+        for (c = 1; c < e.channels; c++)
+            if (e.state[c] && opts->destroy)
+                opts->destroy(e.state[c]);
+        free(e.state);
+    }
+    engine_free(&e);
+    if (e.rs) {
+        resample_destroy(e.rs);
+        free(e.rsx);
+    }
+    if (fpi)
+        close_file(fpi);
+    if (fpo)
+        close_file(fpo);
+    convert_denormals_restore(fpmode);
+    return rv;
+
+fail:
     fprintf(stderr, "%s: filter ", infile);
-    fprintf(stderr, "from: %s to: ", wave_format_str(cbuf, in.format));
+    fprintf(stderr, "from: %d bit %s to: ", in.bitspersample,
+            wave_format_str(cbuf, in.format));
     fprintf(stderr, "%s is unsupported\n", wave_format_str(cbuf, out.format));
+    if (e.rs)
+        resample_destroy(e.rs);
+    close_file(fpi);
+    close_file(fpo);
     return 4;
 }
+
+/* a thread finding the peak and the sum of squares of n float samples */
+struct level_worker {
+    struct thread t;
+    const float *x;
+    size_t n;
+    double peak;
+    double sum;
+};
+
+static void measure_level(void *arg)
+{
+    struct level_worker *w = arg;
+    double a, peak = 0.0, sum = 0.0;
+    size_t i;
+
+    for (i = 0; i < w->n; i++) {
+        a = w->x[i] < 0.0f ? -w->x[i] : w->x[i];
+        if (a != a)
+            continue;       /* (NaN) */
+        if (a > peak)
+            peak = a;
+        sum += a * a;
+    }
+    w->peak = peak;
+    w->sum = sum;
+}
+
+/*
+ * measure_file() - peak and RMS level of a float file
+ * filename: the first pass of a normalized run
+ * threads: threads to share the samples between, 0 for one per cpu
+ * peak, rms: filled in with the levels of all the samples
+ *
+ * the data chunk is mapped and cut into a slice for each thread
+ *
+ * Return: 0 on success, 1 could not open or map it, 2 could not parse it
+ */
+static int measure_file(const char *filename, int threads, double *peak,
+                        double *rms)
+{
+    struct level_worker w[WAVE_MAX_THREADS];
+    int started[WAVE_MAX_THREADS];
+    struct wave fmt;
+    struct mapfile m;
+    long start;
+    size_t n;
+    double sum = 0.0;
+    int T, k;
+
+    start = wave_scan_header(&fmt, filename);
+    if (start <= 0)
+        return start < 0 ? 1 : 2;
+    if (mapfile_read(&m, filename) != 0)
+        return 1;
+    n = m.size > (size_t)start ? (m.size - start) / sizeof(float) : 0;
+    if (fmt.data_size / sizeof(float) < n)
+        n = (size_t)(fmt.data_size / sizeof(float));
+
+    T = threads > 0 ? threads : thread_cpu_count();
+    if (T > WAVE_MAX_THREADS)
+        T = WAVE_MAX_THREADS;
+    if ((size_t)T > n / WAVE_MIN_SEGMENT)
+        T = n / WAVE_MIN_SEGMENT > 0 ? (int)(n / WAVE_MIN_SEGMENT) : 1;
+    for (k = 0; k < T; k++) {
+        w[k].x = (const float *)((const char *)m.addr + start)
+                 + (size_t)((double)n * k / T);
+        w[k].n = (size_t)((double)n * (k + 1) / T)
+                 - (size_t)((double)n * k / T);
+    }
+    for (k = 1; k < T; k++)
+        started[k] = thread_create(&w[k].t, measure_level, &w[k]) == 0;
+    measure_level(&w[0]);
+    *peak = w[0].peak;
+    for (k = 0; k < T; k++) {
+        if (k > 0 && started[k])
+            thread_join(&w[k].t);
+        else if (k > 0)
+            measure_level(&w[k]);
+        if (w[k].peak > *peak)
+            *peak = w[k].peak;
+        sum += w[k].sum;
+    }
+    *rms = n > 0 ? sqrt(sum / n) : 0.0;
+    mapfile_close(&m);
+    return 0;
+}
+
+/* the second pass of a normalized run: interleaved samples times the
+   gain state points to (shared by every segment, it is only read) */
+static void scale_block(void *state, const double *x, double *y, size_t n)
+{
+    const double gain = *(const double *)state;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        y[i] = x[i] * gain;
+}
+
+static void *share_state(void *state)
+{
+    return state;
+}
+
+/*
+ * make_temp() - create a new, empty file next to path for a temporary
+ * named "path.<pid>.<n>.tmp", n counting up past names already taken
+ * (by the user, or another run or thread writing to the same place)
+ *
+ * Return: its name (to free), NULL if none could be created
+ */
+static char *make_temp(const char *path)
+{
+    char *name = malloc(strlen(path) + 32);
+    unsigned long pid;
+    int n, fd;
+
+    if (!name)
+        return NULL;
+#ifdef _WIN32
+    pid = GetCurrentProcessId();
+#else
+    pid = (unsigned long)getpid();
+#endif
+    for (n = 0; n < WAVE_TEMP_TRIES; n++) {
+        sprintf(name, "%s.%lu.%d.tmp", path, pid, n);
+#ifdef _WIN32
+        fd = _open(name, _O_CREAT | _O_EXCL | _O_WRONLY | _O_BINARY,
+                   _S_IREAD | _S_IWRITE);
+        if (fd >= 0) {
+            _close(fd);
+            return name;
+        }
+#else
+        fd = open(name, O_CREAT | O_EXCL | O_WRONLY, 0666);
+        if (fd >= 0) {
+            close(fd);
+            return name;
+        }
+#endif
+        if (errno != EEXIST)
+            break;
+    }
+    perror(name);
+    free(name);
+    return NULL;
+}
+
+/*
+ * filter_normalized() - wave_filter_ex() with opts->normalize(_rms)
+ * renders a temporary file next to outfile (make_temp()) with
+ * filter_file(), measures it and scales it into outfile with
+ * filter_file() again, then removes it
+ */
+static int filter_normalized(const char *infile, const char *outfile,
+                             block_filter_func f, void *state, int format,
+                             double t, const struct wave_options *opts)
+{
+    struct wave_options first = *opts, second;
+    struct wave_stats st1, st2;
+    char *tmp;
+    double start, peak = 0.0, rms = 0.0, gain = 1.0, level;
+    int rv;
+
+    if (strcmp(outfile, "-") == 0) {
+        fprintf(stderr, "can't normalize to stdout: the output is rendered "
+                        "to a file first\n");
+        return 1;
+    }
+    tmp = make_temp(outfile);
+    if (!tmp)
+        return 1;
+    start = wave_clock();
+    memset(&st1, 0, sizeof(st1));
+    memset(&st2, 0, sizeof(st2));
+
+    first.normalize = first.normalize_rms = 0.0;
+    first.stats = opts->stats ? &st1 : NULL;
+    rv = filter_file(infile, tmp, f, state, WAVE_FLOAT, t, &first, 1);
+    if (rv == 0) {
+        level = wave_clock();
+        rv = measure_file(tmp, opts->threads, &peak, &rms);
+        st1.read += wave_clock() - level;
+    }
+    if (rv == 0) {
+        /* a hair under the level, so rounding can't take the peak over */
+        if (peak > 0.0 && peak <= DBL_MAX) {
+            level = opts->normalize > 0.0 ? opts->normalize : 1.0;
+            gain = level / peak;
+            if (opts->normalize_rms > 0.0 && rms > 0.0
+                && opts->normalize_rms / rms < gain)
+                gain = opts->normalize_rms / rms;
+            gain *= 1.0 - 4 * DBL_EPSILON;
+        }
+        memset(&second, 0, sizeof(second));
+        second.mmap = 1;
+        second.threads = opts->threads;
+        second.interleaved = 1;
+        second.clone = share_state;
+        second.taps = 1;
+        second.stats = opts->stats ? &st2 : NULL;
+        rv = filter_file(tmp, outfile, scale_block, &gain, format, 0.0,
+                         &second, 0);
+    }
+    remove(tmp);
+    free(tmp);
+
+    if (rv == 0 && opts->stats) {
+        /* the filter's output and its time, the second pass's clipping */
+        st2.parse += st1.parse;
+        st2.read += st1.read;
+        st2.filter += st1.filter;
+        st2.write += st1.write;
+        st2.total = wave_clock() - start;
+        st2.rate = st2.total > 0.0 ? st2.samples / st2.total : 0.0;
+        st2.peak = peak;
+        st2.denormals = st1.denormals;
+        st2.nans = st1.nans;
+        st2.silent = st1.silent;
+        st2.gain = gain;
+        *opts->stats = st2;
+    }
+    return rv;
+}
+
+/*
+ * wave_filter_ex() - block by block filter with options
+ * infile: filename of input wav file
+ * outfile: filename of output wav file
+ * f: callback function for block processing
+ * state: state to pass to block processing function
+ * format: WAVE_FLOAT or WAVE_PCM
+ * t: length of time to run filter
+ * opts: processing options (NULL for the defaults)
+ *
+ * files with more than one channel need opts->clone, state is used for
+ * the first channel and clones of it for the others. The channels are
+ * filtered on opts->threads threads (0 for one per processor).
+ * With opts->interleaved, f is given whole interleaved frames instead
+ * (opts->setup tells it how many channels they have first).
+ * opts->block sets how many frames f gets at a time.
+ * With opts->taps (an FIR filter) the threads filter consecutive
+ * segments of the file instead, through memory mapped files.
+ * With opts->async the file is read and written on their own threads.
+ * Denormals are flushed to zero while filtering (on the cpus that can,
+ * elsewhere a tiny offset is fed in after the end of the file instead)
+ * unless opts->denormals is set: the decaying feedback of a reverb tail
+ * otherwise slows the filter down many times over.
+ * With opts->silence the filter stops once the output after the end of
+ * the input has stayed below that level for opts->silence_hold frames,
+ * and the rest of the tail is written as silence.
+ * With opts->samplerate the input is resampled to that rate as it is
+ * read, so f and the output file run at it (t is then at the new rate
+ * too); the file is read and written a block at a time, never mapped,
+ * split into segments or streamed on threads.
+ * With opts->start or opts->end only that region of the input is
+ * filtered and written (from a seek to it, t counting from its start),
+ * after opts->preroll frames before it have been filtered to settle the
+ * filter and thrown away.
+ * With t = 0 the output is as long as the input, plus opts->tail frames
+ * of the filter ringing on after it.
+ * With opts->q15 and both files 16 bit PCM, that is run instead of f, on
+ * the samples as they are in the file (Q15) by every path above; there
+ * is nothing to decode, encode or flush.
+ * With opts->normalize or opts->normalize_rms the output is rendered
+ * unclipped, as float, to a new temporary file next to outfile first
+ * (outfile.<pid>.<n>.tmp): its peak and RMS level are measured on
+ * threads over a mapping of it, and it is then scaled to the level asked
+ * for and quantized to the output format in one more pass
+ * (over mappings, in segments on threads), so nothing clips.
+ * With opts->stats the time spent in each phase, the peak level and the
+ * clipped, denormal and NaN outputs are counted (at the cost of a scan
+ * of the output) and stored there when the run succeeds.
+ *
+ * infile or outfile "-" streams from stdin or to stdout (always async,
+ * never mapped). A data chunk size of 0 or 0xFFFFFFFF means the length
+ * is unknown: the input is read to its end, and with t = 0 the output
+ * header is fixed up afterwards if outfile can seek.
+ * Files of 4 GiB or more are read and written as RF64; an output of
+ * unknown length gets a JUNK chunk in its header, replaced by a ds64
+ * chunk in the fix up if it turns out to need one.
+ *
+ * Return: 0 on success
+ *         1 could not open (or map) file
+ *         2 could not parse file
+ *         4 unsupported file format
+ *         8 out of memory
+ */
+int wave_filter_ex(const char *infile, const char *outfile,
+                   block_filter_func f, void *state, int format, double t,
+                   const struct wave_options *opts)
+{
+    if (opts && (opts->normalize > 0.0 || opts->normalize_rms > 0.0))
+        return filter_normalized(infile, outfile, f, state, format, t, opts);
+    return filter_file(infile, outfile, f, state, format, t, opts, 0);
+}
@@ -1,15 +1,21 @@
 #ifndef DSP_WAVE_H_INCLUDED
 #define DSP_WAVE_H_INCLUDED
 
-/* RIFF WAVE file format */
+/* RIFF WAVE file format
+ *
+ * files over 4 GiB are RF64 (EBU Tech 3306): the same chunks, with
+ * "RF64" in place of "RIFF", the 32 bit sizes set to 0xFFFFFFFF and the
+ * real sizes in a ds64 chunk before fmt. Sony Wave64 files (GUID chunk
+ * tags and 64 bit sizes throughout) can be read too.
+ */
 
 #include "filter.h"
 #include <stdint.h>
 #include <stdio.h>
 
 struct wave {
-    char     riff_tag[4];   /* RIFF chunk tag */
-    uint32_t riff_size;     /* size of file (minus 8 bytes) */
+    char     riff_tag[4];   /* RIFF chunk tag (or RF64, riff for Wave64) */
+    uint64_t riff_size;     /* size of file (minus 8 bytes) */
     char     wave_tag[4];   /* WAVE chunk tag */
     char     fmt_tag[4];    /* 'fmt ' chunk tag */
     uint32_t fmt_size;      /* size of data format */
@@ -20,13 +26,112 @@ struct wave {
     uint16_t blockalign;    /* block align = channels * bitspersample / 8 */
     uint16_t bitspersample; /* 8 bits or 16 bits */
     char     data_tag[4];   /* data chunk tag */
-    uint32_t data_size;     /* size of data */
+    uint64_t data_size;     /* size of data */
+};
+
+/* statistics of a wave_filter_ex() run (see wave_options.stats)
+   with several threads the phase times are summed over the threads */
+struct wave_stats {
+    double parse;       /* seconds opening and parsing the files, setting up
+                           the filters and mapping the files */
+    double read;        /* seconds reading and decoding the input */
+    double filter;      /* seconds in the filter */
+    double write;       /* seconds encoding and writing the output */
+    double total;       /* wall time of the whole run in seconds */
+    size_t frames;      /* frames written */
+    size_t samples;     /* samples written (frames * channels) */
+    double rate;        /* samples written per second of total */
+    double peak;        /* largest magnitude of the filter output */
+    size_t clipped;     /* output samples clamped to [-1, 1] */
+    size_t denormals;   /* subnormal (denormal) filter output samples */
+    size_t nans;        /* NaN filter output samples */
+    size_t silent;      /* tail frames written as silence, unfiltered */
+    double gain;        /* gain the output was normalized by, 0 if not */
+};
+
+/* options for wave_filter_ex() */
+struct wave_options {
+    int mmap;       /* memory map the input and output files */
+    int threads;    /* threads for multichannel files, 0 for one per cpu */
+    /* f filters every channel itself: it is passed n interleaved frames
+       (n * channels samples) and no clones are made */
+    int interleaved;
+    /* called with the number of channels of the input once its header has
+       been read, before any filtering or cloning, so an interleaved f can
+       size itself for them (NULL for none): nonzero fails the run */
+    int (*setup)(void *state, int channels);
+    /* create an independent copy of the filter state for another channel
+       (needed for files with more than one channel) */
+    void *(*clone)(void *state);
+    /* free a state returned by clone */
+    void (*destroy)(void *state);
+    /* frames passed to f at a time, 0 for the default */
+    size_t block;
+    /* f is an FIR filter (no feedback) with an impulse response this many
+       frames long, 0 if not: then the file is cut into segments that are
+       filtered on separate threads by clones of state, each starting
+       taps - 1 frames early so its first outputs are already settled */
+    size_t taps;
+    /* read and write the files on their own threads, overlapped with
+       filtering (always on when streaming from stdin or to stdout) */
+    int async;
+    /* filled in with the statistics of the run, NULL for none */
+    struct wave_stats *stats;
+    /* keep denormal numbers, instead of flushing them to zero (FTZ/DAZ)
+       on every thread for the run */
+    int denormals;
+    /* stop running the filter once the output after the end of the input
+       has stayed below this level for silence_hold frames (e.g. 1e-6 for
+       -120 dBFS), and write silence for the rest, 0 to filter it all */
+    double silence;
+    /* frames the output has to stay below silence for, 0 for a second
+       (it must be longer than any quiet stretch the filter can have
+       while it still holds energy, such as a long pre-delay) */
+    size_t silence_hold;
+    /* resample the input to this rate before it is filtered, and write
+       the output at it, 0 for the rate of the input (a rational L/M
+       polyphase converter, see resample.h) */
+    unsigned long samplerate;
+    /* the same filter in fixed point (on state and its clones), run in
+       place of f when the input and the output are both 16 bit PCM: the
+       samples go from the file to it and back without being converted
+       to double, NULL to always run f */
+    block_filter_q15_func q15;
+    /* filter only the region of the input from frame start up to frame
+       end (0 for the end of the file), seeking straight to it: the output
+       is that region alone, and t counts from start (for a time in
+       seconds, multiply it by the sample rate of the input) */
+    uint64_t start;
+    uint64_t end;
+    /* frames before start run through the filter and thrown away, so a
+       recursive filter has settled by the time the region begins */
+    size_t preroll;
+    /* frames the filter delays its output by (such as the frame of an
+       STFT): that many more are run through it at the end and the first
+       that many are thrown away, so the output lines up with the input */
+    size_t latency;
+    /* frames the output runs on for after the end of the input when t is
+       0, for the tail of the filter (ImpulseLength() - 1 for an FIR): the
+       length of the input doesn't have to be known */
+    size_t tail;
+    /* render the output unclipped first and scale it so that its peak is
+       at this level (1 for full scale, 0.891 for -1 dBFS), 0 for off */
+    double normalize;
+    /* or so that its RMS level is at this, but no higher than lets the
+       peak reach normalize (or full scale): the output never clips */
+    double normalize_rms;
 };
 
 /* read the WAVEfmt RIFF header */
 long wave_read_header(struct wave *fmt, const char *tag, FILE *fp);
 
-/* write the WAVEfmt RIFF header */
+/* read the WAVEfmt RIFF header of a file with a few positioned reads
+   (thread safe), -1 if it can't be opened */
+long wave_scan_header(struct wave *fmt, const char *filename);
+
+/* write the WAVEfmt RIFF header, as RF64 if riff_tag is "RF64" or the
+   sizes don't fit in 32 bits (riff_size as for a plain RIFF header: the
+   ds64 chunk is added to it), return the bytes written */
 long wave_write_header(const struct wave *fmt, FILE *fp);
 
 /* print summary of the WAVEfmt RIFF header to stdout */
@@ -35,13 +140,30 @@ void wave_print_header(const struct wave *fmt);
 /* dump a summary of the wav file to stdout */
 int wave_dump(const char *filename);
 
+/* print the statistics of a run, one per line */
+void wave_print_stats(const struct wave_stats *s, FILE *fp);
+
+/* read all the samples of a wav file (interleaved, free() when done) */
+double *wave_load(const char *filename, struct wave *fmt, size_t *frames);
+
 /* sample by sample process wav file */
 int wave_filter(const char *infile, const char *outfile,
                 filter_func f, void *state, int format, double t);
 
+/* block by block process wav file */
+int wave_filter_block(const char *infile, const char *outfile,
+                      block_filter_func f, void *state, int format, double t);
+
+/* block by block process wav file with options (opts may be NULL)
+   infile or outfile "-" streams from stdin or to stdout */
+int wave_filter_ex(const char *infile, const char *outfile,
+                   block_filter_func f, void *state, int format, double t,
+                   const struct wave_options *opts);
+
 #define WAVE_PCM     1
 #define WAVE_FLOAT   3
 #define WAVE_ALAW    6
 #define WAVE_uLAW    7
+#define WAVE_EXTENSIBLE 0xFFFE  /* (read as the format of its sub format) */
 
 #endif
@@ -5,6 +5,9 @@ extern "C" {
 #include "wave.h"
 }
 #include "filter.hpp"
+#include <algorithm>
+#include <type_traits>
+#include <vector>
 
 namespace dsp {
 
@@ -14,17 +17,172 @@ inline double FilterWavProcessSample(Filter *f, double x) {
     return f->ProcessSample(x);
 }
 
-/* FilterWav() C++ wrapper for wave_filter()
+/* block callback for wave_filter_block()
+ */
+inline void FilterWavProcessBlock(Filter *f, const double *x, double *y,
+                                  std::size_t n) {
+    f->ProcessBlock(x, y, n);
+}
+
+/* fixed point block callback, for filters with FixedPoint()
+ */
+inline void FilterWavProcessBlockQ15(Filter *f, const std::int16_t *x,
+                                     std::int16_t *y, std::size_t n) {
+    f->ProcessBlockQ15(x, y, n);
+}
+
+/* clone callbacks for multichannel files
+ */
+inline void *FilterWavClone(void *f) {
+    return static_cast<Filter *>(f)->Clone();
+}
+
+inline void FilterWavDestroy(void *f) {
+    delete static_cast<Filter *>(f);
+}
+
+/* FilterWav() C++ wrapper for wave_filter_block()
  * infile: filename of input wav file
  * outfile: filename of output wav file
  * format: output wav file format type
  * duration: length of time to use input wav file as the source
+ * opts: options for wave_filter_ex() (nullptr for the defaults)
+ *
+ * each extra channel of a multichannel file is filtered by f->Clone()
+ * FIR filters (f->ImpulseLength() > 0) are run on segments of the file
+ * in parallel unless opts sets taps itself
+ * filters with a fixed point version (f->FixedPoint()) run it when the
+ * input and output are 16 bit PCM, unless opts sets q15 itself
+ * the latency of f (f->Latency()) is taken out of the output, unless
+ * opts sets latency itself
  */
 inline int FilterWav(const char *infile, const char *outfile,
-                     Filter* f, int format, double duration) {
-    return wave_filter(infile, outfile,
-                       (filter_func)FilterWavProcessSample, f,
-                       format, duration);
+                     Filter* f, int format, double duration,
+                     const wave_options *opts = nullptr) {
+    wave_options o{};
+    if (opts)
+        o = *opts;
+    o.clone = FilterWavClone;
+    o.destroy = FilterWavDestroy;
+    if (!o.taps)
+        o.taps = f->ImpulseLength();
+    if (!o.latency)
+        o.latency = f->Latency();
+    if (!o.q15 && f->FixedPoint())
+        o.q15 = (block_filter_q15_func)FilterWavProcessBlockQ15;
+    return wave_filter_ex(infile, outfile,
+                          (block_filter_func)FilterWavProcessBlock, f,
+                          format, duration, &o);
+}
+
+/* callbacks for FilterWav() with a float filter
+ * the double samples of each block are copied into a float buffer for f
+ * and back: exact for 16 bit PCM and float files, and the output is
+ * rounded to float when it is written anyway
+ */
+struct FilterWavFloatState {
+    BasicFilter<float> *f;
+    bool owned;                 // f is a clone to delete with this
+    std::vector<float> buf;
+};
+
+inline void FilterWavFloatBlock(void *s, const double *x, double *y,
+                                std::size_t n) {
+    FilterWavFloatState *a = static_cast<FilterWavFloatState *>(s);
+    a->buf.assign(x, x + n);
+    a->f->ProcessBlock(a->buf.data(), a->buf.data(), n);
+    std::copy(a->buf.begin(), a->buf.end(), y);
+}
+
+inline void FilterWavFloatBlockQ15(void *s, const std::int16_t *x,
+                                   std::int16_t *y, std::size_t n) {
+    static_cast<FilterWavFloatState *>(s)->f->ProcessBlockQ15(x, y, n);
+}
+
+inline void *FilterWavFloatClone(void *s) {
+    BasicFilter<float> *f = static_cast<FilterWavFloatState *>(s)->f->Clone();
+    return f ? new FilterWavFloatState{f, true, {}} : nullptr;
+}
+
+inline void FilterWavFloatDestroy(void *s) {
+    FilterWavFloatState *a = static_cast<FilterWavFloatState *>(s);
+    if (a->owned)
+        delete a->f;
+    delete a;
+}
+
+/* FilterWav() for a float filter (e.g. dsp::BasicBiQuad<float>)
+ * same as FilterWav() for a Filter*, with the samples converted for f
+ */
+inline int FilterWav(const char *infile, const char *outfile,
+                     BasicFilter<float> *f, int format, double duration,
+                     const wave_options *opts = nullptr) {
+    FilterWavFloatState s{f, false, {}};
+    wave_options o{};
+    if (opts)
+        o = *opts;
+    o.clone = FilterWavFloatClone;
+    o.destroy = FilterWavFloatDestroy;
+    if (!o.taps)
+        o.taps = f->ImpulseLength();
+    if (!o.latency)
+        o.latency = f->Latency();
+    if (!o.q15 && f->FixedPoint())
+        o.q15 = FilterWavFloatBlockQ15;
+    return wave_filter_ex(infile, outfile, FilterWavFloatBlock, &s,
+                          format, duration, &o);
+}
+
+/* statically bound callbacks for FilterWav<F>()
+ */
+template <typename F>
+void FilterWavProcessBlockStatic(void *f, const double *x, double *y,
+                                 std::size_t n) {
+    static_cast<F *>(f)->F::ProcessBlock(x, y, n);
+}
+
+template <typename F>
+void FilterWavProcessBlockQ15Static(void *f, const std::int16_t *x,
+                                    std::int16_t *y, std::size_t n) {
+    static_cast<F *>(f)->F::ProcessBlockQ15(x, y, n);
+}
+
+template <typename F>
+void *FilterWavCloneStatic(void *f) {
+    return new F(*static_cast<F *>(f));
+}
+
+template <typename F>
+void FilterWavDestroyStatic(void *f) {
+    delete static_cast<F *>(f);
+}
+
+/* FilterWav<F>() wrapper for wave_filter_ex() for a concrete filter type
+ * same as FilterWav() but f is treated as exactly an F: ProcessBlock is
+ * called without virtual dispatch (so a Chain of stages can be inlined
+ * together) and channels are cloned with F's copy constructor.
+ * The non-template FilterWav() is still used for a plain Filter*, and
+ * for float filters.
+ */
+template <typename F>
+typename std::enable_if<std::is_same<typename F::sample_type, double>::value,
+                        int>::type
+FilterWav(const char *infile, const char *outfile,
+          F *f, int format, double duration,
+          const wave_options *opts = nullptr) {
+    wave_options o{};
+    if (opts)
+        o = *opts;
+    o.clone = FilterWavCloneStatic<F>;
+    o.destroy = FilterWavDestroyStatic<F>;
+    if (!o.taps)
+        o.taps = f->F::ImpulseLength();
+    if (!o.latency)
+        o.latency = f->F::Latency();
+    if (!o.q15 && f->F::FixedPoint())
+        o.q15 = FilterWavProcessBlockQ15Static<F>;
+    return wave_filter_ex(infile, outfile, FilterWavProcessBlockStatic<F>,
+                          f, format, duration, &o);
 }
 
 } // namespace dsp
@@ -0,0 +1,60 @@
+#include "stft.h"
+#include "wave.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * wavgate - spectral noise gate
+ *
+ *  wavgate [--stats] infile outfile [threshold_db [size [hop]]]
+ *
+ * every bin of a 2048 point STFT (hop 512) quieter than the threshold
+ * (-60 dBFS) is gated out, and the rest resynthesised, lined up with the
+ * input and the same length. The size is rounded up to a power of two,
+ * N, and the hop has to be from 1 up to N/2 (the most the Hann window
+ * overlaps back to the input at).
+ */
+static int Usage()
+{
+    fprintf(stderr, "Usage: wavgate [--stats] infile outfile "
+                    "[threshold_db [size [hop]]]\n");
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+    const int stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+
+    if (argc - stats < 3 || argc - stats > 6)
+        return Usage();
+    const char *infile = argv[1 + stats];
+    const char *outfile = argv[2 + stats];
+    const double db = argc - stats > 3 ? atof(argv[3 + stats]) : -60.0;
+    const int size = argc - stats > 4 ? atoi(argv[4 + stats]) : 2048;
+    const int hop = argc - stats > 5 ? atoi(argv[5 + stats]) : size / 4;
+    if (size <= 0 || size > 1 << 24 || hop <= 0) {
+        fprintf(stderr, "wavgate: the size has to be 1 to %d, "
+                        "the hop above 0\n", 1 << 24);
+        return Usage();
+    }
+
+    dsp::SpectralFilter f{new dsp::SpectralGate{std::pow(10.0, db / 20.0)},
+                          size_t(size), size_t(hop)};
+    if (size_t(hop) > f.Size() || !f.Exact()) {
+        fprintf(stderr, "wavgate: a hop of %d doesn't overlap a %zu point "
+                        "window back to the input (1 to %zu)\n",
+                hop, f.Size(), f.MaxHop());
+        return Usage();
+    }
+    wave_stats st{};
+    wave_options opts{};
+    opts.block = f.Hop();
+    opts.stats = stats ? &st : nullptr;
+
+    int rv = FilterWav(infile, outfile, &f, WAVE_PCM, 0.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+    return rv;
+}
@@ -0,0 +1,73 @@
+#include "circular.h"
+#include "flanger.hpp"
+#include "graph.h"
+#include "wave.hpp"
+extern "C" {
+#include "canfltr.h"
+#include "delayline.h"
+}
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * wavgraph - a reverb send and a flanger as a filter graph
+ *
+ *  wavgraph [--stats] infile outfile
+ *
+ *  x --→ [canfltr] --+------------------------------→ (+) --→ [flanger] --→ y
+ *                    |                          0.7   ↑ 0.3
+ *                    +--→ [delayline] --→ [circular] -+
+ *
+ * the C canonical filter and delay line and the C++ reverb and flanger
+ * each run on their own thread, a quantum behind the stage before them.
+ */
+
+static double b[3] = {0.2, 0.2, 0.2};
+static double a[3] = {1.0, 0.3, 0.3};
+
+int main(int argc, char *argv[])
+{
+    const int stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+
+    if (argc - stats != 3) {
+        fprintf(stderr, "Usage: wavgraph [--stats] infile outfile\n");
+        return EXIT_FAILURE;
+    }
+
+    struct canfltr *tone = canfltr_create(3, b, a);
+    struct delay *predelay = delay_create(883);     // 20 ms at 44.1 kHz
+    dsp::Circular reverb{5000};
+    reverb.b[1] = 0.4;
+    reverb.b[3500] = 0.4;
+    reverb.a[3000] = 0.6;
+    dsp::Flanger flanger{200, 44100, 0.125};
+
+    dsp::Graph g;
+    const int dry = g.Add(dsp::Graph::Stage{
+        (block_filter_func)canfltr_block, tone,
+        (void *(*)(void *))canfltr_clone, (void (*)(void *))canfltr_destroy});
+    g.Add(dsp::Graph::Stage{
+        (filter_func)delay_sample, predelay,
+        (void *(*)(void *))delay_clone, (void (*)(void *))delay_destroy});
+    const int wet = g.Add(&reverb);
+    g.Mix({{dry, 0.7}, {wet, 0.3}});
+    g.Add(&flanger);
+
+    wave_stats st{};
+    wave_options opts{};
+    opts.stats = stats ? &st : nullptr;
+    opts.silence = 1e-6;    // stop the 2 s tail once it is below -120 dBFS
+    opts.block = 65536;     // 64 quanta, for the stages to overlap
+
+    // as a Filter*: a Graph is cloned with Clone(), not copied
+    dsp::Filter *f = &g;
+    int rv = FilterWav(argv[1 + stats], argv[2 + stats], f, WAVE_PCM, 2.0,
+                       &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+
+    canfltr_destroy(tone);
+    delay_destroy(predelay);
+    return rv;
+}
@@ -0,0 +1,133 @@
+#include "biquad.h"
+#include "realtime.h"
+extern "C" {
+#include "wave.h"
+}
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * wavlive - the wavbiquad band pass run through the real-time host
+ *
+ *  wavlive [--paced] [--sweep] [-b block] infile outfile
+ *
+ * infile is played through a WavDevice into a FilterCallback. With
+ * --paced the device keeps to the sample rate and reports the blocks
+ * the audio thread was late with. With --sweep a control thread moves
+ * the centre of the band up and down while the file plays, through
+ * lock-free coefficient updates. Without --sweep the output is the same
+ * as wavbiquad's.
+ */
+
+struct Coefficients {
+    std::array<double,3> b, a;
+};
+
+static void Apply(dsp::BiQuad &f, const Coefficients &c)
+{
+    f.b = c.b;
+    f.a = c.a;
+}
+
+// band pass at f0 Hz with the bandwidth of the wavbiquad filter
+static Coefficients BandPass(double f0, double fs)
+{
+    const double r = std::sqrt(0.991);
+    const double w = 2.0 * dsp::pi * f0 / fs;
+    return Coefficients{{0.00425, 0.0, -0.00425},
+                        {1.0, -2.0 * r * std::cos(w), r * r}};
+}
+
+// the control thread: sweep the band between 200 Hz and 2 kHz
+struct Sweep {
+    dsp::FilterCallback<dsp::BiQuad, Coefficients> *cb;
+    double fs;
+    std::atomic<bool> done;
+    unsigned long updates;
+};
+
+static void SweepThread(void *arg)
+{
+    Sweep *s = static_cast<Sweep *>(arg);
+    double phase = 0.0;
+
+    while (!s->done.load()) {
+        const double f0 = 200.0 * std::pow(10.0, 0.5 - 0.5 * std::cos(phase));
+        s->cb->Update(BandPass(f0, s->fs));
+        s->updates++;
+        phase += 1e-3;
+        thread_yield();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool paced = false, sweep = false;
+    std::size_t block = 256;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-' && argv[arg][1]; arg++) {
+        if (strcmp(argv[arg], "--paced") == 0)
+            paced = true;
+        else if (strcmp(argv[arg], "--sweep") == 0)
+            sweep = true;
+        else if (strcmp(argv[arg], "-b") == 0 && arg + 1 < argc)
+            block = atoi(argv[++arg]);
+        else
+            break;
+    }
+    if (argc - arg != 2 || block == 0) {
+        fprintf(stderr,
+                "Usage: %s [--paced] [--sweep] [-b block] infile outfile\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *infile = argv[arg];
+    const char *outfile = argv[arg + 1];
+
+    struct wave fmt;
+    FILE *fp = fopen(infile, "rb");
+    if (!fp) {
+        perror(infile);
+        return EXIT_FAILURE;
+    }
+    long seek = wave_read_header(&fmt, infile, fp);
+    fclose(fp);
+    if (!seek)
+        return EXIT_FAILURE;
+
+    dsp::BiQuad f{{0.00425, 0.0, -0.00425}, {1.0, -1.98, 0.991}};
+    dsp::FilterCallback<dsp::BiQuad, Coefficients> cb{f, fmt.channels,
+                                                      block, Apply};
+    dsp::RealTime host{cb, fmt.channels, block};
+    dsp::WavDevice device;
+
+    Sweep s;
+    s.cb = &cb;
+    s.fs = fmt.samplerate;
+    s.done = false;
+    s.updates = 0;
+    struct thread control;
+    bool controlling = sweep && thread_create(&control, SweepThread, &s) == 0;
+
+    int rv = device.Run(host, infile, outfile, WAVE_FLOAT, paced);
+
+    if (controlling) {
+        s.done = true;
+        thread_join(&control);
+    }
+    fprintf(stderr, "%lu blocks of %lu frames in %.3f s, "
+            "%lu underruns, %lu overruns",
+            (unsigned long)host.Blocks(), (unsigned long)block,
+            device.Seconds(), (unsigned long)device.Underruns(),
+            (unsigned long)device.Overruns());
+    if (controlling)
+        fprintf(stderr, ", %lu coefficient updates", s.updates);
+    fprintf(stderr, "\n");
+
+    return rv;
+}
@@ -0,0 +1,49 @@
+#include "wave.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * wavresample - convert a wav file to another sample rate
+ *
+ *  wavresample [--stats] rate infile outfile
+ *
+ * the conversion is done by wave_filter_ex() as the file is read, so the
+ * filter here passes the resampled frames straight through
+ */
+
+static void identity(void *state, const double *x, double *y, size_t n)
+{
+    (void)state;
+    if (x != y)
+        memmove(y, x, n * sizeof(double));
+}
+
+int main(int argc, char *argv[])
+{
+    struct wave_options opts = {0};
+    struct wave_stats st;
+    int stats, rv;
+    long rate;
+
+    stats = argc > 1 && strcmp(argv[1], "--stats") == 0;
+    if (argc - stats != 4) {
+        fprintf(stderr, "Usage: wavresample [--stats] rate infile outfile\n");
+        return EXIT_FAILURE;
+    }
+    rate = atol(argv[1 + stats]);
+    if (rate <= 0) {
+        fprintf(stderr, "wavresample: bad rate %s\n", argv[1 + stats]);
+        return EXIT_FAILURE;
+    }
+
+    opts.interleaved = 1;   /* every channel at once, no clones needed */
+    opts.samplerate = rate;
+    opts.stats = stats ? &st : NULL;
+    rv = wave_filter_ex(argv[2 + stats], argv[3 + stats], identity, NULL,
+                        WAVE_FLOAT, 0.0, &opts);
+    if (stats && rv == 0)
+        wave_print_stats(&st, stderr);
+
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}